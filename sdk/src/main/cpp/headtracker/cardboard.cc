@@ -15,6 +15,8 @@
  */
 #include "cardboard.h"
 
+#include <algorithm>
+#include <array>
 #include <cmath>
 
 #include "head_tracker.h"
@@ -45,6 +47,12 @@ namespace {
         }
     }
 
+cardboard::ThreadPolicy ToThreadPolicy(const CardboardThreadPolicy &policy) {
+    return {policy.set_nice_value != 0, policy.nice_value,
+            policy.use_fifo_scheduling != 0, policy.fifo_priority,
+            policy.cpu_affinity_mask};
+}
+
 }  // anonymous namespace
 
 extern "C" {
@@ -63,6 +71,14 @@ CardboardHeadTracker *CardboardHeadTracker_create() {
     return reinterpret_cast<CardboardHeadTracker *>(new cardboard::HeadTracker());
 }
 
+CardboardHeadTracker *CardboardHeadTracker_createWithStateModel(
+        CardboardSensorFusionStateModel state_model) {
+    return reinterpret_cast<CardboardHeadTracker *>(new cardboard::HeadTracker(
+            state_model == kSensorFusionStateModelRotationAndGyroscopeBias
+            ? cardboard::kRotationAndGyroscopeBiasStateModel
+            : cardboard::kRotationStateModel));
+}
+
 void CardboardHeadTracker_destroy(CardboardHeadTracker *head_tracker) {
     if (CARDBOARD_IS_ARG_NULL(head_tracker)) {
         return;
@@ -101,4 +117,237 @@ void CardboardHeadTracker_getPose(
     std::memcpy(position, &out_position[0], 3 * sizeof(float));
     std::memcpy(orientation, &out_orientation[0], 4 * sizeof(float));
 }
+
+void CardboardHeadTracker_getPoses(
+        CardboardHeadTracker *head_tracker, const int64_t *timestamps_ns,
+        const CardboardViewportOrientation *viewport_orientations,
+        int32_t num_poses, float *positions, float *orientations,
+        float *angular_uncertainties) {
+    if (num_poses <= 0) {
+        return;
+    }
+    if (CARDBOARD_IS_ARG_NULL(head_tracker) ||
+        CARDBOARD_IS_ARG_NULL(timestamps_ns) ||
+        CARDBOARD_IS_ARG_NULL(viewport_orientations) ||
+        CARDBOARD_IS_ARG_NULL(positions) ||
+        CARDBOARD_IS_ARG_NULL(orientations)) {
+        for (int32_t i = 0; i < num_poses; ++i) {
+            GetDefaultPosition(positions == nullptr ? nullptr : positions + 3 * i);
+            GetDefaultOrientation(
+                    orientations == nullptr ? nullptr : orientations + 4 * i);
+            if (angular_uncertainties != nullptr) {
+                angular_uncertainties[i] = static_cast<float>(M_PI);
+            }
+        }
+        return;
+    }
+    static_cast<cardboard::HeadTracker *>(head_tracker)
+            ->GetPoses(timestamps_ns, viewport_orientations,
+                       static_cast<size_t>(num_poses), positions, orientations,
+                       angular_uncertainties);
+}
+
+void CardboardHeadTracker_getPoseWithUncertainty(
+        CardboardHeadTracker *head_tracker, int64_t timestamp_ns,
+        CardboardViewportOrientation viewport_orientation, float *position,
+        float *orientation, float *angular_uncertainty) {
+    if (CARDBOARD_IS_ARG_NULL(head_tracker) ||
+        CARDBOARD_IS_ARG_NULL(position) || CARDBOARD_IS_ARG_NULL(orientation) ||
+        CARDBOARD_IS_ARG_NULL(angular_uncertainty)) {
+        GetDefaultPosition(position);
+        GetDefaultOrientation(orientation);
+        if (angular_uncertainty != nullptr) {
+            *angular_uncertainty = static_cast<float>(M_PI);
+        }
+        return;
+    }
+    static_cast<cardboard::HeadTracker *>(head_tracker)
+            ->GetPoses(&timestamp_ns, &viewport_orientation, 1, position,
+                       orientation, angular_uncertainty);
+}
+
+void CardboardHeadTracker_setTrackingQos(CardboardHeadTracker *head_tracker,
+                                         CardboardTrackingQos qos) {
+    if (CARDBOARD_IS_ARG_NULL(head_tracker)) {
+        return;
+    }
+    static_cast<cardboard::HeadTracker *>(head_tracker)->SetTrackingQos(qos);
+}
+
+int32_t CardboardHeadTracker_getSensorClockOffset(
+        CardboardHeadTracker *head_tracker, int64_t *offset_ns, double *skew) {
+    if (CARDBOARD_IS_ARG_NULL(head_tracker) ||
+        CARDBOARD_IS_ARG_NULL(offset_ns) || CARDBOARD_IS_ARG_NULL(skew)) {
+        return 0;
+    }
+    const cardboard::ClockOffsetEstimate estimate =
+            static_cast<cardboard::HeadTracker *>(head_tracker)
+                    ->GetSensorClockOffsetEstimate();
+    if (!estimate.is_valid) {
+        return 0;
+    }
+    *offset_ns = estimate.offset_ns;
+    *skew = estimate.skew;
+    return 1;
+}
+
+void CardboardHeadTracker_setThreadPolicies(
+        CardboardHeadTracker *head_tracker,
+        const CardboardThreadPolicy *sensor_thread_policy,
+        const CardboardThreadPolicy *fusion_thread_policy) {
+    if (CARDBOARD_IS_ARG_NULL(head_tracker) ||
+        CARDBOARD_IS_ARG_NULL(sensor_thread_policy) ||
+        CARDBOARD_IS_ARG_NULL(fusion_thread_policy)) {
+        return;
+    }
+    static_cast<cardboard::HeadTracker *>(head_tracker)
+            ->SetThreadPolicies(ToThreadPolicy(*sensor_thread_policy),
+                                ToThreadPolicy(*fusion_thread_policy));
+}
+
+int32_t CardboardHeadTracker_getLatencyHistogram(
+        CardboardHeadTracker *head_tracker, CardboardLatencyHistogram histogram,
+        uint64_t *counts, int32_t max_buckets) {
+    if (CARDBOARD_IS_ARG_NULL(head_tracker) || CARDBOARD_IS_ARG_NULL(counts)) {
+        return 0;
+    }
+    cardboard::HeadTracker *tracker =
+            static_cast<cardboard::HeadTracker *>(head_tracker);
+    const cardboard::LatencyHistogram::Snapshot snapshot =
+            histogram == kLatencyHistogramFusionWakeUp
+            ? tracker->GetFusionWakeUpLatencyHistogram()
+            : tracker->GetSensorDeliveryLatencyHistogram();
+    const int32_t num_buckets = std::max(
+            0, std::min(max_buckets,
+                        static_cast<int32_t>(snapshot.counts.size())));
+    std::copy(snapshot.counts.begin(), snapshot.counts.begin() + num_buckets,
+              counts);
+    return num_buckets;
+}
+
+void CardboardHeadTracker_setReorderLatencyBudget(
+        CardboardHeadTracker *head_tracker, int64_t latency_budget_ns) {
+    if (CARDBOARD_IS_ARG_NULL(head_tracker)) {
+        return;
+    }
+    static_cast<cardboard::HeadTracker *>(head_tracker)
+            ->SetReorderLatencyBudget(latency_budget_ns);
+}
+
+void CardboardHeadTracker_getReorderStatistics(
+        CardboardHeadTracker *head_tracker, uint64_t *num_reordered_samples,
+        uint64_t *num_dropped_samples) {
+    if (CARDBOARD_IS_ARG_NULL(head_tracker) ||
+        CARDBOARD_IS_ARG_NULL(num_reordered_samples) ||
+        CARDBOARD_IS_ARG_NULL(num_dropped_samples)) {
+        return;
+    }
+    const cardboard::SensorReorderStatistics statistics =
+            static_cast<cardboard::HeadTracker *>(head_tracker)
+                    ->GetReorderStatistics();
+    *num_reordered_samples = statistics.num_reordered_samples;
+    *num_dropped_samples = statistics.num_dropped_samples;
+}
+
+void CardboardHeadTracker_setAccelerometerCorrectionSchedule(
+        CardboardHeadTracker *head_tracker, int64_t min_correction_period_ns,
+        int64_t max_correction_period_ns, int32_t average_skipped_samples) {
+    if (CARDBOARD_IS_ARG_NULL(head_tracker)) {
+        return;
+    }
+    static_cast<cardboard::HeadTracker *>(head_tracker)
+            ->SetAccelerometerCorrectionSchedule(
+                    {min_correction_period_ns, max_correction_period_ns,
+                     average_skipped_samples != 0});
+}
+
+void CardboardHeadTracker_setRotationPredictionModel(
+        CardboardHeadTracker *head_tracker,
+        CardboardRotationPredictionModel model) {
+    if (CARDBOARD_IS_ARG_NULL(head_tracker)) {
+        return;
+    }
+    static_cast<cardboard::HeadTracker *>(head_tracker)
+            ->SetRotationPredictionModel(
+                    model == kRotationPredictionModelConstantAcceleration
+                    ? cardboard::kRotationPredictionConstantAcceleration
+                    : cardboard::kRotationPredictionConstantVelocity);
+}
+
+void CardboardHeadTracker_recenter(CardboardHeadTracker *head_tracker) {
+    if (CARDBOARD_IS_ARG_NULL(head_tracker)) {
+        return;
+    }
+    static_cast<cardboard::HeadTracker *>(head_tracker)->Recenter();
+}
+
+void CardboardHeadTracker_reportFramePresented(
+        CardboardHeadTracker *head_tracker, int64_t render_timestamp_ns,
+        int64_t predicted_display_timestamp_ns,
+        int64_t actual_display_timestamp_ns) {
+    if (CARDBOARD_IS_ARG_NULL(head_tracker)) {
+        return;
+    }
+    static_cast<cardboard::HeadTracker *>(head_tracker)
+            ->ReportFramePresented({render_timestamp_ns,
+                                    predicted_display_timestamp_ns,
+                                    actual_display_timestamp_ns});
+}
+
+int64_t CardboardHeadTracker_getDisplayLatency(
+        CardboardHeadTracker *head_tracker, int64_t default_latency_ns) {
+    if (CARDBOARD_IS_ARG_NULL(head_tracker)) {
+        return default_latency_ns;
+    }
+    return static_cast<cardboard::HeadTracker *>(head_tracker)
+            ->GetDisplayLatencyEstimateNs(default_latency_ns);
+}
+
+int32_t CardboardHeadTracker_getDisplayLatencyTrace(
+        CardboardHeadTracker *head_tracker, int64_t *frames,
+        int32_t max_frames) {
+    if (CARDBOARD_IS_ARG_NULL(head_tracker) || CARDBOARD_IS_ARG_NULL(frames) ||
+        max_frames <= 0) {
+        return 0;
+    }
+    std::array<cardboard::DisplayLatencySample,
+               cardboard::DisplayLatencyEstimator::kTraceCapacity>
+            trace;
+    const size_t num_frames =
+            static_cast<cardboard::HeadTracker *>(head_tracker)
+                    ->GetDisplayLatencyTrace(
+                            trace.data(),
+                            std::min(static_cast<size_t>(max_frames),
+                                     trace.size()));
+    for (size_t i = 0; i < num_frames; ++i) {
+        frames[3 * i] = trace[i].render_timestamp_ns;
+        frames[3 * i + 1] = trace[i].predicted_display_timestamp_ns;
+        frames[3 * i + 2] = trace[i].actual_display_timestamp_ns;
+    }
+    return static_cast<int32_t>(num_frames);
+}
+
+int32_t CardboardHeadTracker_saveState(CardboardHeadTracker *head_tracker,
+                                       uint8_t *buffer, int32_t buffer_size) {
+    if (CARDBOARD_IS_ARG_NULL(head_tracker)) {
+        return 0;
+    }
+    if (buffer_size < 0) {
+        buffer_size = 0;
+    }
+    return static_cast<int32_t>(
+            static_cast<cardboard::HeadTracker *>(head_tracker)
+                    ->SaveState(buffer, static_cast<size_t>(buffer_size)));
+}
+
+bool CardboardHeadTracker_restoreState(CardboardHeadTracker *head_tracker,
+                                       const uint8_t *buffer,
+                                       int32_t buffer_size) {
+    if (CARDBOARD_IS_ARG_NULL(head_tracker) || CARDBOARD_IS_ARG_NULL(buffer) ||
+        buffer_size < 0) {
+        return false;
+    }
+    return static_cast<cardboard::HeadTracker *>(head_tracker)
+            ->RestoreState(buffer, static_cast<size_t>(buffer_size));
+}
 }  // extern "C"
@@ -20,6 +20,7 @@
 #include <jni.h>
 #endif
 
+#include <stdbool.h>
 #include <stdint.h>
 
 /// Enum to describe the possible orientations of the viewport.
@@ -45,6 +46,68 @@ typedef enum CardboardViewportOrientation {
   /// - Unity: ScreenOrientation.PortraitUpsideDown.
   kPortraitUpsideDown = 3,
 } CardboardViewportOrientation;
+
+/// Enum to describe the tracking quality of service levels. Lower levels
+/// reduce the sensor sampling rate and thus the power consumption.
+typedef enum CardboardTrackingQos {
+  /// Sensors run at their highest sampling rate, events are reported
+  /// immediately. This is the default level, meant for immersive rendering.
+  kTrackingQosFull = 0,
+  /// Sensors run at 100 Hz, events are reported immediately. Meant for
+  /// non-immersive content, such as 2D menus.
+  kTrackingQosReduced = 1,
+  /// Sensors run at 50 Hz and events are batched in the hardware FIFO for up
+  /// to 100 ms, when supported. Meant for when poses are not rendered.
+  kTrackingQosBackgroundBatched = 2,
+} CardboardTrackingQos;
+
+/// Struct to describe the scheduling policy of a head tracker worker thread.
+typedef struct CardboardThreadPolicy {
+  /// Whether @p nice_value is applied. Otherwise the original nice value of
+  /// the thread is restored.
+  int32_t set_nice_value;
+  /// Nice value of the thread, from -20 (highest priority) to 19.
+  int32_t nice_value;
+  /// Whether the thread requests real-time SCHED_FIFO scheduling. When it is
+  /// not permitted, only the nice value is applied.
+  int32_t use_fifo_scheduling;
+  /// SCHED_FIFO priority, from 1 (lowest) to 99.
+  int32_t fifo_priority;
+  /// Bit i allows the thread to run on CPU i. Zero restores the original
+  /// affinity of the thread.
+  uint64_t cpu_affinity_mask;
+} CardboardThreadPolicy;
+
+/// Enum to describe the latency histograms recorded by the head tracker.
+typedef enum CardboardLatencyHistogram {
+  /// Delays between the sensor events and the moment the sensor capture
+  /// thread read them. Its spread is the sensor delivery jitter.
+  kLatencyHistogramSensorDelivery = 0,
+  /// Delays between the capture thread queueing sensor samples and the sensor
+  /// fusion thread waking up to process them.
+  kLatencyHistogramFusionWakeUp = 1,
+} CardboardLatencyHistogram;
+
+/// Enum to describe the state estimated by the sensor fusion filter.
+typedef enum CardboardSensorFusionStateModel {
+  /// Rotation only. The gyroscope bias is only learned while the device lies
+  /// still. This is the default model.
+  kSensorFusionStateModelRotation = 0,
+  /// Rotation and gyroscope bias, so the bias is also learned while the device
+  /// moves. Each gravity correction costs more.
+  kSensorFusionStateModelRotationAndGyroscopeBias = 1,
+} CardboardSensorFusionStateModel;
+
+/// Enum to describe how the rotation is extrapolated to the pose timestamp.
+typedef enum CardboardRotationPredictionModel {
+  /// The latest angular velocity is held over the whole horizon. This is the
+  /// default model.
+  kRotationPredictionModelConstantVelocity = 0,
+  /// The filtered angular acceleration is also extrapolated, damped as the
+  /// horizon grows. It anticipates head turns starting and stopping.
+  kRotationPredictionModelConstantAcceleration = 1,
+} CardboardRotationPredictionModel;
+
 /// An opaque Head Tracker object.
 typedef struct CardboardHeadTracker CardboardHeadTracker;
 
@@ -138,6 +201,13 @@ void Cardboard_initializeAndroid(JavaVM* vm, jobject context);
 /// @return         head tracker object pointer
 CardboardHeadTracker* CardboardHeadTracker_create();
 
+/// Creates a new head tracker object with a given sensor fusion state model.
+///
+/// @param[in]      state_model             State estimated by sensor fusion.
+/// @return         head tracker object pointer
+CardboardHeadTracker* CardboardHeadTracker_createWithStateModel(
+    CardboardSensorFusionStateModel state_model);
+
 /// Destroys and releases memory used by the provided head tracker object.
 ///
 /// @pre @p head_tracker Must not be null.
@@ -174,6 +244,10 @@ void CardboardHeadTracker_resume(CardboardHeadTracker* head_tracker);
 ///          clock (see [Apple
 ///          Timestamp](https://developer.apple.com/documentation/coremotion/cmlogitem/1615939-timestamp?language=objc)).
 ///
+///          This function must always be called from the same thread (e.g. the
+///          render thread): the pose is read without locking, from a buffer
+///          that supports a single reader. Debug builds assert it.
+///
 /// @pre @p head_tracker Must not be null.
 /// @pre @p position Must not be null.
 /// @pre @p orientation Must not be null.
@@ -191,16 +265,337 @@ void CardboardHeadTracker_getPose(
     CardboardViewportOrientation viewport_orientation, float* position,
     float* orientation);
 
+/// Gets the predicted head poses for several timestamps.
+///
+/// @details        All poses are predicted from the same head tracker state,
+///                 e.g. the poses of the left eye, the right eye and the middle
+///                 of a frame. The timestamps are in the clock of
+///                 CardboardHeadTracker_getPose(). It is cheaper than one
+///                 CardboardHeadTracker_getPose() call per pose. The outputs
+///                 are packed, i.e. the pose @p i is at @p positions + 3 * i
+///                 and @p orientations + 4 * i.
+///                 The angular uncertainties are the ones of
+///                 CardboardHeadTracker_getPoseWithUncertainty().
+///
+///                 This function must be called from the same thread as
+///                 CardboardHeadTracker_getPose(), for the same reason.
+///
+/// @pre @p head_tracker Must not be null.
+/// @pre @p timestamps_ns Must not be null.
+/// @pre @p viewport_orientations Must not be null.
+/// @pre @p positions Must not be null.
+/// @pre @p orientations Must not be null.
+/// When it is unmet, a call to this function results in a no-op and default
+/// values are returned in the non-null outputs (zero values and identity
+/// quaternions, respectively).
+///
+/// @param[in]      head_tracker            Head tracker object pointer.
+/// @param[in]      timestamps_ns           @p num_poses timestamps in
+///                                         nanoseconds.
+/// @param[in]      viewport_orientations   @p num_poses viewport orientations.
+/// @param[in]      num_poses               Number of poses.
+/// @param[out]     positions               3 * @p num_poses floats for
+///                                         (x, y, z).
+/// @param[out]     orientations            4 * @p num_poses floats for
+///                                         quaternions
+/// @param[out]     angular_uncertainties   Optional @p num_poses floats for the
+///                                         angular uncertainties in radians.
+///                                         It may be null.
+void CardboardHeadTracker_getPoses(
+    CardboardHeadTracker* head_tracker, const int64_t* timestamps_ns,
+    const CardboardViewportOrientation* viewport_orientations,
+    int32_t num_poses, float* positions, float* orientations,
+    float* angular_uncertainties);
+
+/// Gets the predicted head pose for a given timestamp and its uncertainty.
+///
+/// @details        The angular uncertainty is three times the standard
+///                 deviation of the orientation error around any axis, i.e.
+///                 the half-angle of a 3-sigma cone around the predicted view
+///                 direction. It is derived from the sensor fusion covariance
+///                 and grows with the prediction horizon. It is pi until the
+///                 head tracker is aligned with gravity. Prefetching or
+///                 culling margins may shrink with it.
+///
+///                 This function must be called from the same thread as
+///                 CardboardHeadTracker_getPose(), for the same reason.
+///
+/// @pre @p head_tracker Must not be null.
+/// @pre @p position Must not be null.
+/// @pre @p orientation Must not be null.
+/// @pre @p angular_uncertainty Must not be null.
+/// When it is unmet, a call to this function results in a no-op and default
+/// values are returned in the non-null outputs (zero values, identity
+/// quaternion and pi, respectively).
+///
+/// @param[in]      head_tracker            Head tracker object pointer.
+/// @param[in]      timestamp_ns            The timestamp for the pose in
+///                                         nanoseconds, see
+///                                         CardboardHeadTracker_getPose().
+/// @param[in]      viewport_orientation    The viewport orientation.
+/// @param[out]     position                3 floats for (x, y, z).
+/// @param[out]     orientation             4 floats for quaternion
+/// @param[out]     angular_uncertainty     Angular uncertainty in radians.
+void CardboardHeadTracker_getPoseWithUncertainty(
+    CardboardHeadTracker* head_tracker, int64_t timestamp_ns,
+    CardboardViewportOrientation viewport_orientation, float* position,
+    float* orientation, float* angular_uncertainty);
+
+/// Sets the tracking quality of service level.
+///
+/// @details While the level is kTrackingQosFull and the device is lying still,
+///          the head tracker automatically uses kTrackingQosReduced. It
+///          switches back as soon as motion is detected.
+///
+/// @pre @p head_tracker Must not be null.
+/// When it is unmet, a call to this function results in a no-op.
+///
+/// @param[in]      head_tracker            Head tracker object pointer.
+/// @param[in]      qos                     The tracking QoS level.
+void CardboardHeadTracker_setTrackingQos(CardboardHeadTracker* head_tracker,
+                                         CardboardTrackingQos qos);
+
+/// Sets the scheduling policies of the head tracker worker threads.
+///
+/// @details The policies are applied asynchronously by the threads themselves.
+///          Failures, e.g. SCHED_FIFO not being permitted, are logged.
+///
+/// @pre @p head_tracker Must not be null.
+/// @pre @p sensor_thread_policy Must not be null.
+/// @pre @p fusion_thread_policy Must not be null.
+/// When it is unmet, a call to this function results in a no-op.
+///
+/// @param[in]      head_tracker            Head tracker object pointer.
+/// @param[in]      sensor_thread_policy    Policy of the sensor capture thread.
+/// @param[in]      fusion_thread_policy    Policy of the sensor fusion thread.
+void CardboardHeadTracker_setThreadPolicies(
+    CardboardHeadTracker* head_tracker,
+    const CardboardThreadPolicy* sensor_thread_policy,
+    const CardboardThreadPolicy* fusion_thread_policy);
+
+/// Gets the counts of a latency histogram, for diagnostics.
+///
+/// @details Bucket 0 counts latencies below 1 us and bucket i > 0 counts
+///          latencies in [2^(i-1), 2^i) us. The last bucket also counts every
+///          larger latency.
+///
+/// @pre @p head_tracker Must not be null.
+/// @pre @p counts Must not be null.
+/// When it is unmet, a call to this function results in a no-op and 0 is
+/// returned.
+///
+/// @param[in]      head_tracker            Head tracker object pointer.
+/// @param[in]      histogram               The histogram to get.
+/// @param[out]     counts                  Array receiving the bucket counts.
+/// @param[in]      max_buckets             Capacity of @p counts.
+/// @return         The number of buckets written to @p counts.
+int32_t CardboardHeadTracker_getLatencyHistogram(
+    CardboardHeadTracker* head_tracker, CardboardLatencyHistogram histogram,
+    uint64_t* counts, int32_t max_buckets);
+
+/// Sets how long sensor samples may be held to merge the accelerometer and the
+/// gyroscope streams by sensor timestamp.
+///
+/// @details A larger budget puts more late samples back in order but delays
+///          every sample by up to that amount. Samples arriving later than the
+///          budget allows are dropped.
+///
+/// @pre @p head_tracker Must not be null.
+///
+/// @param[in]      head_tracker            Head tracker object pointer.
+/// @param[in]      latency_budget_ns       Latency budget in nanoseconds.
+void CardboardHeadTracker_setReorderLatencyBudget(
+    CardboardHeadTracker* head_tracker, int64_t latency_budget_ns);
+
+/// Gets the number of sensor samples reordered or dropped while merging the
+/// sensor streams, for diagnostics.
+///
+/// @details Only samples put back in order within their own stream are
+///          counted as reordered, not the interleaving of the two streams.
+///
+/// @pre @p head_tracker Must not be null.
+/// @pre @p num_reordered_samples Must not be null.
+/// @pre @p num_dropped_samples Must not be null.
+/// When it is unmet, a call to this function results in a no-op.
+///
+/// @param[in]      head_tracker            Head tracker object pointer.
+/// @param[out]     num_reordered_samples   Number of reordered samples.
+/// @param[out]     num_dropped_samples     Number of dropped samples.
+void CardboardHeadTracker_getReorderStatistics(
+    CardboardHeadTracker* head_tracker, uint64_t* num_reordered_samples,
+    uint64_t* num_dropped_samples);
+
+/// Sets the schedule of the gravity corrections of sensor fusion.
+///
+/// @details By default, every accelerometer sample corrects the estimated
+///          tilt. Fewer corrections lower the sensor fusion cost. Samples
+///          received between two corrections still update the accelerometer
+///          noise model and the gyroscope bias estimation.
+///
+/// @pre @p head_tracker Must not be null.
+///
+/// @param[in]      head_tracker            Head tracker object pointer.
+/// @param[in]      min_correction_period_ns  Minimum time between two
+///                                         corrections in nanoseconds. Zero
+///                                         corrects with every sample.
+/// @param[in]      max_correction_period_ns  Maximum time between two
+///                                         corrections in nanoseconds. Above
+///                                         @p min_correction_period_ns, the
+///                                         period grows with the linear
+///                                         acceleration of the device.
+/// @param[in]      average_skipped_samples If non-zero, a correction uses the
+///                                         average of the samples received
+///                                         since the previous one.
+void CardboardHeadTracker_setAccelerometerCorrectionSchedule(
+    CardboardHeadTracker* head_tracker, int64_t min_correction_period_ns,
+    int64_t max_correction_period_ns, int32_t average_skipped_samples);
+
+/// Sets the model extrapolating the rotation to the timestamp requested by
+/// CardboardHeadTracker_getPose().
+///
+/// @pre @p head_tracker Must not be null.
+/// When it is unmet, a call to this function results in a no-op.
+///
+/// @param[in]      head_tracker            Head tracker object pointer.
+/// @param[in]      model                   Prediction model.
+void CardboardHeadTracker_setRotationPredictionModel(
+    CardboardHeadTracker* head_tracker, CardboardRotationPredictionModel model);
+
 /// Recenters the head tracker.
 ///
 /// @details        By recentering, the @p head_tracker orientation gets aligned
-///                 with a zero yaw angle.
+///                 with a zero yaw angle. The pitch and roll angles are not
+///                 changed, and tracking is not interrupted.
 ///
 /// @pre @p head_tracker Must not be null.
+/// When it is unmet, a call to this function results in a no-op.
 ///
 /// @param[in]      head_tracker            Head tracker object pointer.
 void CardboardHeadTracker_recenter(CardboardHeadTracker* head_tracker);
 
+/// Gets the current estimate of the offset between the clock stamping the
+/// sensor events and the clock of the pose timestamps, for diagnostics.
+///
+/// @details The pose clock time of a sensor event is its sensor timestamp plus
+///          @p offset_ns, plus @p skew times the sensor time elapsed since the
+///          estimate was made. Both are zero on devices stamping sensor events
+///          in the pose clock.
+///
+/// @pre @p head_tracker Must not be null.
+/// @pre @p offset_ns Must not be null.
+/// @pre @p skew Must not be null.
+/// When it is unmet, a call to this function results in a no-op and 0 is
+/// returned.
+///
+/// @param[in]      head_tracker            Head tracker object pointer.
+/// @param[out]     offset_ns               Offset in nanoseconds.
+/// @param[out]     skew                    Drift of the pose clock, in
+///                                         nanoseconds per nanosecond of sensor
+///                                         time.
+/// @return         1 if an estimate is available, 0 otherwise.
+int32_t CardboardHeadTracker_getSensorClockOffset(
+    CardboardHeadTracker* head_tracker, int64_t* offset_ns, double* skew);
+
+/// Reports the timing of a presented frame.
+///
+/// @details        The head tracker keeps a running estimate of the latency
+///                 between requesting the pose of a frame and displaying it,
+///                 see CardboardHeadTracker_getDisplayLatency(). All
+///                 timestamps are in the clock of
+///                 CardboardHeadTracker_getPose().
+///
+/// @pre @p head_tracker Must not be null.
+/// When it is unmet, a call to this function results in a no-op.
+///
+/// @param[in]      head_tracker                    Head tracker object
+///                                                 pointer.
+/// @param[in]      render_timestamp_ns             Time at which the pose of
+///                                                 the frame was requested.
+/// @param[in]      predicted_display_timestamp_ns  Timestamp the pose was
+///                                                 requested for.
+/// @param[in]      actual_display_timestamp_ns     Time at which the frame was
+///                                                 displayed.
+void CardboardHeadTracker_reportFramePresented(
+    CardboardHeadTracker* head_tracker, int64_t render_timestamp_ns,
+    int64_t predicted_display_timestamp_ns,
+    int64_t actual_display_timestamp_ns);
+
+/// Gets the estimated latency between requesting the pose of a frame and
+/// displaying it.
+///
+/// @details        Applications that do not know the display time of a frame
+///                 can request its pose at the current time plus this latency.
+///
+/// @pre @p head_tracker Must not be null.
+/// When it is unmet, a call to this function results in a no-op and
+/// @p default_latency_ns is returned.
+///
+/// @param[in]      head_tracker            Head tracker object pointer.
+/// @param[in]      default_latency_ns      Latency returned while no frame was
+///                                         reported.
+/// @return         Latency in nanoseconds.
+int64_t CardboardHeadTracker_getDisplayLatency(
+    CardboardHeadTracker* head_tracker, int64_t default_latency_ns);
+
+/// Gets the timing of the latest reported frames, oldest first.
+///
+/// @details        Each frame is written as three timestamps: the render time,
+///                 the predicted display time and the actual display time. At
+///                 most 128 frames are kept.
+///
+/// @pre @p head_tracker Must not be null.
+/// @pre @p frames Must not be null.
+/// When it is unmet, a call to this function results in a no-op and 0 is
+/// returned.
+///
+/// @param[in]      head_tracker            Head tracker object pointer.
+/// @param[out]     frames                  3 * @p max_frames timestamps.
+/// @param[in]      max_frames              Maximum number of frames to write.
+/// @return         Number of frames written.
+int32_t CardboardHeadTracker_getDisplayLatencyTrace(
+    CardboardHeadTracker* head_tracker, int64_t* frames, int32_t max_frames);
+
+/// Saves the state learned by the head tracker, so that a later session
+/// converges faster.
+///
+/// @details        The state holds the gyroscope bias, its uncertainty and the
+///                 gyroscope sampling period. It is a few tens of bytes, and it
+///                 is versioned and checksummed. Nothing is learned until about
+///                 a second after the head tracker is resumed.
+///
+/// @pre @p head_tracker Must not be null.
+/// When it is unmet, a call to this function results in a no-op and 0 is
+/// returned.
+///
+/// @param[in]      head_tracker            Head tracker object pointer.
+/// @param[out]     buffer                  Buffer receiving the state. May be
+///                                         null to query the size.
+/// @param[in]      buffer_size             Size of @p buffer in bytes.
+/// @return         Size of the state in bytes, or 0 if nothing was learned
+///                 yet. The state is only written when it fits into
+///                 @p buffer.
+int32_t CardboardHeadTracker_saveState(CardboardHeadTracker* head_tracker,
+                                       uint8_t* buffer, int32_t buffer_size);
+
+/// Restores a state saved by CardboardHeadTracker_saveState().
+///
+/// @details        The state is applied with the next sensor sample, which
+///                 also recenters the head tracker. A state saved on another
+///                 device must not be restored.
+///
+/// @pre @p head_tracker Must not be null.
+/// @pre @p buffer Must not be null.
+/// When it is unmet, a call to this function results in a no-op and false is
+/// returned.
+///
+/// @param[in]      head_tracker            Head tracker object pointer.
+/// @param[in]      buffer                  Saved state.
+/// @param[in]      buffer_size             Size of @p buffer in bytes.
+/// @return         false if the state is invalid, in which case it is ignored.
+bool CardboardHeadTracker_restoreState(CardboardHeadTracker* head_tracker,
+                                       const uint8_t* buffer,
+                                       int32_t buffer_size);
+
 #ifdef __cplusplus
 }
 #endif
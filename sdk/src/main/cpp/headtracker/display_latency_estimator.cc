@@ -0,0 +1,92 @@
+/*
+ * Copyright 2019 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "display_latency_estimator.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace cardboard {
+
+namespace {
+
+// Longest latency considered valid, in nanoseconds. Longer ones come from
+// dropped frames or from a frame reported twice.
+constexpr int64_t kMaxDisplayLatencyNs = 500000000;
+
+// Weight of a new frame in the moving average of the latency. The estimate
+// follows a change of frame rate or of pipeline depth within about ten frames.
+constexpr double kLatencyFilterWeight = 0.1;
+
+// Published latency estimate while no frame was added.
+constexpr int64_t kNoLatencyEstimateNs = -1;
+
+}  // namespace
+
+DisplayLatencyEstimator::DisplayLatencyEstimator()
+    : published_latency_estimate_ns_(kNoLatencyEstimateNs) {
+  Reset();
+}
+
+void DisplayLatencyEstimator::Reset() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  num_frames_ = 0;
+  latency_estimate_ns_ = 0;
+  published_latency_estimate_ns_.store(kNoLatencyEstimateNs,
+                                       std::memory_order_relaxed);
+}
+
+void DisplayLatencyEstimator::AddFrame(const DisplayLatencySample& frame) {
+  const int64_t latency_ns =
+      frame.actual_display_timestamp_ns - frame.render_timestamp_ns;
+  if (latency_ns < 0 || latency_ns > kMaxDisplayLatencyNs) {
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  trace_[num_frames_ % kTraceCapacity] = frame;
+  if (num_frames_ == 0) {
+    latency_estimate_ns_ = static_cast<double>(latency_ns);
+  } else {
+    latency_estimate_ns_ +=
+        kLatencyFilterWeight * (latency_ns - latency_estimate_ns_);
+  }
+  ++num_frames_;
+  published_latency_estimate_ns_.store(
+      static_cast<int64_t>(std::llround(latency_estimate_ns_)),
+      std::memory_order_relaxed);
+}
+
+int64_t DisplayLatencyEstimator::GetLatencyEstimateNs(
+    int64_t default_latency_ns) const {
+  const int64_t latency_estimate_ns =
+      published_latency_estimate_ns_.load(std::memory_order_relaxed);
+  return latency_estimate_ns == kNoLatencyEstimateNs ? default_latency_ns
+                                                     : latency_estimate_ns;
+}
+
+size_t DisplayLatencyEstimator::GetTrace(DisplayLatencySample* frames,
+                                         size_t max_frames) const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  const size_t num_frames =
+      std::min(max_frames, std::min(num_frames_, kTraceCapacity));
+  const size_t first_frame = num_frames_ - num_frames;
+  for (size_t i = 0; i < num_frames; ++i) {
+    frames[i] = trace_[(first_frame + i) % kTraceCapacity];
+  }
+  return num_frames;
+}
+
+}  // namespace cardboard
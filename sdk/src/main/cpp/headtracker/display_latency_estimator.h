@@ -0,0 +1,90 @@
+/*
+ * Copyright 2019 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef CARDBOARD_SDK_DISPLAY_LATENCY_ESTIMATOR_H_
+#define CARDBOARD_SDK_DISPLAY_LATENCY_ESTIMATOR_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>  // NOLINT
+
+namespace cardboard {
+
+// Timing of one presented frame. All timestamps are in nanoseconds, in the
+// clock of the pose timestamps.
+struct DisplayLatencySample {
+  // Time at which the pose of the frame was requested.
+  int64_t render_timestamp_ns;
+  // Display time the pose was predicted for.
+  int64_t predicted_display_timestamp_ns;
+  // Time at which the frame was actually displayed.
+  int64_t actual_display_timestamp_ns;
+};
+
+// Running estimate of the latency between requesting the pose of a frame and
+// displaying it, i.e. the prediction horizon the pose needs. It also keeps a
+// trace of the latest frames to compare the predicted horizon with the actual
+// one.
+//
+// This can be called from any thread. Frames are reported once per frame, so
+// a lock is cheap enough for them. The estimate is read lock-free, so that the
+// render thread never waits for a frame being reported.
+class DisplayLatencyEstimator {
+ public:
+  // Number of frames kept in the trace.
+  static constexpr size_t kTraceCapacity = 128;
+
+  DisplayLatencyEstimator();
+
+  // Forgets all frames.
+  void Reset();
+
+  // Adds a presented frame. Frames with a latency that is negative or longer
+  // than half a second are ignored.
+  //
+  // @param frame frame timing.
+  void AddFrame(const DisplayLatencySample& frame);
+
+  // Gets the smoothed latency between the pose request and the display.
+  //
+  // @param default_latency_ns latency returned while no frame was added.
+  // @return latency in nanoseconds. This method is lock-free.
+  int64_t GetLatencyEstimateNs(int64_t default_latency_ns) const;
+
+  // Gets the latest frames, oldest first.
+  //
+  // @param frames buffer receiving the frames.
+  // @param max_frames size of @p frames.
+  // @return number of frames written to @p frames.
+  size_t GetTrace(DisplayLatencySample* frames, size_t max_frames) const;
+
+ private:
+  mutable std::mutex mutex_;
+  // Ring buffer of the latest frames.
+  std::array<DisplayLatencySample, kTraceCapacity> trace_;
+  // Number of frames added since the last reset.
+  size_t num_frames_;
+  // Exponential moving average of the latency in nanoseconds.
+  double latency_estimate_ns_;
+  // Rounded latency_estimate_ns_ for GetLatencyEstimateNs(), or -1 while no
+  // frame was added.
+  std::atomic<int64_t> published_latency_estimate_ns_;
+};
+
+}  // namespace cardboard
+
+#endif  // CARDBOARD_SDK_DISPLAY_LATENCY_ESTIMATOR_H_
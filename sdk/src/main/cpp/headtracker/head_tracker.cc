@@ -14,6 +14,10 @@
  * limitations under the License.
  */
 #include "head_tracker.h"
+
+#include <chrono>  // NOLINT
+#include <cstring>
+
 #include "cardboard.h"
 #include "../sensors/neck_model.h"
 #include "../util/logging.h"
@@ -22,13 +26,51 @@
 #include "../util/vectorutils.h"
 
 namespace cardboard {
+
+namespace {
+
+// Sampling period used by kTrackingQosReduced. This corresponds to 100 Hz.
+constexpr int32_t kReducedSamplingPeriodUs = 10000;
+// Sampling period used by kTrackingQosBackgroundBatched. This corresponds to
+// 50 Hz.
+constexpr int32_t kBatchedSamplingPeriodUs = 20000;
+// Maximum report latency used by kTrackingQosBackgroundBatched.
+constexpr int64_t kBatchedMaxReportLatencyUs = 100000;
+
+// Default time samples may be held to merge the sensor streams. This covers
+// the delivery jitter of the sensor hub without adding noticeable latency.
+constexpr int64_t kDefaultReorderLatencyBudgetNs = 20000000;
+
+// Returns the current time of the clock used to measure the fusion thread
+// wake-up latency.
+int64_t GetSteadyClockNanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Returns the sensor sampling of a tracking QoS level.
+SensorSamplingConfig GetSensorSamplingConfig(CardboardTrackingQos qos) {
+  switch (qos) {
+    case kTrackingQosReduced:
+      return {kReducedSamplingPeriodUs, 0};
+    case kTrackingQosBackgroundBatched:
+      return {kBatchedSamplingPeriodUs, kBatchedMaxReportLatencyUs};
+    case kTrackingQosFull:
+    default:
+      return kFastestSensorSamplingConfig;
+  }
+}
+
+}  // namespace
+
 // @{ Hold rotations to adapt the pose estimation to the viewport and head
 // poses. Use the following indexing for each viewport orientation:
 // [0]: Landscape left.
 // [1]: Landscape right.
 // [2]: Portrait.
 // [3]: Portrait upside down.
-static std::array<Rotation, 4> SensorToDisplayRotations() {
+static const std::array<Rotation, 4>& SensorToDisplayRotations() {
   static std::array<Rotation, 4> kSensorToDisplayRotations{
       // LandscapeLeft: This is the same than initializing the rotation from
       // Rotation::FromAxisAndAngle(Vector3(0., 0., 1.), M_PI / 2.).
@@ -47,7 +89,7 @@ static std::array<Rotation, 4> SensorToDisplayRotations() {
   return kSensorToDisplayRotations;
 }
 
-static std::array<Rotation, 4> EkfToHeadTrackerRotations() {
+static const std::array<Rotation, 4>& EkfToHeadTrackerRotations() {
   static std::array<Rotation, 4> kEkfToHeadTrackerRotations{
       // LandscapeLeft: This is the same than initializing the rotation from
       // Rotation::FromYawPitchRoll(-M_PI / 2., 0, -M_PI / 2.).
@@ -112,22 +154,43 @@ ViewportChangeRotationCompensation() {
   return kViewportChangeRotationCompensation;
 }
 
-HeadTracker::HeadTracker()
+HeadTracker::HeadTracker(SensorFusionStateModel state_model)
     : is_tracking_(false),
-      sensor_fusion_(new SensorFusionEkf()),
-      latest_gyroscope_data_({0, 0, Vector3::Zero()}),
-      accel_sensor_(new SensorEventProducer<AccelerometerData>()),
-      gyro_sensor_(new SensorEventProducer<GyroscopeData>()),
+      sensor_fusion_(new SensorFusion(state_model)),
+      latest_gyroscope_data_({0, 0, Vector3::Zero(), false, Vector3::Zero()}),
+      latest_gyroscope_period_ns_(0),
+      is_prediction_stopped_(false),
+      sensor_hub_(new SensorHub()),
+      reorder_buffer_(kDefaultReorderLatencyBudgetNs),
+      reorder_latency_budget_ns_(kDefaultReorderLatencyBudgetNs),
+      num_reported_dropped_samples_(0),
+      run_fusion_thread_(false),
+      has_queued_samples_(false),
+      has_pending_settings_(false),
+      is_pause_requested_(false),
+      has_sensor_restart_(false),
+      first_pending_notification_ns_(0),
+      fusion_thread_policy_(kDefaultThreadPolicy),
+      accelerometer_correction_schedule_(kEverySampleCorrectionSchedule),
+      requested_tracking_qos_(kTrackingQosFull),
+      applied_tracking_qos_(kTrackingQosFull),
       is_viewport_orientation_initialized_(false) {
-  on_accel_callback_ = [&](const AccelerometerData& event) {
-    OnAccelerometerData(event);
+  on_accel_callback_ = [&](const AccelerometerData* events,
+                           size_t num_events) {
+    accel_queue_.Push(events, num_events);
+    NotifyFusionThread();
   };
-  on_gyro_callback_ = [&](const GyroscopeData& event) {
-    OnGyroscopeData(event);
+  on_gyro_callback_ = [&](const GyroscopeData* events, size_t num_events) {
+    gyro_queue_.Push(events, num_events);
+    NotifyFusionThread();
   };
+  StartFusionThread();
 }
 
-HeadTracker::~HeadTracker() { UnregisterCallbacks(); }
+HeadTracker::~HeadTracker() {
+  UnregisterCallbacks();
+  StopFusionThread();
+}
 
 void HeadTracker::Pause() {
   if (!is_tracking_) {
@@ -136,17 +199,24 @@ void HeadTracker::Pause() {
 
   UnregisterCallbacks();
 
-  // Create a gyro event with zero velocity. This effectively stops the
-  // prediction.
-  GyroscopeData event = latest_gyroscope_data_;
-  event.data = Vector3::Zero();
-
-  OnGyroscopeData(event);
+  // The fusion thread stops the prediction once the samples queued so far are
+  // processed. Pausing does not wait for it.
+  {
+    std::unique_lock<std::mutex> lock(fusion_thread_mutex_);
+    is_pause_requested_ = true;
+    has_sensor_restart_ = true;
+  }
+  fusion_thread_condition_.notify_one();
 
   is_tracking_ = false;
 }
 
 void HeadTracker::Resume() {
+  {
+    std::unique_lock<std::mutex> lock(fusion_thread_mutex_);
+    // A pause that was not applied yet is obsolete.
+    is_pause_requested_ = false;
+  }
   is_tracking_ = true;
   RegisterCallbacks();
 }
@@ -155,67 +225,361 @@ void HeadTracker::GetPose(int64_t timestamp_ns,
                           CardboardViewportOrientation viewport_orientation,
                           std::array<float, 3>& out_position,
                           std::array<float, 4>& out_orientation) {
-  const Vector4 orientation =
-      GetRotation(viewport_orientation, timestamp_ns).GetQuaternion();
+  GetPoses(&timestamp_ns, &viewport_orientation, 1, out_position.data(),
+           out_orientation.data());
+}
 
-  if (is_viewport_orientation_initialized_ &&
-      viewport_orientation != viewport_orientation_) {
-    sensor_fusion_->RotateSensorSpaceToStartSpaceTransformation(
-        ViewportChangeRotationCompensation()[viewport_orientation_]
-                                            [viewport_orientation]);
-  }
-  viewport_orientation_ = viewport_orientation;
-  is_viewport_orientation_initialized_ = true;
+void HeadTracker::GetPoses(
+    const int64_t* timestamps_ns,
+    const CardboardViewportOrientation* viewport_orientations,
+    size_t num_poses, float* out_positions, float* out_orientations,
+    float* out_angular_uncertainties) {
+  const RotationState state = sensor_fusion_->GetLatestRotationState();
+  const std::array<Rotation, 4>& sensor_to_display_rotations =
+      SensorToDisplayRotations();
+  const std::array<Rotation, 4>& ekf_to_head_tracker_rotations =
+      EkfToHeadTrackerRotations();
+
+  for (size_t i = 0; i < num_poses; ++i) {
+    const CardboardViewportOrientation viewport_orientation =
+        viewport_orientations[i];
+    // In order to update our pose as the sensor changes, we begin with the
+    // inverse default orientation (the orientation returned by a reset sensor,
+    // i.e. since the last Reset() call), apply the current sensor
+    // transformation, and then transform into display space.
+    const Vector4 orientation =
+        (sensor_to_display_rotations[viewport_orientation] *
+         sensor_fusion_->PredictRotation(state, timestamps_ns[i]) *
+         ekf_to_head_tracker_rotations[viewport_orientation])
+            .GetQuaternion();
+
+    if (is_viewport_orientation_initialized_ &&
+        viewport_orientation != viewport_orientation_) {
+      sensor_fusion_->RotateSensorSpaceToStartSpaceTransformation(
+          ViewportChangeRotationCompensation()[viewport_orientation_]
+                                              [viewport_orientation]);
+      // Applies the compensation even if no sample follows, e.g. while
+      // paused.
+      NotifyFusionThreadOfSettings();
+    }
+    viewport_orientation_ = viewport_orientation;
+    is_viewport_orientation_initialized_ = true;
 
-  out_orientation[0] = static_cast<float>(orientation[0]);
-  out_orientation[1] = static_cast<float>(orientation[1]);
-  out_orientation[2] = static_cast<float>(orientation[2]);
-  out_orientation[3] = static_cast<float>(orientation[3]);
+    const std::array<float, 4> out_orientation = {
+        static_cast<float>(orientation[0]), static_cast<float>(orientation[1]),
+        static_cast<float>(orientation[2]), static_cast<float>(orientation[3])};
+    const std::array<float, 3> out_position =
+        ApplyNeckModel(out_orientation, 1.0);
+    std::memcpy(out_orientations + 4 * i, out_orientation.data(),
+                sizeof(out_orientation));
+    std::memcpy(out_positions + 3 * i, out_position.data(),
+                sizeof(out_position));
 
-  out_position = ApplyNeckModel(out_orientation, 1.0);
+    if (out_angular_uncertainties != nullptr) {
+      out_angular_uncertainties[i] = static_cast<float>(
+          sensor_fusion_->GetRotationUncertainty(state, timestamps_ns[i]));
+    }
+  }
 }
 
 void HeadTracker::Recenter() {
+  sensor_fusion_->RecenterYaw();
+  // Applies the recenter even if no sample follows, e.g. while paused.
+  NotifyFusionThreadOfSettings();
+}
+
+void HeadTracker::Reset() {
   sensor_fusion_->Reset();
 }
 
+void HeadTracker::ReportFramePresented(const DisplayLatencySample& frame) {
+  display_latency_estimator_.AddFrame(frame);
+}
+
+int64_t HeadTracker::GetDisplayLatencyEstimateNs(
+    int64_t default_latency_ns) const {
+  return display_latency_estimator_.GetLatencyEstimateNs(default_latency_ns);
+}
+
+size_t HeadTracker::GetDisplayLatencyTrace(DisplayLatencySample* frames,
+                                           size_t max_frames) const {
+  return display_latency_estimator_.GetTrace(frames, max_frames);
+}
+
+void HeadTracker::SetRotationPredictionModel(RotationPredictionModel model) {
+  sensor_fusion_->SetRotationPredictionModel(model);
+}
+
+size_t HeadTracker::SaveState(uint8_t* buffer, size_t buffer_size) const {
+  SensorFusionSnapshot snapshot;
+  if (!sensor_fusion_->GetSnapshot(&snapshot)) {
+    return 0;
+  }
+  if (buffer != nullptr && buffer_size >= kSerializedSensorFusionSnapshotSize) {
+    SerializeSensorFusionSnapshot(snapshot, buffer);
+  }
+  return kSerializedSensorFusionSnapshotSize;
+}
+
+bool HeadTracker::RestoreState(const uint8_t* buffer, size_t buffer_size) {
+  SensorFusionSnapshot snapshot;
+  if (!DeserializeSensorFusionSnapshot(buffer, buffer_size, &snapshot)) {
+    CARDBOARD_LOGE("HeadTracker: Ignoring invalid saved state.");
+    return false;
+  }
+  sensor_fusion_->RestoreSnapshot(snapshot);
+  return true;
+}
+
+void HeadTracker::SetTrackingQos(CardboardTrackingQos qos) {
+  requested_tracking_qos_ = qos;
+  NotifyFusionThreadOfSettings();
+}
+
+void HeadTracker::SetThreadPolicies(const ThreadPolicy& sensor_thread_policy,
+                                    const ThreadPolicy& fusion_thread_policy) {
+  sensor_hub_->SetThreadPolicy(sensor_thread_policy);
+  {
+    std::unique_lock<std::mutex> lock(fusion_thread_mutex_);
+    fusion_thread_policy_ = fusion_thread_policy;
+  }
+  NotifyFusionThreadOfSettings();
+}
+
+void HeadTracker::SetAccelerometerCorrectionSchedule(
+    const AccelerometerCorrectionSchedule& schedule) {
+  {
+    std::unique_lock<std::mutex> lock(fusion_thread_mutex_);
+    accelerometer_correction_schedule_ = schedule;
+  }
+  NotifyFusionThreadOfSettings();
+}
+
+void HeadTracker::SetReorderLatencyBudget(int64_t latency_budget_ns) {
+  reorder_latency_budget_ns_ = latency_budget_ns;
+}
+
+SensorReorderStatistics HeadTracker::GetReorderStatistics() const {
+  return reorder_buffer_.GetStatistics();
+}
+
+ClockOffsetEstimate HeadTracker::GetSensorClockOffsetEstimate() const {
+  return sensor_hub_->GetClockOffsetEstimate();
+}
+
+LatencyHistogram::Snapshot HeadTracker::GetSensorDeliveryLatencyHistogram()
+    const {
+  return sensor_hub_->GetDeliveryLatencyHistogram();
+}
+
+LatencyHistogram::Snapshot HeadTracker::GetFusionWakeUpLatencyHistogram()
+    const {
+  return fusion_wake_up_latency_histogram_.GetSnapshot();
+}
+
 void HeadTracker::RegisterCallbacks() {
-  accel_sensor_->StartSensorPolling(&on_accel_callback_);
-  gyro_sensor_->StartSensorPolling(&on_gyro_callback_);
+  sensor_hub_->StartSensorPolling(&on_accel_callback_, &on_gyro_callback_);
+}
+
+void HeadTracker::UnregisterCallbacks() { sensor_hub_->StopSensorPolling(); }
+
+void HeadTracker::StartFusionThread() {
+  std::unique_lock<std::mutex> lock(fusion_thread_mutex_);
+  // If the thread is started already there is nothing left to do.
+  if (run_fusion_thread_) {
+    return;
+  }
+  run_fusion_thread_ = true;
+  fusion_thread_.reset(new std::thread([&]() { FusionWorkFn(); }));
 }
 
-void HeadTracker::UnregisterCallbacks() {
-  accel_sensor_->StopSensorPolling();
-  gyro_sensor_->StopSensorPolling();
+void HeadTracker::StopFusionThread() {
+  {
+    std::unique_lock<std::mutex> lock(fusion_thread_mutex_);
+    if (!run_fusion_thread_) {
+      return;
+    }
+    run_fusion_thread_ = false;
+  }
+  fusion_thread_condition_.notify_one();
+  fusion_thread_->join();
+  fusion_thread_.reset();
 }
 
-void HeadTracker::OnAccelerometerData(const AccelerometerData& event) {
-  if (!is_tracking_) {
+void HeadTracker::NotifyFusionThread() {
+  {
+    std::unique_lock<std::mutex> lock(fusion_thread_mutex_);
+    if (!has_queued_samples_) {
+      first_pending_notification_ns_ = GetSteadyClockNanos();
+    }
+    has_queued_samples_ = true;
+  }
+  fusion_thread_condition_.notify_one();
+}
+
+void HeadTracker::NotifyFusionThreadOfSettings() {
+  {
+    std::unique_lock<std::mutex> lock(fusion_thread_mutex_);
+    has_pending_settings_ = true;
+  }
+  fusion_thread_condition_.notify_one();
+}
+
+void HeadTracker::FusionWorkFn() {
+  ThreadPolicy thread_policy = kDefaultThreadPolicy;
+  bool run_thread = true;
+  while (run_thread) {
+    bool is_pause_requested;
+    bool has_sensor_restart;
+    ThreadPolicy requested_thread_policy;
+    AccelerometerCorrectionSchedule correction_schedule;
+    {
+      std::unique_lock<std::mutex> lock(fusion_thread_mutex_);
+      fusion_thread_condition_.wait(lock, [this]() {
+        return has_queued_samples_ || has_pending_settings_ ||
+               is_pause_requested_ || !run_fusion_thread_;
+      });
+      if (has_queued_samples_) {
+        fusion_wake_up_latency_histogram_.Record(
+            GetSteadyClockNanos() - first_pending_notification_ns_);
+      }
+      requested_thread_policy = fusion_thread_policy_;
+      correction_schedule = accelerometer_correction_schedule_;
+      has_queued_samples_ = false;
+      has_pending_settings_ = false;
+      is_pause_requested = is_pause_requested_;
+      is_pause_requested_ = false;
+      has_sensor_restart = has_sensor_restart_;
+      has_sensor_restart_ = false;
+      run_thread = run_fusion_thread_;
+    }
+    if (requested_thread_policy != thread_policy) {
+      thread_policy = requested_thread_policy;
+      ApplyThreadPolicy(thread_policy);
+    }
+    sensor_fusion_->SetAccelerometerCorrectionSchedule(correction_schedule);
+    // Samples queued before stopping are still processed.
+    ProcessQueuedSamples();
+    UpdateTrackingQos();
+    if (is_pause_requested) {
+      StopPrediction();
+    }
+    sensor_fusion_->ApplyPendingStartSpaceRotation();
+    if (has_sensor_restart) {
+      // The sensor clock may restart with the sensors, so the next samples are
+      // not ordered against the previous ones.
+      ProcessAllReorderedSamples();
+      reorder_buffer_.Reset();
+    }
+  }
+}
+
+void HeadTracker::UpdateTrackingQos() {
+  CardboardTrackingQos qos = requested_tracking_qos_;
+  // Hardware batching would delay the detection of motion, so a static device
+  // only lowers the sampling rate.
+  if (qos == kTrackingQosFull && sensor_fusion_->IsDeviceStatic()) {
+    qos = kTrackingQosReduced;
+  }
+  if (qos == applied_tracking_qos_) {
     return;
   }
-  sensor_fusion_->ProcessAccelerometerSample(event);
+  applied_tracking_qos_ = qos;
+  sensor_hub_->SetSamplingConfig(GetSensorSamplingConfig(qos));
 }
 
-void HeadTracker::OnGyroscopeData(const GyroscopeData& event) {
-  if (!is_tracking_) {
+void HeadTracker::StopPrediction() {
+  // Samples held for reordering come before the pause.
+  ProcessAllReorderedSamples();
+
+  if (latest_gyroscope_data_.sensor_timestamp_ns == 0) {
     return;
   }
-  latest_gyroscope_data_ = event;
+  // Create a gyro event with zero velocity. This effectively stops the
+  // prediction. Sensor fusion discards events that are not newer than the last
+  // processed one, so the event is dated one gyroscope period later.
+  const uint64_t period_ns =
+      latest_gyroscope_period_ns_ > 0 ? latest_gyroscope_period_ns_ : 1;
+  GyroscopeData event = latest_gyroscope_data_;
+  event.system_timestamp += period_ns;
+  event.sensor_timestamp_ns += period_ns;
+  event.data = Vector3::Zero();
+
   sensor_fusion_->ProcessGyroscopeSample(event);
+  latest_gyroscope_data_ = event;
+  is_prediction_stopped_ = true;
 }
 
-Rotation HeadTracker::GetRotation(
-    CardboardViewportOrientation viewport_orientation,
-    int64_t timestamp_ns) const {
-  const Rotation predicted_rotation =
-      sensor_fusion_->PredictRotation(timestamp_ns);
+void HeadTracker::ProcessAllReorderedSamples() {
+  reorder_buffer_.ReleaseAllSamples(
+      [&](const AccelerometerData* samples, size_t num_samples) {
+        ProcessAccelerometerSamples(samples, num_samples);
+      },
+      [&](const GyroscopeData* samples, size_t num_samples) {
+        ProcessGyroscopeSamples(samples, num_samples);
+      });
+}
+
+void HeadTracker::ProcessQueuedSamples() {
+  size_t num_samples;
+  do {
+    num_samples = accel_queue_.Pop(accel_batch_.data(), accel_batch_.size());
+    reorder_buffer_.AddAccelerometerSamples(accel_batch_.data(), num_samples);
+  } while (num_samples == accel_batch_.size());
+  do {
+    num_samples = gyro_queue_.Pop(gyro_batch_.data(), gyro_batch_.size());
+    reorder_buffer_.AddGyroscopeSamples(gyro_batch_.data(), num_samples);
+  } while (num_samples == gyro_batch_.size());
 
-  // In order to update our pose as the sensor changes, we begin with the
-  // inverse default orientation (the orientation returned by a reset sensor,
-  // i.e. since the last Reset() call), apply the current sensor transformation,
-  // and then transform into display space.
-  return SensorToDisplayRotations()[viewport_orientation] * predicted_rotation *
-         EkfToHeadTrackerRotations()[viewport_orientation];
+  reorder_buffer_.SetLatencyBudget(reorder_latency_budget_ns_);
+  reorder_buffer_.ReleaseSamples(
+      [&](const AccelerometerData* samples, size_t num_samples) {
+        ProcessAccelerometerSamples(samples, num_samples);
+      },
+      [&](const GyroscopeData* samples, size_t num_samples) {
+        ProcessGyroscopeSamples(samples, num_samples);
+      });
+
+  const uint64_t num_dropped_samples =
+      accel_queue_.GetDroppedCount() + gyro_queue_.GetDroppedCount();
+  if (num_dropped_samples != num_reported_dropped_samples_) {
+    CARDBOARD_LOGE(
+        "HeadTracker: Sensor fusion is falling behind, %llu samples dropped "
+        "so far.",
+        static_cast<unsigned long long>(num_dropped_samples));
+    num_reported_dropped_samples_ = num_dropped_samples;
+  }
+}
+
+void HeadTracker::ProcessAccelerometerSamples(
+    const AccelerometerData* samples, size_t num_samples) {
+  for (size_t i = 0; i < num_samples; ++i) {
+    OnAccelerometerData(samples[i]);
+  }
+}
+
+void HeadTracker::ProcessGyroscopeSamples(const GyroscopeData* samples,
+                                          size_t num_samples) {
+  for (size_t i = 0; i < num_samples; ++i) {
+    OnGyroscopeData(samples[i]);
+  }
+}
+
+void HeadTracker::OnAccelerometerData(const AccelerometerData& event) {
+  sensor_fusion_->ProcessAccelerometerSample(event);
+}
+
+void HeadTracker::OnGyroscopeData(const GyroscopeData& event) {
+  // The gap since the zero velocity event of a pause is not a sensor period.
+  if (!is_prediction_stopped_ &&
+      latest_gyroscope_data_.sensor_timestamp_ns != 0 &&
+      event.sensor_timestamp_ns > latest_gyroscope_data_.sensor_timestamp_ns) {
+    latest_gyroscope_period_ns_ =
+        event.sensor_timestamp_ns - latest_gyroscope_data_.sensor_timestamp_ns;
+  }
+  is_prediction_stopped_ = false;
+  latest_gyroscope_data_ = event;
+  sensor_fusion_->ProcessGyroscopeSample(event);
 }
 
 }  // namespace cardboard
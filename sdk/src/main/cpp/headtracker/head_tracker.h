@@ -17,15 +17,26 @@
 #define CARDBOARD_SDK_HEAD_TRACKER_H_
 
 #include <array>
+#include <condition_variable>  // NOLINT
+#include <cstdint>
 #include <memory>
-#include <mutex>  // NOLINT
+#include <mutex>   // NOLINT
+#include <thread>  // NOLINT
 
 #include "cardboard.h"
+#include "display_latency_estimator.h"
+#include "../sensors/accelerometer_correction_schedule.h"
 #include "../sensors/accelerometer_data.h"
+#include "../sensors/clock_offset_estimator.h"
 #include "../sensors/gyroscope_data.h"
-#include "../sensors/sensor_event_producer.h"
+#include "../sensors/sensor_event_batch.h"
 #include "../sensors/sensor_fusion_ekf.h"
+#include "../sensors/sensor_hub.h"
+#include "../sensors/sensor_reorder_buffer.h"
 #include "../util/rotation.h"
+#include "../util/latency_histogram.h"
+#include "../util/spsc_ring_buffer.h"
+#include "../util/thread_policy.h"
 
 namespace cardboard {
 
@@ -34,24 +45,146 @@ namespace cardboard {
 // This pose tracker reports poses in display space.
 class HeadTracker {
  public:
-  HeadTracker();
+  // @param state_model state vector of the sensor fusion filter.
+  explicit HeadTracker(
+      SensorFusionStateModel state_model = kRotationStateModel);
   virtual ~HeadTracker();
 
-  // Pauses tracking and sensors.
+  // Pauses tracking and sensors. The worker threads are parked, so this method
+  // does not wait for them.
   void Pause();
 
-  // Resumes tracking and sensors.
+  // Resumes tracking and sensors by waking up the parked worker threads.
   void Resume();
 
-  // Gets the predicted pose for a given timestamp.
+  // Gets the predicted pose for a given timestamp. It must always be called
+  // from the same thread (e.g. the render thread).
   void GetPose(int64_t timestamp_ns,
                CardboardViewportOrientation viewport_orientation,
                std::array<float, 3>& out_position,
                std::array<float, 4>& out_orientation);
 
-  // Recenters the head tracker.
+  // Gets the predicted poses for several timestamps, e.g. one per eye. They are
+  // all extrapolated from the same sensor fusion state, whereas successive
+  // GetPose() calls may straddle a sensor sample. It must be called from the
+  // same thread as GetPose().
+  //
+  // @param timestamps_ns timestamps of the poses.
+  // @param viewport_orientations viewport orientation of each pose.
+  // @param num_poses number of poses.
+  // @param out_positions receives the position of each pose as 3 packed
+  //     floats, i.e. 3 * num_poses floats.
+  // @param out_orientations receives the orientation of each pose as 4 packed
+  //     floats, i.e. 4 * num_poses floats.
+  // @param out_angular_uncertainties receives the angular uncertainty of each
+  //     pose in radians, see SensorFusionEkfT::GetRotationUncertainty(). It
+  //     may be null.
+  void GetPoses(const int64_t* timestamps_ns,
+                const CardboardViewportOrientation* viewport_orientations,
+                size_t num_poses, float* out_positions,
+                float* out_orientations,
+                float* out_angular_uncertainties = nullptr);
+
+  // Recenters the head tracker, i.e. re-zeroes its yaw angle. The tilt and the
+  // state learned by sensor fusion are kept.
   void Recenter();
 
+  // Resets the head tracker. The orientation is aligned again with gravity
+  // from the next accelerometer samples. The state learned by sensor fusion is
+  // kept.
+  void Reset();
+
+  // Sets the tracking QoS level. It is applied asynchronously by the fusion
+  // thread.
+  //
+  // @param qos requested level.
+  void SetTrackingQos(CardboardTrackingQos qos);
+
+  // Sets the scheduling policies of the worker threads. They are applied
+  // asynchronously by the threads themselves.
+  //
+  // @param sensor_thread_policy policy of the sensor capture thread.
+  // @param fusion_thread_policy policy of the sensor fusion thread.
+  void SetThreadPolicies(const ThreadPolicy& sensor_thread_policy,
+                         const ThreadPolicy& fusion_thread_policy);
+
+  // Sets how long samples may be held to merge the accelerometer and the
+  // gyroscope streams by sensor timestamp before sensor fusion.
+  //
+  // @param latency_budget_ns latency budget in nanoseconds.
+  void SetReorderLatencyBudget(int64_t latency_budget_ns);
+
+  // Sets the schedule of the gravity corrections of sensor fusion. It is
+  // applied asynchronously by the fusion thread. The default is
+  // kEverySampleCorrectionSchedule.
+  //
+  // @param schedule correction schedule.
+  void SetAccelerometerCorrectionSchedule(
+      const AccelerometerCorrectionSchedule& schedule);
+
+  // Reports the timing of a presented frame, which updates the estimate of the
+  // display latency.
+  //
+  // @param frame frame timing, in the clock of the pose timestamps.
+  void ReportFramePresented(const DisplayLatencySample& frame);
+
+  // Gets the smoothed latency between requesting a pose and displaying the
+  // frame, i.e. the horizon to request poses at when the display time is not
+  // known.
+  //
+  // @param default_latency_ns latency returned while no frame was reported.
+  // @return latency in nanoseconds.
+  int64_t GetDisplayLatencyEstimateNs(int64_t default_latency_ns) const;
+
+  // Gets the timing of the latest reported frames, oldest first, for
+  // diagnostics.
+  //
+  // @param frames buffer receiving the frames.
+  // @param max_frames size of @p frames.
+  // @return number of frames written to @p frames.
+  size_t GetDisplayLatencyTrace(DisplayLatencySample* frames,
+                                size_t max_frames) const;
+
+  // Sets the model extrapolating the rotation to the requested pose timestamp.
+  // The default is kRotationPredictionConstantVelocity.
+  //
+  // @param model prediction model.
+  void SetRotationPredictionModel(RotationPredictionModel model);
+
+  // Saves the state learned by sensor fusion (gyroscope bias, uncertainty and
+  // sampling period) so that the next session starts from it.
+  //
+  // @param buffer buffer receiving the serialized state. It may be null to
+  //     query the size.
+  // @param buffer_size size of @p buffer in bytes.
+  // @return size of the serialized state, or 0 if nothing was learned yet. The
+  //     state is only written when it fits into @p buffer.
+  size_t SaveState(uint8_t* buffer, size_t buffer_size) const;
+
+  // Restores a state saved by SaveState(). It is applied with the next
+  // accelerometer sample, which also resets the tracked rotation.
+  //
+  // @param buffer serialized state.
+  // @param buffer_size size of @p buffer in bytes.
+  // @return false if the state is invalid, in which case it is ignored.
+  bool RestoreState(const uint8_t* buffer, size_t buffer_size);
+
+  // Gets the number of samples reordered or dropped while merging the sensor
+  // streams, for diagnostics.
+  SensorReorderStatistics GetReorderStatistics() const;
+
+  // Gets the current estimate of the offset between the sensor clock and the
+  // clock of the pose timestamps, for diagnostics.
+  ClockOffsetEstimate GetSensorClockOffsetEstimate() const;
+
+  // Gets the histogram of the delays between the sensor events and the moment
+  // the capture thread read them, for diagnostics.
+  LatencyHistogram::Snapshot GetSensorDeliveryLatencyHistogram() const;
+
+  // Gets the histogram of the delays between the capture thread queueing
+  // samples and the fusion thread waking up to process them, for diagnostics.
+  LatencyHistogram::Snapshot GetFusionWakeUpLatencyHistogram() const;
+
  private:
   // Function called when receiving AccelerometerData.
   //
@@ -72,24 +205,121 @@ class HeadTracker {
   // polling for data.
   void UnregisterCallbacks();
 
-  // Gets the predicted rotation for a given timestamp and viewport orientation.
-  Rotation GetRotation(CardboardViewportOrientation viewport_orientation,
-                       int64_t timestamp_ns) const;
+  // Starts the thread feeding the queued sensor samples to sensor fusion. The
+  // thread lives as long as this object and is parked while paused.
+  void StartFusionThread();
+  // Stops the fusion thread once all queued samples have been processed. This
+  // method blocks until the thread is finished.
+  void StopFusionThread();
+  // Worker method of the fusion thread.
+  void FusionWorkFn();
+  // Applies the sensor sampling of the requested tracking QoS level, lowered
+  // while the device is static. Called from the fusion thread.
+  void UpdateTrackingQos();
+  // Processes a zero velocity gyroscope event so that the rotation is not
+  // extrapolated while paused. Called from the fusion thread.
+  void StopPrediction();
+  // Wakes up the fusion thread. Called from the sensor capture thread.
+  void NotifyFusionThread();
+  // Wakes up the fusion thread to apply changed settings. Unlike
+  // NotifyFusionThread(), the wake-up latency is not recorded.
+  void NotifyFusionThreadOfSettings();
+  // Drains both sample queues into the reorder buffer and feeds the samples it
+  // releases to sensor fusion. Called from the fusion thread.
+  void ProcessQueuedSamples();
+  // Feeds all the samples held by the reorder buffer to sensor fusion. Called
+  // from the fusion thread.
+  void ProcessAllReorderedSamples();
+  // Feeds a batch of samples to sensor fusion.
+  void ProcessAccelerometerSamples(const AccelerometerData* samples,
+                                   size_t num_samples);
+  void ProcessGyroscopeSamples(const GyroscopeData* samples,
+                               size_t num_samples);
+
+  // Capacity of each queue between the sensor capture thread and the fusion
+  // thread. It holds about half a second of samples at 500 Hz.
+  static constexpr size_t kSensorQueueCapacity = 256;
+
+  // Sensor fusion precision, selected at build time. See SensorFusionEkfT for
+  // the accuracy of the single precision filter.
+#ifdef CARDBOARD_SINGLE_PRECISION_SENSOR_FUSION
+  typedef SensorFusionEkff SensorFusion;
+#else
+  typedef SensorFusionEkf SensorFusion;
+#endif
 
   std::atomic<bool> is_tracking_;
   // Sensor Fusion object that stores the internal state of the filter.
-  std::unique_ptr<SensorFusionEkf> sensor_fusion_;
-  // Latest gyroscope data.
+  std::unique_ptr<SensorFusion> sensor_fusion_;
+  // Latest gyroscope data. Only accessed from the fusion thread.
   GyroscopeData latest_gyroscope_data_;
+  // Sensor time between the two latest gyroscope samples. Only accessed from
+  // the fusion thread.
+  uint64_t latest_gyroscope_period_ns_;
+  // Whether the latest gyroscope data is the zero velocity event of a pause.
+  // Only accessed from the fusion thread.
+  bool is_prediction_stopped_;
+
+  // Event provider supplying AccelerometerData and GyroscopeData to the
+  // detector from a single capture thread.
+  std::unique_ptr<SensorHub> sensor_hub_;
+
+  // Callback functions registered to the SensorHub. They only enqueue the
+  // samples so that the capture thread is never stalled by sensor fusion.
+  SensorHub::AccelerometerCallback on_accel_callback_;
+  SensorHub::GyroscopeCallback on_gyro_callback_;
+
+  // Queues carrying the samples from the sensor capture thread to the fusion
+  // thread.
+  SpscRingBuffer<AccelerometerData, kSensorQueueCapacity> accel_queue_;
+  SpscRingBuffer<GyroscopeData, kSensorQueueCapacity> gyro_queue_;
+  // Batches popped from the queues by the fusion thread.
+  SensorEventBatch<AccelerometerData> accel_batch_;
+  SensorEventBatch<GyroscopeData> gyro_batch_;
+  // Merges the samples of both queues by sensor timestamp. Only accessed from
+  // the fusion thread, except for its statistics.
+  SensorReorderBuffer reorder_buffer_;
+  // Latency budget requested for reorder_buffer_ in nanoseconds.
+  std::atomic<int64_t> reorder_latency_budget_ns_;
+  // Number of dropped samples already reported by the fusion thread.
+  uint64_t num_reported_dropped_samples_;
+
+  // Thread running sensor fusion while tracking.
+  std::unique_ptr<std::thread> fusion_thread_;
+  // Guards the fusion thread wakeup. It is never held while samples are
+  // processed.
+  std::mutex fusion_thread_mutex_;
+  std::condition_variable fusion_thread_condition_;
+  // Flags guarded by fusion_thread_mutex_.
+  bool run_fusion_thread_;
+  bool has_queued_samples_;
+  bool has_pending_settings_;
+  bool is_pause_requested_;
+  // Whether the sensors were stopped since the fusion thread last woke up.
+  // Unlike is_pause_requested_, it is kept by Resume().
+  bool has_sensor_restart_;
+  // Time of the first notification not handled yet by the fusion thread, in
+  // steady clock nanoseconds. Guarded by fusion_thread_mutex_.
+  int64_t first_pending_notification_ns_;
+  // Requested scheduling policy of the fusion thread. Guarded by
+  // fusion_thread_mutex_.
+  ThreadPolicy fusion_thread_policy_;
+  // Requested schedule of the accelerometer corrections. Guarded by
+  // fusion_thread_mutex_.
+  AccelerometerCorrectionSchedule accelerometer_correction_schedule_;
+  // Delay between NotifyFusionThread() and the fusion thread waking up.
+  // Updated by the fusion thread.
+  LatencyHistogram fusion_wake_up_latency_histogram_;
 
-  // Event providers supplying AccelerometerData and GyroscopeData to the
-  // detector.
-  std::shared_ptr<SensorEventProducer<AccelerometerData>> accel_sensor_;
-  std::shared_ptr<SensorEventProducer<GyroscopeData>> gyro_sensor_;
+  // Latency between the pose requests and the display of the frames, reported
+  // by the application.
+  DisplayLatencyEstimator display_latency_estimator_;
 
-  // Callback functions registered to the input SingleTypeEventProducer.
-  std::function<void(AccelerometerData)> on_accel_callback_;
-  std::function<void(GyroscopeData)> on_gyro_callback_;
+  // Tracking QoS level requested by the user.
+  std::atomic<CardboardTrackingQos> requested_tracking_qos_;
+  // Tracking QoS level applied to the sensors. Only accessed from the fusion
+  // thread.
+  CardboardTrackingQos applied_tracking_qos_;
 
   // Orientation of the viewport. It is initialized in the first call of
   // GetPose().
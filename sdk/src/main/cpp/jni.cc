@@ -54,6 +54,12 @@ JNI_METHOD(jlong, nativeOnCreate)
     return jptr(new ndk_header_tracker::HeadTracker(javaVm, obj));
 }
 
+JNI_METHOD(jlong, nativeOnCreateWithStateModel)
+(JNIEnv * /*env*/, jobject obj, jint state_model) {
+    return jptr(
+            new ndk_header_tracker::HeadTracker(javaVm, obj, state_model));
+}
+
 JNI_METHOD(void, nativeOnDestroy)
 (JNIEnv * /*env*/, jobject /*obj*/, jlong native_app) {
     delete native(native_app);
@@ -79,4 +85,102 @@ JNI_METHOD(jfloatArray, nativeGetHeaderPose)
     env->SetFloatArrayRegion(result,0,array.size(),array.data());
     return result;
 }
+
+JNI_METHOD(jfloatArray, nativeGetHeaderPoseAtTime)
+(JNIEnv *env, jobject /*obj*/, jlong native_app, jint orientation,
+ jlong display_time_ns) {
+    std::array<float, 16> array =
+            native(native_app)->GetPose(orientation, display_time_ns).ToGlArray();
+    jfloatArray result = env->NewFloatArray(16);
+    if (result == nullptr) {
+        return nullptr;
+    }
+    env->SetFloatArrayRegion(result, 0, array.size(), array.data());
+    return result;
+}
+
+JNI_METHOD(void, nativeOnFramePresented)
+(JNIEnv * /*env*/, jobject /*obj*/, jlong native_app, jlong display_time_ns,
+ jlong present_time_ns) {
+    native(native_app)->OnFramePresented(display_time_ns, present_time_ns);
+}
+
+JNI_METHOD(jlongArray, nativeGetDisplayLatencyTrace)
+(JNIEnv *env, jobject /*obj*/, jlong native_app) {
+    std::vector<int64_t> trace = native(native_app)->GetDisplayLatencyTrace();
+    jlongArray result = env->NewLongArray(trace.size());
+    if (result == nullptr) {
+        return nullptr;
+    }
+    env->SetLongArrayRegion(result, 0, trace.size(),
+                            reinterpret_cast<const jlong *>(trace.data()));
+    return result;
+}
+
+JNI_METHOD(jlong, nativeGetSensorClockOffset)
+(JNIEnv * /*env*/, jobject /*obj*/, jlong native_app) {
+    return native(native_app)->GetSensorClockOffset();
+}
+
+JNI_METHOD(void, nativeSetTrackingQos)
+(JNIEnv * /*env*/, jobject /*obj*/, jlong native_app, jint qos) {
+    native(native_app)->SetTrackingQos(qos);
+}
+
+JNI_METHOD(void, nativeSetThreadPolicies)
+(JNIEnv * /*env*/, jobject /*obj*/, jlong native_app, jint sensor_nice_value,
+ jlong sensor_cpu_affinity_mask, jint fusion_nice_value,
+ jlong fusion_cpu_affinity_mask) {
+    native(native_app)->SetThreadPolicies(sensor_nice_value,
+                                          sensor_cpu_affinity_mask,
+                                          fusion_nice_value,
+                                          fusion_cpu_affinity_mask);
+}
+
+JNI_METHOD(jlongArray, nativeGetLatencyHistogram)
+(JNIEnv *env, jobject /*obj*/, jlong native_app, jint histogram) {
+    std::vector<uint64_t> counts =
+            native(native_app)->GetLatencyHistogram(histogram);
+    jlongArray result = env->NewLongArray(counts.size());
+    if (result == nullptr) {
+        return nullptr;
+    }
+    env->SetLongArrayRegion(result, 0, counts.size(),
+                            reinterpret_cast<const jlong *>(counts.data()));
+    return result;
+}
+
+JNI_METHOD(void, nativeSetReorderLatencyBudget)
+(JNIEnv * /*env*/, jobject /*obj*/, jlong native_app,
+ jlong latency_budget_ns) {
+    native(native_app)->SetReorderLatencyBudget(latency_budget_ns);
+}
+
+JNI_METHOD(jlongArray, nativeGetReorderStatistics)
+(JNIEnv *env, jobject /*obj*/, jlong native_app) {
+    std::vector<uint64_t> statistics =
+            native(native_app)->GetReorderStatistics();
+    jlongArray result = env->NewLongArray(statistics.size());
+    if (result == nullptr) {
+        return nullptr;
+    }
+    env->SetLongArrayRegion(
+            result, 0, statistics.size(),
+            reinterpret_cast<const jlong *>(statistics.data()));
+    return result;
+}
+
+JNI_METHOD(void, nativeSetAccelerometerCorrectionSchedule)
+(JNIEnv * /*env*/, jobject /*obj*/, jlong native_app,
+ jlong min_correction_period_ns, jlong max_correction_period_ns,
+ jboolean average_skipped_samples) {
+    native(native_app)->SetAccelerometerCorrectionSchedule(
+            min_correction_period_ns, max_correction_period_ns,
+            average_skipped_samples);
+}
+
+JNI_METHOD(void, nativeSetRotationPredictionModel)
+(JNIEnv * /*env*/, jobject /*obj*/, jlong native_app, jint model) {
+    native(native_app)->SetRotationPredictionModel(model);
+}
 }  // extern "C"
@@ -4,6 +4,7 @@
 
 #include "jni_api.h"
 #include <android/log.h>
+#include <algorithm>
 #include <array>
 #include <cmath>
 #include <fstream>
@@ -14,15 +15,37 @@ namespace ndk_header_tracker {
 
     namespace {
         constexpr uint64_t kPredictionTimeWithoutVsyncNanos = 50000000;
+
+        CardboardViewportOrientation ToViewportOrientation(
+                int viewport_orientation) {
+            if (viewport_orientation == 0) {
+                return kLandscapeLeft;
+            } else if (viewport_orientation == 1) {
+                return kLandscapeRight;
+            } else if (viewport_orientation == 2) {
+                return kPortrait;
+            }
+            return kPortraitUpsideDown;
+        }
+
+        // Gets the offset to add to a monotonic timestamp to convert it to the
+        // boot time base of the poses. Both clocks only differ by the time
+        // spent in suspend.
+        int64_t GetMonotonicToBootTimeOffsetNano() {
+            return GetBootTimeNano() - GetMonotonicTimeNano();
+        }
     }  // anonymous namespace
 
-    HeadTracker::HeadTracker(JavaVM *vm, jobject obj)
-            : head_tracker_(nullptr) {
+    HeadTracker::HeadTracker(JavaVM *vm, jobject obj, int state_model)
+            : head_tracker_(nullptr), pending_frames_(),
+              next_pending_frame_(0) {
         JNIEnv *env;
         vm->GetEnv((void **) &env, JNI_VERSION_1_6);
 
         Cardboard_initializeAndroid(vm, obj);
-        head_tracker_ = CardboardHeadTracker_create();
+        head_tracker_ = CardboardHeadTracker_createWithStateModel(
+                state_model == 1 ? kSensorFusionStateModelRotationAndGyroscopeBias
+                                 : kSensorFusionStateModelRotation);
     }
 
     HeadTracker::~HeadTracker() {
@@ -39,20 +62,146 @@ namespace ndk_header_tracker {
     Matrix4x4 HeadTracker::GetPose(int viewport_orientation) {
         std::array<float, 4> out_orientation;
         std::array<float, 3> out_position;
-        CardboardViewportOrientation orientation;
-        if (viewport_orientation == 0) {
-            orientation = kLandscapeLeft;
-        } else if (viewport_orientation == 1) {
-            orientation = kLandscapeRight;
-        } else if (viewport_orientation == 2) {
-            orientation = kPortrait;
+        const int64_t display_latency_ns = CardboardHeadTracker_getDisplayLatency(
+                head_tracker_, kPredictionTimeWithoutVsyncNanos);
+        CardboardHeadTracker_getPose(
+                head_tracker_, GetBootTimeNano() + display_latency_ns,
+                ToViewportOrientation(viewport_orientation), &out_position[0],
+                &out_orientation[0]);
+        return GetTranslationMatrix(out_position) *
+               Quatf::FromXYZW(&out_orientation[0]).ToMatrix();
+    }
+
+    int64_t HeadTracker::GetSensorClockOffset() {
+        int64_t offset_ns = 0;
+        double skew = 0;
+        if (!CardboardHeadTracker_getSensorClockOffset(head_tracker_, &offset_ns,
+                                                       &skew)) {
+            return 0;
+        }
+        return offset_ns;
+    }
+
+    void HeadTracker::SetTrackingQos(int qos) {
+        CardboardTrackingQos tracking_qos;
+        if (qos == 1) {
+            tracking_qos = kTrackingQosReduced;
+        } else if (qos == 2) {
+            tracking_qos = kTrackingQosBackgroundBatched;
         } else {
-            orientation = kPortraitUpsideDown;
+            tracking_qos = kTrackingQosFull;
         }
+        CardboardHeadTracker_setTrackingQos(head_tracker_, tracking_qos);
+    }
+
+    void HeadTracker::SetThreadPolicies(int sensor_nice_value,
+                                        uint64_t sensor_cpu_affinity_mask,
+                                        int fusion_nice_value,
+                                        uint64_t fusion_cpu_affinity_mask) {
+        const CardboardThreadPolicy sensor_thread_policy = {
+                sensor_nice_value != 0, sensor_nice_value, false, 0,
+                sensor_cpu_affinity_mask};
+        const CardboardThreadPolicy fusion_thread_policy = {
+                fusion_nice_value != 0, fusion_nice_value, false, 0,
+                fusion_cpu_affinity_mask};
+        CardboardHeadTracker_setThreadPolicies(
+                head_tracker_, &sensor_thread_policy, &fusion_thread_policy);
+    }
+
+    std::vector<uint64_t> HeadTracker::GetLatencyHistogram(int histogram) {
+        // Matches the number of buckets of the head tracker histograms.
+        constexpr int32_t kMaxBuckets = 24;
+        std::vector<uint64_t> counts(kMaxBuckets);
+        const int32_t num_buckets = CardboardHeadTracker_getLatencyHistogram(
+                head_tracker_,
+                histogram == 1 ? kLatencyHistogramFusionWakeUp
+                               : kLatencyHistogramSensorDelivery,
+                counts.data(), kMaxBuckets);
+        counts.resize(num_buckets);
+        return counts;
+    }
+
+    void HeadTracker::SetReorderLatencyBudget(int64_t latency_budget_ns) {
+        CardboardHeadTracker_setReorderLatencyBudget(head_tracker_,
+                                                     latency_budget_ns);
+    }
+
+    std::vector<uint64_t> HeadTracker::GetReorderStatistics() {
+        std::vector<uint64_t> statistics(2);
+        CardboardHeadTracker_getReorderStatistics(head_tracker_, &statistics[0],
+                                                  &statistics[1]);
+        return statistics;
+    }
+
+    void HeadTracker::SetAccelerometerCorrectionSchedule(
+            int64_t min_correction_period_ns, int64_t max_correction_period_ns,
+            bool average_skipped_samples) {
+        CardboardHeadTracker_setAccelerometerCorrectionSchedule(
+                head_tracker_, min_correction_period_ns,
+                max_correction_period_ns, average_skipped_samples);
+    }
+
+    void HeadTracker::SetRotationPredictionModel(int model) {
+        CardboardHeadTracker_setRotationPredictionModel(
+                head_tracker_, model == 1
+                               ? kRotationPredictionModelConstantAcceleration
+                               : kRotationPredictionModelConstantVelocity);
+    }
+
+    Matrix4x4 HeadTracker::GetPose(int viewport_orientation,
+                                   int64_t display_time_ns) {
+        std::array<float, 4> out_orientation;
+        std::array<float, 3> out_position;
+        const int64_t render_timestamp_ns = GetBootTimeNano();
+        const int64_t predicted_display_timestamp_ns =
+                display_time_ns + GetMonotonicToBootTimeOffsetNano();
         CardboardHeadTracker_getPose(
-                head_tracker_, GetBootTimeNano() + kPredictionTimeWithoutVsyncNanos,
-                orientation, &out_position[0], &out_orientation[0]);
+                head_tracker_, predicted_display_timestamp_ns,
+                ToViewportOrientation(viewport_orientation), &out_position[0],
+                &out_orientation[0]);
+        const PendingFrame frame = {display_time_ns, render_timestamp_ns,
+                                    predicted_display_timestamp_ns};
+        rendered_frames_.Push(&frame, 1);
         return GetTranslationMatrix(out_position) *
                Quatf::FromXYZW(&out_orientation[0]).ToMatrix();
     }
+
+    void HeadTracker::OnFramePresented(int64_t display_time_ns,
+                                       int64_t present_time_ns) {
+        std::array<PendingFrame, kMaxPendingFrames> rendered_frames;
+        const size_t num_rendered_frames = rendered_frames_.Pop(
+                rendered_frames.data(), rendered_frames.size());
+        for (size_t i = 0; i < num_rendered_frames; ++i) {
+            // The oldest frame is overwritten if its presentation was never
+            // reported.
+            pending_frames_[next_pending_frame_] = rendered_frames[i];
+            next_pending_frame_ = (next_pending_frame_ + 1) % kMaxPendingFrames;
+        }
+
+        auto it = std::find_if(
+                pending_frames_.begin(), pending_frames_.end(),
+                [display_time_ns](const PendingFrame &pending_frame) {
+                    return pending_frame.render_timestamp_ns != 0 &&
+                           pending_frame.display_time_ns == display_time_ns;
+                });
+        if (it == pending_frames_.end()) {
+            return;
+        }
+        const PendingFrame frame = *it;
+        it->render_timestamp_ns = 0;
+        CardboardHeadTracker_reportFramePresented(
+                head_tracker_, frame.render_timestamp_ns,
+                frame.predicted_display_timestamp_ns,
+                present_time_ns + GetMonotonicToBootTimeOffsetNano());
+    }
+
+    std::vector<int64_t> HeadTracker::GetDisplayLatencyTrace() {
+        // Matches the capacity of the trace kept by the head tracker.
+        constexpr int32_t kMaxFrames = 128;
+        std::vector<int64_t> trace(3 * kMaxFrames);
+        const int32_t num_frames = CardboardHeadTracker_getDisplayLatencyTrace(
+                head_tracker_, trace.data(), kMaxFrames);
+        trace.resize(3 * num_frames);
+        return trace;
+    }
 }
\ No newline at end of file
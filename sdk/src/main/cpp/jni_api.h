@@ -6,17 +6,25 @@
 #define HEADTRACKER_JNI_API_H
 
 #include <jni.h>
+#include <array>
 #include <memory>
 #include <string>
 #include <thread>
 #include <vector>
 #include "util.h"
 #include "headtracker/cardboard.h"
+#include "util/spsc_ring_buffer.h"
 
 namespace ndk_header_tracker {
     class HeadTracker {
     public:
-        HeadTracker(JavaVM *vm, jobject obj);
+        /**
+         * Creates the head tracker.
+         *
+         * @param state_model sensor fusion state model, as the values of
+         *     CardboardSensorFusionStateModel.
+         */
+        HeadTracker(JavaVM *vm, jobject obj, int state_model = 0);
 
         ~HeadTracker();
 
@@ -31,14 +39,145 @@ namespace ndk_header_tracker {
         void OnResume();
 
         /**
-         * Gets head's pose as a 4x4 matrix.
+         * Gets head's pose as a 4x4 matrix, predicted with the estimated
+         * display latency.
          *
          * @return matrix containing head's pose.
          */
         Matrix4x4 GetPose(int viewport_orientation);
 
+        /**
+         * Gets head's pose as a 4x4 matrix, predicted to the display time of
+         * the frame.
+         *
+         * @param display_time_ns expected display time of the frame, in the
+         *     clock of System.nanoTime() (e.g. the Choreographer frame time
+         *     plus the vsync offset).
+         * @return matrix containing head's pose.
+         */
+        Matrix4x4 GetPose(int viewport_orientation, int64_t display_time_ns);
+
+        /**
+         * Reports that the frame rendered for a display time was presented.
+         * It must always be called from the same thread. It does not lock
+         * against GetPose().
+         *
+         * @param display_time_ns display time passed to GetPose().
+         * @param present_time_ns actual present time of the frame, in the
+         *     clock of System.nanoTime().
+         */
+        void OnFramePresented(int64_t display_time_ns, int64_t present_time_ns);
+
+        /**
+         * Gets the timing of the latest presented frames for diagnostics, as
+         * (render, predicted display, actual display) boot time triplets.
+         *
+         * @return timestamps of the frames, oldest first.
+         */
+        std::vector<int64_t> GetDisplayLatencyTrace();
+
+        /**
+         * Gets the estimated offset from the sensor clock to the clock of the
+         * poses, for diagnostics.
+         *
+         * @return offset in nanoseconds, or 0 if it is not estimated yet.
+         */
+        int64_t GetSensorClockOffset();
+
+        /**
+         * Sets the tracking quality of service level.
+         *
+         * @param qos level, as the values of CardboardTrackingQos.
+         */
+        void SetTrackingQos(int qos);
+
+        /**
+         * Sets the scheduling policies of the sensor capture and sensor fusion
+         * threads.
+         *
+         * @param sensor_nice_value nice value of the capture thread. Zero
+         *     restores its original value.
+         * @param sensor_cpu_affinity_mask CPUs the capture thread may run on.
+         *     Zero restores its original affinity.
+         * @param fusion_nice_value nice value of the fusion thread. Zero
+         *     restores its original value.
+         * @param fusion_cpu_affinity_mask CPUs the fusion thread may run on.
+         *     Zero restores its original affinity.
+         */
+        void SetThreadPolicies(int sensor_nice_value,
+                               uint64_t sensor_cpu_affinity_mask,
+                               int fusion_nice_value,
+                               uint64_t fusion_cpu_affinity_mask);
+
+        /**
+         * Gets the counts of a latency histogram, for diagnostics.
+         *
+         * @param histogram histogram, as the values of
+         *     CardboardLatencyHistogram.
+         * @return counts of the logarithmic microsecond buckets.
+         */
+        std::vector<uint64_t> GetLatencyHistogram(int histogram);
+
+        /**
+         * Sets how long sensor samples may be held to merge the sensor streams
+         * by timestamp.
+         *
+         * @param latency_budget_ns latency budget in nanoseconds.
+         */
+        void SetReorderLatencyBudget(int64_t latency_budget_ns);
+
+        /**
+         * Gets the number of sensor samples reordered and dropped while
+         * merging the sensor streams, for diagnostics.
+         *
+         * @return reordered and dropped sample counts, in this order.
+         */
+        std::vector<uint64_t> GetReorderStatistics();
+
+        /**
+         * Sets the schedule of the gravity corrections of sensor fusion.
+         *
+         * @param min_correction_period_ns minimum time between two
+         *     corrections. Zero corrects with every accelerometer sample.
+         * @param max_correction_period_ns maximum time between two
+         *     corrections, used while the device accelerates.
+         * @param average_skipped_samples whether a correction averages the
+         *     samples received since the previous one.
+         */
+        void SetAccelerometerCorrectionSchedule(int64_t min_correction_period_ns,
+                                                int64_t max_correction_period_ns,
+                                                bool average_skipped_samples);
+
+        /**
+         * Sets the model extrapolating the rotation to the pose timestamp.
+         *
+         * @param model prediction model, as the values of
+         *     CardboardRotationPredictionModel.
+         */
+        void SetRotationPredictionModel(int model);
+
     private:
+        // Frame rendered by GetPose() and not presented yet.
+        struct PendingFrame {
+            int64_t display_time_ns;
+            int64_t render_timestamp_ns;
+            int64_t predicted_display_timestamp_ns;
+        };
+
+        // Number of frames that may be in flight. Must be a power of two.
+        static constexpr size_t kMaxPendingFrames = 8;
+
         CardboardHeadTracker *head_tracker_;
+
+        // Frames rendered by GetPose(), passed from the render thread to the
+        // frame presentation callbacks without locking. If presentations are
+        // not reported, the newest frames are dropped once it is full.
+        cardboard::SpscRingBuffer<PendingFrame, kMaxPendingFrames>
+                rendered_frames_;
+        // Frames not presented yet, used as a ring buffer. Only accessed by
+        // OnFramePresented().
+        std::array<PendingFrame, kMaxPendingFrames> pending_frames_;
+        size_t next_pending_frame_;
     };
 }
 
@@ -0,0 +1,58 @@
+/*
+ * Copyright 2019 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef CARDBOARD_SDK_SENSORS_ACCELEROMETER_CORRECTION_SCHEDULE_H_
+#define CARDBOARD_SDK_SENSORS_ACCELEROMETER_CORRECTION_SCHEDULE_H_
+
+#include <cstdint>
+
+namespace cardboard {
+
+// Schedule of the gravity corrections of sensor fusion. Accelerometer samples
+// received between two corrections only update the accelerometer noise model.
+struct AccelerometerCorrectionSchedule {
+  // Minimum time between two corrections in nanoseconds. Zero corrects with
+  // every accelerometer sample.
+  int64_t min_correction_period_ns;
+
+  // Maximum time between two corrections in nanoseconds. When it is above
+  // min_correction_period_ns the period is adaptive: it grows with the recent
+  // changes of the accelerometer norm, while the accelerometer is a noisy
+  // gravity reference and the corrections have little weight.
+  int64_t max_correction_period_ns;
+
+  // If true, a correction uses the average of the samples received since the
+  // previous one, brought to the current sensor frame with the gyroscope.
+  // Otherwise it uses the latest sample.
+  bool average_skipped_samples;
+
+  bool operator==(const AccelerometerCorrectionSchedule& other) const {
+    return min_correction_period_ns == other.min_correction_period_ns &&
+           max_correction_period_ns == other.max_correction_period_ns &&
+           average_skipped_samples == other.average_skipped_samples;
+  }
+
+  bool operator!=(const AccelerometerCorrectionSchedule& other) const {
+    return !(*this == other);
+  }
+};
+
+// Corrects with every accelerometer sample.
+constexpr AccelerometerCorrectionSchedule kEverySampleCorrectionSchedule = {
+    0, 0, false};
+
+}  // namespace cardboard
+
+#endif  // CARDBOARD_SDK_SENSORS_ACCELEROMETER_CORRECTION_SCHEDULE_H_
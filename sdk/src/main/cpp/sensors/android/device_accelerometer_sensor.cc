@@ -19,6 +19,7 @@
 #include <android/sensor.h>
 #include <stddef.h>
 
+#include <algorithm>
 #include <memory>
 #include <mutex>  // NOLINT
 
@@ -53,19 +54,6 @@ const ASensor* InitSensor(ASensorManager* sensor_manager) {
                                          ASENSOR_TYPE_ACCELEROMETER);
 }
 
-bool PollLooper(int timeout_ms, int* num_events) {
-  void* source = nullptr;
-  const int looper_id = ALooper_pollAll(timeout_ms, NULL, num_events,
-                                        reinterpret_cast<void**>(&source));
-  if (looper_id != LOOPER_ID_USER) {
-    return false;
-  }
-  if (*num_events <= 0) {
-    return false;
-  }
-  return true;
-}
-
 class SensorEventQueueReader {
  public:
   SensorEventQueueReader(ASensorManager* manager, const ASensor* sensor)
@@ -77,26 +65,32 @@ class SensorEventQueueReader {
     ASensorManager_destroyEventQueue(manager_, queue_);
   }
 
-  bool Start() {
+  bool Start(const SensorSamplingConfig& config) {
+    // The sensor cannot sample faster than its minimum delay.
+    const int32_t sampling_period_us =
+        std::max<int32_t>(config.sampling_period_us,
+                          ASensor_getMinDelay(sensor_));
+#if __ANDROID_API__ >= 26
+    if (config.max_report_latency_us > 0) {
+      return ASensorEventQueue_registerSensor(queue_, sensor_,
+                                              sampling_period_us,
+                                              config.max_report_latency_us) >=
+             0;
+    }
+#endif
+    // Hardware batching is not available, events are reported immediately.
     ASensorEventQueue_enableSensor(queue_, sensor_);
-    const int min_delay = ASensor_getMinDelay(sensor_);
-    // Set sensor capture rate to the highest possible sampling rate.
-    ASensorEventQueue_setEventRate(queue_, sensor_, min_delay);
+    ASensorEventQueue_setEventRate(queue_, sensor_, sampling_period_us);
     return true;
   }
 
   void Stop() { ASensorEventQueue_disableSensor(queue_, sensor_); }
 
-  bool WaitForEvent(int timeout_ms, ASensorEvent* event) {
-    int num_events;
-    if (!PollLooper(timeout_ms, &num_events)) {
-      return false;
-    }
-    return (ASensorEventQueue_getEvents(queue_, event, 1) > 0);
-  }
-
-  bool ReadEvent(ASensorEvent* event) {
-    return (ASensorEventQueue_getEvents(queue_, event, 1) > 0);
+  // Reads up to @p max_count events with a single call into the sensor
+  // service.
+  int ReadEvents(ASensorEvent* events, size_t max_count) {
+    return static_cast<int>(
+        ASensorEventQueue_getEvents(queue_, events, max_count));
   }
 
  private:
@@ -105,7 +99,7 @@ class SensorEventQueueReader {
   ASensorEventQueue* queue_;  // Owned by this.
 };
 
-void ParseAccelerometerEvent(const ASensorEvent& event,
+bool ParseAccelerometerEvent(const ASensorEvent& event,
                              AccelerometerData* sample) {
   sample->sensor_timestamp_ns = event.timestamp;
   sample->system_timestamp = event.timestamp;
@@ -113,6 +107,7 @@ void ParseAccelerometerEvent(const ASensorEvent& event,
   // magnetic) are all in the same union type so they can be
   // accessed by event.
   sample->data = {event.vector.x, event.vector.y, event.vector.z};
+  return true;
 }
 
 }  // namespace
@@ -124,6 +119,8 @@ struct DeviceAccelerometerSensor::SensorInfo {
   ASensorManager* sensor_manager;
   const ASensor* sensor;
   std::unique_ptr<SensorEventQueueReader> reader;
+  // Raw events of the batch being read. Reused across reads.
+  SensorEventBatch<ASensorEvent> event_buffer;
 };
 
 DeviceAccelerometerSensor::DeviceAccelerometerSensor()
@@ -141,26 +138,22 @@ DeviceAccelerometerSensor::DeviceAccelerometerSensor()
 
 DeviceAccelerometerSensor::~DeviceAccelerometerSensor() {}
 
-void DeviceAccelerometerSensor::PollForSensorData(
-    int timeout_ms, std::vector<AccelerometerData>* results) const {
-  results->clear();
-  ASensorEvent event;
-  if (!sensor_info_->reader->WaitForEvent(timeout_ms, &event)) {
-    return;
-  }
-  do {
-    AccelerometerData sample;
-    ParseAccelerometerEvent(event, &sample);
-    results->push_back(sample);
-  } while (sensor_info_->reader->ReadEvent(&event));
+size_t DeviceAccelerometerSensor::ReadSensorData(
+    SensorEventBatch<AccelerometerData>* results) const {
+  SensorEventQueueReader* reader = sensor_info_->reader.get();
+  return ReadSensorEventBatch(
+      [reader](ASensorEvent* events, size_t max_count) {
+        return reader->ReadEvents(events, max_count);
+      },
+      ParseAccelerometerEvent, &sensor_info_->event_buffer, results);
 }
 
-bool DeviceAccelerometerSensor::Start() {
+bool DeviceAccelerometerSensor::Start(const SensorSamplingConfig& config) {
   if (!sensor_info_->reader) {
     CARDBOARD_LOGE("Could not start accelerometer sensor");
     return false;
   }
-  return sensor_info_->reader->Start();
+  return sensor_info_->reader->Start(config);
 }
 
 void DeviceAccelerometerSensor::Stop() {
@@ -19,6 +19,7 @@
 #include <android/sensor.h>
 #include <stddef.h>
 
+#include <algorithm>
 #include <memory>
 
 #include "../accelerometer_data.h"
@@ -84,19 +85,6 @@ const ASensor* InitSensor(ASensorManager* sensor_manager) {
                                          ASENSOR_TYPE_GYROSCOPE);
 }
 
-bool PollLooper(int timeout_ms, int* num_events) {
-  void* source = nullptr;
-  const int looper_id = ALooper_pollAll(timeout_ms, NULL, num_events,
-                                        reinterpret_cast<void**>(&source));
-  if (looper_id != LOOPER_ID_USER) {
-    return false;
-  }
-  if (*num_events <= 0) {
-    return false;
-  }
-  return true;
-}
-
 class SensorEventQueueReader {
  public:
   SensorEventQueueReader(ASensorManager* manager, const ASensor* sensor)
@@ -108,26 +96,32 @@ class SensorEventQueueReader {
     ASensorManager_destroyEventQueue(manager_, queue_);
   }
 
-  bool Start() {
+  bool Start(const SensorSamplingConfig& config) {
+    // The sensor cannot sample faster than its minimum delay.
+    const int32_t sampling_period_us =
+        std::max<int32_t>(config.sampling_period_us,
+                          ASensor_getMinDelay(sensor_));
+#if __ANDROID_API__ >= 26
+    if (config.max_report_latency_us > 0) {
+      return ASensorEventQueue_registerSensor(queue_, sensor_,
+                                              sampling_period_us,
+                                              config.max_report_latency_us) >=
+             0;
+    }
+#endif
+    // Hardware batching is not available, events are reported immediately.
     ASensorEventQueue_enableSensor(queue_, sensor_);
-    const int min_delay = ASensor_getMinDelay(sensor_);
-    // Set sensor capture rate to the highest possible sampling rate.
-    ASensorEventQueue_setEventRate(queue_, sensor_, min_delay);
+    ASensorEventQueue_setEventRate(queue_, sensor_, sampling_period_us);
     return true;
   }
 
   void Stop() { ASensorEventQueue_disableSensor(queue_, sensor_); }
 
-  bool WaitForEvent(int timeout_ms, ASensorEvent* event) {
-    int num_events;
-    if (!PollLooper(timeout_ms, &num_events)) {
-      return false;
-    }
-    return (ASensorEventQueue_getEvents(queue_, event, 1) > 0);
-  }
-
-  bool ReadEvent(ASensorEvent* event) {
-    return (ASensorEventQueue_getEvents(queue_, event, 1) > 0);
+  // Reads up to @p max_count events with a single call into the sensor
+  // service.
+  int ReadEvents(ASensorEvent* events, size_t max_count) {
+    return static_cast<int>(
+        ASensorEventQueue_getEvents(queue_, events, max_count));
   }
 
  private:
@@ -145,6 +139,8 @@ struct DeviceGyroscopeSensor::SensorInfo {
   ASensorManager* sensor_manager;
   const ASensor* sensor;
   std::unique_ptr<SensorEventQueueReader> reader;
+  // Raw events of the batch being read. Reused across reads.
+  SensorEventBatch<ASensorEvent> event_buffer;
 };
 
 namespace {
@@ -163,11 +159,20 @@ bool ParseGyroEvent(const ASensorEvent& event,
   // accessed by event.
   if (event.type == ASENSOR_TYPE_GYROSCOPE) {
     sample->data = {event.vector.x, event.vector.y, event.vector.z};
+    sample->has_hardware_bias = false;
+    sample->hardware_bias = Vector3::Zero();
     return true;
   } else if (event.type == ASENSOR_TYPE_GYROSCOPE_UNCALIBRATED) {
     // This is a special case when it is possible to initialize to
-    // ASENSOR_TYPE_GYROSCOPE_UNCALIBRATED
-    sample->data = {event.vector.x, event.vector.y, event.vector.z};
+    // ASENSOR_TYPE_GYROSCOPE_UNCALIBRATED. The driver bias estimate is kept
+    // apart so that it only seeds the Cardboard SDK bias estimation.
+    const AUncalibratedEvent& uncalibrated_event = event.uncalibrated_gyro;
+    sample->data = {uncalibrated_event.x_uncalib, uncalibrated_event.y_uncalib,
+                    uncalibrated_event.z_uncalib};
+    sample->has_hardware_bias = true;
+    sample->hardware_bias = {uncalibrated_event.x_bias,
+                             uncalibrated_event.y_bias,
+                             uncalibrated_event.z_bias};
     return true;
   } else {
     CARDBOARD_LOGE("ParseGyroEvent discarding unexpected sensor event type %d",
@@ -194,27 +199,22 @@ DeviceGyroscopeSensor::DeviceGyroscopeSensor()
 
 DeviceGyroscopeSensor::~DeviceGyroscopeSensor() {}
 
-void DeviceGyroscopeSensor::PollForSensorData(
-    int timeout_ms, std::vector<GyroscopeData>* results) const {
-  results->clear();
-  ASensorEvent event;
-  if (!sensor_info_->reader->WaitForEvent(timeout_ms, &event)) {
-    return;
-  }
-  do {
-    GyroscopeData sample;
-    if (ParseGyroEvent(event, &sample)) {
-      results->push_back(sample);
-    }
-  } while (sensor_info_->reader->ReadEvent(&event));
+size_t DeviceGyroscopeSensor::ReadSensorData(
+    SensorEventBatch<GyroscopeData>* results) const {
+  SensorEventQueueReader* reader = sensor_info_->reader.get();
+  return ReadSensorEventBatch(
+      [reader](ASensorEvent* events, size_t max_count) {
+        return reader->ReadEvents(events, max_count);
+      },
+      ParseGyroEvent, &sensor_info_->event_buffer, results);
 }
 
-bool DeviceGyroscopeSensor::Start() {
+bool DeviceGyroscopeSensor::Start(const SensorSamplingConfig& config) {
   if (!sensor_info_->reader) {
     CARDBOARD_LOGE("Could not start gyroscope sensor.");
     return false;
   }
-  return sensor_info_->reader->Start();
+  return sensor_info_->reader->Start(config);
 }
 
 void DeviceGyroscopeSensor::Stop() {
@@ -0,0 +1,326 @@
+/*
+ * Copyright 2019 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "../sensor_hub.h"
+
+#include <android/looper.h>
+#include <time.h>
+
+#include <memory>
+#include <mutex>   // NOLINT
+#include <thread>  // NOLINT
+
+#include "../accelerometer_data.h"
+#include "../clock_offset_estimator.h"
+#include "../device_accelerometer_sensor.h"
+#include "../device_gyroscope_sensor.h"
+#include "../gyroscope_data.h"
+#include "../sensor_event_batch.h"
+#include "../../util/latency_histogram.h"
+#include "../../util/logging.h"
+#include "../../util/thread_policy.h"
+
+// Workaround to avoid the inclusion of "android_native_app_glue.h.
+#ifndef LOOPER_ID_USER
+#define LOOPER_ID_USER 3
+#endif
+
+namespace cardboard {
+
+namespace {
+
+// Waits on the looper of the current thread until one of the sensor event
+// queues attached to it has events or the looper is woken up.
+//
+// @return true if there are sensor events to read.
+bool PollLooper() {
+  int num_events = 0;
+  void* source = nullptr;
+  const int looper_id = ALooper_pollAll(-1, NULL, &num_events,
+                                        reinterpret_cast<void**>(&source));
+  if (looper_id != LOOPER_ID_USER) {
+    return false;
+  }
+  if (num_events <= 0) {
+    return false;
+  }
+  return true;
+}
+
+// Returns the current time of the clock the poses are requested in.
+int64_t GetBootTimeNanos() {
+  struct timespec res;
+  clock_gettime(CLOCK_BOOTTIME, &res);
+  return static_cast<int64_t>(res.tv_sec) * 1000000000 + res.tv_nsec;
+}
+
+// Reads all pending events of @p sensor in batches and passes each batch to
+// @p callback. Events are discarded when @p callback is null.
+template <typename DataType, typename Sensor, typename Callback>
+void DispatchSensorEvents(const Sensor& sensor, const Callback* callback,
+                          ClockOffsetEstimator* clock_offset_estimator,
+                          LatencyHistogram* delivery_latency_histogram,
+                          SensorEventBatch<DataType>* events) {
+  size_t num_events;
+  do {
+    num_events = sensor.ReadSensorData(events);
+    if (num_events == 0) {
+      break;
+    }
+    // The sensor clock is not guaranteed to be CLOCK_BOOTTIME, so its offset
+    // is estimated from the time the events are read at.
+    const int64_t read_timestamp_ns = GetBootTimeNanos();
+    for (size_t i = 0; i < num_events; ++i) {
+      const DataType& event = (*events)[i];
+      clock_offset_estimator->AddObservation(event.sensor_timestamp_ns,
+                                             read_timestamp_ns);
+    }
+    for (size_t i = 0; i < num_events; ++i) {
+      DataType& event = (*events)[i];
+      event.system_timestamp = clock_offset_estimator->ConvertToSystemTime(
+          event.sensor_timestamp_ns);
+      // Discarded events are stale, they would skew the histogram.
+      if (callback) {
+        delivery_latency_histogram->Record(
+            read_timestamp_ns - static_cast<int64_t>(event.system_timestamp));
+      }
+    }
+    if (callback && *callback) {
+      (*callback)(events->data(), num_events);
+    }
+  } while (num_events == kSensorEventBatchSize);
+}
+
+}  // namespace
+
+struct SensorHub::EventProducer {
+  EventProducer()
+      : looper(nullptr),
+        run_thread(false),
+        is_polling_requested(false),
+        sampling_config(kFastestSensorSamplingConfig),
+        thread_policy(kDefaultThreadPolicy) {}
+  // Capture thread. This is created when polling is started for the first
+  // time, and destroyed with the hub.
+  std::unique_ptr<std::thread> thread;
+  // Guards the fields below and the callbacks. The capture thread holds it
+  // while executing the callbacks.
+  std::mutex mutex;
+  // Event loop of the capture thread. Null while the thread is not running.
+  ALooper* looper;
+  // Flag indicating if the capture thread should keep running.
+  bool run_thread;
+  // Flag indicating if the sensors should be enabled.
+  bool is_polling_requested;
+  // Requested sampling of the sensors.
+  SensorSamplingConfig sampling_config;
+  // Requested scheduling policy of the capture thread.
+  ThreadPolicy thread_policy;
+};
+
+SensorHub::SensorHub()
+    : event_producer_(new EventProducer()),
+      on_accel_callback_(nullptr),
+      on_gyro_callback_(nullptr) {}
+
+SensorHub::~SensorHub() {
+  {
+    std::unique_lock<std::mutex> lock(event_producer_->mutex);
+    event_producer_->is_polling_requested = false;
+    event_producer_->run_thread = false;
+    on_accel_callback_ = nullptr;
+    on_gyro_callback_ = nullptr;
+    WakeUpThreadLocked();
+  }
+  if (event_producer_->thread && event_producer_->thread->joinable()) {
+    event_producer_->thread->join();
+  }
+}
+
+void SensorHub::StartSensorPolling(
+    const AccelerometerCallback* on_accel_callback,
+    const GyroscopeCallback* on_gyro_callback) {
+  std::unique_lock<std::mutex> lock(event_producer_->mutex);
+  on_accel_callback_ = on_accel_callback;
+  on_gyro_callback_ = on_gyro_callback;
+  event_producer_->is_polling_requested = true;
+
+  // The thread is only created once. Afterwards it is just woken up.
+  if (!event_producer_->thread) {
+    event_producer_->run_thread = true;
+    event_producer_->thread.reset(new std::thread([&]() { WorkFn(); }));
+    return;
+  }
+  WakeUpThreadLocked();
+}
+
+void SensorHub::StopSensorPolling() {
+  std::unique_lock<std::mutex> lock(event_producer_->mutex);
+  if (!event_producer_->is_polling_requested) {
+    return;
+  }
+  event_producer_->is_polling_requested = false;
+  on_accel_callback_ = nullptr;
+  on_gyro_callback_ = nullptr;
+  WakeUpThreadLocked();
+}
+
+void SensorHub::SetSamplingConfig(const SensorSamplingConfig& config) {
+  std::unique_lock<std::mutex> lock(event_producer_->mutex);
+  if (event_producer_->sampling_config == config) {
+    return;
+  }
+  event_producer_->sampling_config = config;
+  WakeUpThreadLocked();
+}
+
+void SensorHub::SetThreadPolicy(const ThreadPolicy& policy) {
+  std::unique_lock<std::mutex> lock(event_producer_->mutex);
+  if (event_producer_->thread_policy == policy) {
+    return;
+  }
+  event_producer_->thread_policy = policy;
+  WakeUpThreadLocked();
+}
+
+ClockOffsetEstimate SensorHub::GetClockOffsetEstimate() const {
+  return clock_offset_estimator_.GetEstimate();
+}
+
+LatencyHistogram::Snapshot SensorHub::GetDeliveryLatencyHistogram() const {
+  return delivery_latency_histogram_.GetSnapshot();
+}
+
+void SensorHub::WakeUpThreadLocked() {
+  // When the looper is not set yet the thread checks the flags before waiting
+  // for the first time.
+  if (event_producer_->looper != nullptr) {
+    ALooper_wake(event_producer_->looper);
+  }
+}
+
+void SensorHub::WorkFn() {
+  // Both sensors create their event queue on the looper of this thread.
+  DeviceAccelerometerSensor accel_sensor;
+  DeviceGyroscopeSensor gyro_sensor;
+
+  SensorEventBatch<AccelerometerData> accel_events;
+  SensorEventBatch<GyroscopeData> gyro_events;
+
+  bool are_sensors_enabled = false;
+  bool is_accel_started = false;
+  bool is_gyro_started = false;
+  SensorSamplingConfig sampling_config = kFastestSensorSamplingConfig;
+  ThreadPolicy thread_policy = kDefaultThreadPolicy;
+
+  {
+    std::unique_lock<std::mutex> lock(event_producer_->mutex);
+    event_producer_->looper = ALooper_forThread();
+  }
+
+  while (true) {
+    bool is_polling_requested;
+    SensorSamplingConfig requested_sampling_config;
+    ThreadPolicy requested_thread_policy;
+    {
+      std::unique_lock<std::mutex> lock(event_producer_->mutex);
+      if (!event_producer_->run_thread) {
+        event_producer_->looper = nullptr;
+        break;
+      }
+      is_polling_requested = event_producer_->is_polling_requested;
+      requested_sampling_config = event_producer_->sampling_config;
+      requested_thread_policy = event_producer_->thread_policy;
+    }
+
+    if (requested_thread_policy != thread_policy) {
+      thread_policy = requested_thread_policy;
+      ApplyThreadPolicy(thread_policy);
+    }
+
+    if (are_sensors_enabled && is_polling_requested &&
+        requested_sampling_config != sampling_config) {
+      // The sampling of a started sensor can only be changed by restarting it.
+      // Queued events are still valid, so they are kept.
+      sampling_config = requested_sampling_config;
+      if (is_accel_started) {
+        accel_sensor.Stop();
+        is_accel_started = accel_sensor.Start(sampling_config);
+      }
+      if (is_gyro_started) {
+        gyro_sensor.Stop();
+        is_gyro_started = gyro_sensor.Start(sampling_config);
+      }
+    }
+
+    if (is_polling_requested && !are_sensors_enabled) {
+      // The sensor clock may have been reset while the sensors were disabled.
+      clock_offset_estimator_.Reset();
+      sampling_config = requested_sampling_config;
+      is_accel_started = accel_sensor.Start(sampling_config);
+      is_gyro_started = gyro_sensor.Start(sampling_config);
+      if (!is_accel_started && !is_gyro_started) {
+        CARDBOARD_LOGE("SensorHub: No sensor could be started.");
+      }
+      are_sensors_enabled = true;
+    } else if (!is_polling_requested && are_sensors_enabled) {
+      // Events still queued are stale by the time polling restarts, so they
+      // are discarded.
+      if (is_accel_started) {
+        accel_sensor.Stop();
+        DispatchSensorEvents(accel_sensor,
+                             static_cast<const AccelerometerCallback*>(nullptr),
+                             &clock_offset_estimator_,
+                           &delivery_latency_histogram_, &accel_events);
+      }
+      if (is_gyro_started) {
+        gyro_sensor.Stop();
+        DispatchSensorEvents(gyro_sensor,
+                             static_cast<const GyroscopeCallback*>(nullptr),
+                             &clock_offset_estimator_,
+                           &delivery_latency_histogram_, &gyro_events);
+      }
+      is_accel_started = false;
+      is_gyro_started = false;
+      are_sensors_enabled = false;
+    }
+
+    // Parks the thread until sensor events arrive or the looper is woken up.
+    if (!PollLooper() || !are_sensors_enabled) {
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(event_producer_->mutex);
+    if (is_accel_started) {
+      DispatchSensorEvents(accel_sensor, on_accel_callback_,
+                           &clock_offset_estimator_,
+                           &delivery_latency_histogram_, &accel_events);
+    }
+    if (is_gyro_started) {
+      DispatchSensorEvents(gyro_sensor, on_gyro_callback_,
+                           &clock_offset_estimator_,
+                           &delivery_latency_histogram_, &gyro_events);
+    }
+  }
+
+  if (is_accel_started) {
+    accel_sensor.Stop();
+  }
+  if (is_gyro_started) {
+    gyro_sensor.Stop();
+  }
+}
+
+}  // namespace cardboard
@@ -0,0 +1,152 @@
+/*
+ * Copyright 2019 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "clock_offset_estimator.h"
+
+#include <cmath>
+
+namespace cardboard {
+
+ClockOffsetEstimator::ClockOffsetEstimator()
+    : published_timestamp_ns_(0),
+      published_offset_ns_(0),
+      published_skew_(0.0),
+      is_published_estimate_valid_(false) {
+  Reset();
+}
+
+void ClockOffsetEstimator::Reset() {
+  num_window_minima_ = 0;
+  next_window_minimum_index_ = 0;
+  current_window_minimum_ = {0, 0};
+  current_window_start_ns_ = 0;
+  is_current_window_started_ = false;
+  model_ = {0, 0, 0.0, false};
+
+  is_published_estimate_valid_ = false;
+  published_timestamp_ns_ = 0;
+  published_offset_ns_ = 0;
+  published_skew_ = 0.0;
+}
+
+void ClockOffsetEstimator::AddObservation(int64_t sensor_timestamp_ns,
+                                          int64_t system_timestamp_ns) {
+  const int64_t offset_ns = system_timestamp_ns - sensor_timestamp_ns;
+
+  bool is_window_closed = false;
+  if (is_current_window_started_ &&
+      sensor_timestamp_ns - current_window_start_ns_ >= kWindowDurationNs) {
+    // Closes the current window.
+    window_minima_[next_window_minimum_index_] = current_window_minimum_;
+    next_window_minimum_index_ = (next_window_minimum_index_ + 1) % kNumWindows;
+    if (num_window_minima_ < kNumWindows) {
+      ++num_window_minima_;
+    }
+    is_current_window_started_ = false;
+    is_window_closed = true;
+  }
+
+  bool is_current_window_minimum_updated = true;
+  if (!is_current_window_started_) {
+    current_window_start_ns_ = sensor_timestamp_ns;
+    current_window_minimum_ = {sensor_timestamp_ns, offset_ns};
+    is_current_window_started_ = true;
+  } else if (offset_ns < current_window_minimum_.offset_ns) {
+    current_window_minimum_ = {sensor_timestamp_ns, offset_ns};
+  } else {
+    is_current_window_minimum_updated = false;
+  }
+
+  // The minimum of an open window can still be far above the lower envelope,
+  // so it is only fitted until the first window completes.
+  if (is_window_closed ||
+      (num_window_minima_ == 0 && is_current_window_minimum_updated)) {
+    UpdateModel();
+  }
+}
+
+void ClockOffsetEstimator::UpdateModel() {
+  // Only the completed windows are fitted once there is any. Timestamps and
+  // offsets are taken relative to the newest fitted minimum to keep the fit
+  // well conditioned.
+  const bool has_window_minima = num_window_minima_ > 0;
+  const size_t num_points = has_window_minima ? num_window_minima_ : 1;
+  const WindowMinimum& reference =
+      has_window_minima
+          ? window_minima_[(next_window_minimum_index_ + kNumWindows - 1) %
+                           kNumWindows]
+          : current_window_minimum_;
+
+  bool are_clocks_equal = true;
+  double sum_t = 0.0;
+  double sum_d = 0.0;
+  double sum_tt = 0.0;
+  double sum_td = 0.0;
+  for (size_t i = 0; i < num_points; ++i) {
+    const WindowMinimum& point =
+        has_window_minima ? window_minima_[i] : reference;
+    are_clocks_equal = are_clocks_equal && point.offset_ns >= 0 &&
+                       point.offset_ns <= kMaxDeliveryLatencyNs;
+    const double t =
+        static_cast<double>(point.sensor_timestamp_ns -
+                            reference.sensor_timestamp_ns);
+    const double d = static_cast<double>(point.offset_ns - reference.offset_ns);
+    sum_t += t;
+    sum_d += d;
+    sum_tt += t * t;
+    sum_td += t * d;
+  }
+
+  model_.timestamp_ns = reference.sensor_timestamp_ns;
+  model_.is_valid = true;
+  if (are_clocks_equal) {
+    model_.offset_ns = 0;
+    model_.skew = 0.0;
+  } else {
+    const double n = static_cast<double>(num_points);
+    const double denominator = n * sum_tt - sum_t * sum_t;
+    // With a single window there is no skew information.
+    const double skew =
+        denominator > 0.0 ? (n * sum_td - sum_t * sum_d) / denominator : 0.0;
+    const double intercept = (sum_d - skew * sum_t) / n;
+    model_.offset_ns =
+        reference.offset_ns + static_cast<int64_t>(std::llround(intercept));
+    model_.skew = skew;
+  }
+
+  published_timestamp_ns_ = model_.timestamp_ns;
+  published_offset_ns_ = model_.offset_ns;
+  published_skew_ = model_.skew;
+  is_published_estimate_valid_ = true;
+}
+
+int64_t ClockOffsetEstimator::ConvertToSystemTime(
+    int64_t sensor_timestamp_ns) const {
+  if (!model_.is_valid) {
+    return sensor_timestamp_ns;
+  }
+  const double drift_ns =
+      model_.skew *
+      static_cast<double>(sensor_timestamp_ns - model_.timestamp_ns);
+  return sensor_timestamp_ns + model_.offset_ns +
+         static_cast<int64_t>(std::llround(drift_ns));
+}
+
+ClockOffsetEstimate ClockOffsetEstimator::GetEstimate() const {
+  return {published_timestamp_ns_, published_offset_ns_, published_skew_,
+          is_published_estimate_valid_};
+}
+
+}  // namespace cardboard
@@ -0,0 +1,126 @@
+/*
+ * Copyright 2019 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef CARDBOARD_SDK_SENSORS_CLOCK_OFFSET_ESTIMATOR_H_
+#define CARDBOARD_SDK_SENSORS_CLOCK_OFFSET_ESTIMATOR_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace cardboard {
+
+// Estimate of the relation between the sensor clock and the system clock:
+// system_time = sensor_time + offset_ns + skew * (sensor_time - timestamp_ns).
+struct ClockOffsetEstimate {
+  // Sensor time at which the offset was estimated in nanoseconds.
+  int64_t timestamp_ns;
+
+  // Offset from the sensor clock to the system clock in nanoseconds.
+  int64_t offset_ns;
+
+  // Drift of the system clock relative to the sensor clock, in nanoseconds per
+  // nanosecond.
+  double skew;
+
+  // Whether any observation has been processed since the last reset.
+  bool is_valid;
+};
+
+// Online estimator of the offset and drift between the clock stamping sensor
+// events and the system clock the poses are requested in.
+//
+// Each sensor event gives one observation: the system time at which it was
+// read minus its sensor timestamp. That difference is the clock offset plus a
+// non-negative delivery latency, so the offset is tracked by the lower envelope
+// of the observations. The minimum observation is kept for consecutive windows
+// of sensor time and a line fitted through the minima of the recent completed
+// windows gives the offset and the skew. The minimum of the open window is only
+// used until the first window completes.
+//
+// The delivery latency itself cannot be observed. If all minima are within
+// kMaxDeliveryLatencyNs of zero, both clocks are considered to be the same and
+// timestamps are not modified.
+//
+// AddObservation(), ConvertToSystemTime() and Reset() must be called from a
+// single thread. GetEstimate() can be called from any thread.
+class ClockOffsetEstimator {
+ public:
+  ClockOffsetEstimator();
+
+  // Resets the estimator state.
+  void Reset();
+
+  // Updates the estimator with one sensor event.
+  //
+  // @param sensor_timestamp_ns timestamp of the event in the sensor clock.
+  // @param system_timestamp_ns time at which the event was read in the system
+  //     clock.
+  void AddObservation(int64_t sensor_timestamp_ns, int64_t system_timestamp_ns);
+
+  // Converts a sensor timestamp to the system clock.
+  //
+  // @param sensor_timestamp_ns timestamp in the sensor clock.
+  // @return the timestamp in the system clock, or @p sensor_timestamp_ns if no
+  //     observation has been processed yet.
+  int64_t ConvertToSystemTime(int64_t sensor_timestamp_ns) const;
+
+  // Gets the current estimate for diagnostics.
+  ClockOffsetEstimate GetEstimate() const;
+
+ private:
+  // Minimum observation of a window.
+  struct WindowMinimum {
+    int64_t sensor_timestamp_ns;
+    int64_t offset_ns;
+  };
+
+  // Fits the clock model through the minima of the completed windows, or
+  // through the minimum of the current window if no window has completed.
+  void UpdateModel();
+
+  // Duration of the windows in nanoseconds.
+  static constexpr int64_t kWindowDurationNs = 1000000000;
+  // Number of window minima used for the fit.
+  static constexpr size_t kNumWindows = 32;
+  // Maximum delivery latency of a sensor event read right after it was
+  // produced, in nanoseconds.
+  static constexpr int64_t kMaxDeliveryLatencyNs = 2000000;
+
+  // Minima of the last kNumWindows completed windows, used as a ring buffer.
+  std::array<WindowMinimum, kNumWindows> window_minima_;
+  size_t num_window_minima_;
+  size_t next_window_minimum_index_;
+
+  // Minimum of the current window.
+  WindowMinimum current_window_minimum_;
+  int64_t current_window_start_ns_;
+  bool is_current_window_started_;
+
+  // Current model. See ClockOffsetEstimate.
+  ClockOffsetEstimate model_;
+
+  // Copy of the model for other threads. Fields can be torn between them, which
+  // is acceptable for diagnostics.
+  std::atomic<int64_t> published_timestamp_ns_;
+  std::atomic<int64_t> published_offset_ns_;
+  std::atomic<double> published_skew_;
+  std::atomic<bool> is_published_estimate_valid_;
+};
+
+}  // namespace cardboard
+
+#endif  // CARDBOARD_SDK_SENSORS_CLOCK_OFFSET_ESTIMATOR_H_
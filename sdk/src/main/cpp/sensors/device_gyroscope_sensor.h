@@ -16,16 +16,19 @@
 #ifndef CARDBOARD_SDK_SENSORS_DEVICE_GYROSCOPE_SENSOR_H_
 #define CARDBOARD_SDK_SENSORS_DEVICE_GYROSCOPE_SENSOR_H_
 
+#include <cstddef>
 #include <memory>
-#include <vector>
 
 #include "gyroscope_data.h"
+#include "sensor_event_batch.h"
+#include "sensor_sampling_config.h"
 #include "../util/vector.h"
 
 namespace cardboard {
 
 // Wrapper class that reads gyroscope sensor data from the native sensor
-// framework.
+// framework. The sensor event queue is attached to the event loop of the
+// thread constructing this object, which is expected to wait for the events.
 class DeviceGyroscopeSensor {
  public:
   DeviceGyroscopeSensor();
@@ -33,20 +36,21 @@ class DeviceGyroscopeSensor {
   ~DeviceGyroscopeSensor();
 
   // Starts the sensor capture process.
-  // This must be called successfully before calling PollForSensorData().
+  // This must be called successfully before calling ReadSensorData(). To change
+  // the sampling of a started sensor, call Stop() first.
   //
+  // @param config requested sampling period and hardware batching.
   // @return false if the requested sensor is not supported.
-  bool Start();
+  bool Start(const SensorSamplingConfig& config);
 
-  // Actively waits up to timeout_ms and polls for sensor data. If
-  // timeout_ms < 0, it waits indefinitely until sensor data is
-  // available.
+  // Reads up to kSensorEventBatchSize pending events without blocking. If the
+  // returned count equals kSensorEventBatchSize more events may be pending and
+  // this should be called again.
   // This must only be called after a successful call to Start() was made.
   //
-  // @param timeout_ms timeout period in milliseconds.
-  // @param results list of events emitted by the sensor.
-  void PollForSensorData(int timeout_ms,
-                         std::vector<GyroscopeData>* results) const;
+  // @param results batch that receives the events emitted by the sensor.
+  // @return number of events written to @p results.
+  size_t ReadSensorData(SensorEventBatch<GyroscopeData>* results) const;
 
   // Stops the sensor capture process.
   void Stop();
@@ -115,6 +115,8 @@ GyroscopeBiasEstimator::GyroscopeBiasEstimator()
       gyroscope_static_counter_(
           new IsStaticCounter(kStaticFrameDetectionThreshold)),
       current_accumulated_weights_gyroscope_bias_(0.f),
+      has_hardware_bias_(false),
+      has_static_bias_update_(false),
       mean_filter_(kFilterWindowSize),
       median_filter_(kFilterWindowSize),
       last_mean_filtered_accelerometer_value_({0, 0, 0}) {
@@ -129,6 +131,8 @@ void GyroscopeBiasEstimator::Reset() {
   gyroscope_bias_lowpass_filter_.Reset();
   accelerometer_static_counter_->Reset();
   gyroscope_static_counter_->Reset();
+  has_hardware_bias_ = false;
+  has_static_bias_update_ = false;
 }
 
 void GyroscopeBiasEstimator::ProcessGyroscope(const Vector3& gyroscope_sample,
@@ -158,6 +162,29 @@ void GyroscopeBiasEstimator::ProcessGyroscope(const Vector3& gyroscope_sample,
   }
 }
 
+void GyroscopeBiasEstimator::ProcessHardwareBias(const Vector3& hardware_bias,
+                                                 uint64_t timestamp_ns) {
+  // Once the device has been static the estimate from the static samples takes
+  // precedence over the driver estimate.
+  if (has_static_bias_update_) {
+    return;
+  }
+  // Before that, the bias filter follows the driver estimate so the static
+  // estimation starts from it.
+  gyroscope_bias_lowpass_filter_.Reset();
+  gyroscope_bias_lowpass_filter_.AddSample(hardware_bias, timestamp_ns);
+  has_hardware_bias_ = true;
+}
+
+void GyroscopeBiasEstimator::SeedGyroscopeBias(const Vector3& bias) {
+  // The first sample initializes the filter whatever its timestamp, and the
+  // next one is only used to restart the timestep measurement.
+  gyroscope_bias_lowpass_filter_.Reset();
+  gyroscope_bias_lowpass_filter_.AddSample(bias, 0);
+  has_hardware_bias_ = true;
+  has_static_bias_update_ = false;
+}
+
 void GyroscopeBiasEstimator::ProcessAccelerometer(
     const Vector3& accelerometer_sample, uint64_t timestamp_ns) {
   // Get current state of the filter.
@@ -273,6 +300,7 @@ bool GyroscopeBiasEstimator::UpdateGyroscopeBias(
   // This counter is only partially valid as the low pass filter drops large
   // samples.
   current_accumulated_weights_gyroscope_bias_ += update_weight;
+  has_static_bias_update_ = true;
 
   return true;
 }
@@ -281,6 +309,11 @@ Vector3 GyroscopeBiasEstimator::GetGyroscopeBias() const {
   return gyroscope_bias_lowpass_filter_.GetFilteredData();
 }
 
+bool GyroscopeBiasEstimator::IsStatic() const {
+  return gyroscope_static_counter_->IsRecentlyStatic() &&
+         accelerometer_static_counter_->IsRecentlyStatic();
+}
+
 bool GyroscopeBiasEstimator::IsCurrentEstimateValid() const {
   // Remove any bias component along the gravity because they cannot be
   // evaluated from accelerometer.
@@ -80,6 +80,24 @@ class GyroscopeBiasEstimator {
   virtual void ProcessAccelerometer(const Vector3& accelerometer_sample,
                                     uint64_t timestamp_ns);
 
+  // Seeds the estimation with the bias reported by the sensor driver. Until
+  // the device has been static, GetGyroscopeBias() returns this bias, and the
+  // static estimation then refines it instead of starting from the first
+  // static sample.
+  //
+  // @param hardware_bias the bias estimated by the sensor driver in
+  //     radians/sec.
+  // @param timestamp_ns the nanosecond at which the bias was reported.
+  virtual void ProcessHardwareBias(const Vector3& hardware_bias,
+                                   uint64_t timestamp_ns);
+
+  // Seeds the estimation with a bias learned in a previous session. It is used
+  // like a bias reported by the sensor driver, which replaces it when there is
+  // one.
+  //
+  // @param bias the gyroscope bias in radians/sec.
+  void SeedGyroscopeBias(const Vector3& bias);
+
   // Returns the estimated gyroscope bias.
   //
   // @return Estimated gyroscope bias. A vector with zeros is returned if no
@@ -89,6 +107,18 @@ class GyroscopeBiasEstimator {
   // Resets the estimator state.
   void Reset();
 
+  // Returns true if GetGyroscopeBias returns the bias reported by the sensor
+  // driver or a seeded bias, i.e. such a bias was processed and the device has
+  // not been static since the last reset.
+  bool IsHardwareBiasEstimate() const {
+    return has_hardware_bias_ && !has_static_bias_update_;
+  }
+
+  // Returns true if both the accelerometer and the gyroscope signals have been
+  // static for the last frames, i.e. the device is lying still. A single
+  // frame with motion resets it.
+  bool IsStatic() const;
+
   // Returns true if the current estimate returned by GetGyroscopeBias is
   // correct. The device (measured using the sensors) has to be static for this
   // function to return true.
@@ -123,6 +153,12 @@ class GyroscopeBiasEstimator {
   // Sum of the weight of sample used for gyroscope filtering.
   float current_accumulated_weights_gyroscope_bias_;
 
+  // Whether the bias filter was seeded with a bias from the sensor driver or
+  // from a previous session.
+  bool has_hardware_bias_;
+  // Whether the bias filter was updated with static gyroscope samples.
+  bool has_static_bias_update_;
+
   // Set of filters for accelerometer data to estimate a rotation
   // based only on accelerometer.
   MeanFilter mean_filter_;
@@ -16,6 +16,8 @@
 #ifndef CARDBOARD_SDK_SENSORS_GYROSCOPE_DATA_H_
 #define CARDBOARD_SDK_SENSORS_GYROSCOPE_DATA_H_
 
+#include <cstdint>
+
 #include "../util/vector.h"
 
 namespace cardboard {
@@ -31,6 +33,14 @@ struct GyroscopeData {
   // specification
   // (https://developer.android.com/guide/topics/sensors/sensors_overview.html#sensors-coords).
   Vector3 data;
+
+  // Whether the sensor driver reported its own bias estimate with this sample,
+  // as uncalibrated gyroscopes do. @p data is not compensated for it.
+  bool has_hardware_bias;
+
+  // Bias estimated by the sensor driver in rad/s. Only valid if
+  // has_hardware_bias is true.
+  Vector3 hardware_bias;
 };
 
 }  // namespace cardboard
@@ -38,4 +38,6 @@ Vector3 MeanFilter::GetFilteredData() const {
   return mean / static_cast<double>(filter_size_);
 }
 
+void MeanFilter::Reset() { buffer_.clear(); }
+
 }  // namespace cardboard
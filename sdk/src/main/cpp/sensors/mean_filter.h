@@ -16,6 +16,7 @@
 #ifndef CARDBOARD_SDK_SENSORS_MEAN_FILTER_H_
 #define CARDBOARD_SDK_SENSORS_MEAN_FILTER_H_
 
+#include <cstddef>
 #include <deque>
 
 #include "../util/vector.h"
@@ -38,6 +39,9 @@ class MeanFilter {
   // Returns the mean of values stored in the internal buffer.
   Vector3 GetFilteredData() const;
 
+  // Resets the filter, removing all samples that have been added.
+  void Reset();
+
  private:
   const size_t filter_size_;
   std::deque<Vector3> buffer_;
@@ -22,19 +22,38 @@
 namespace cardboard {
 
 // Stores a rotation and the angular velocity measured in the sensor space.
-// It can be used for prediction.
-struct RotationState {
+// It can be used for prediction. It is defined for the float and double scalar
+// types, RotationState being the double precision one.
+template <typename T>
+struct RotationStateT {
   // System wall time. It is measured in nanoseconds.
   int64_t timestamp;
 
   // Rotation from Sensor Space to Start Space. It is measured in radians (rad).
-  Rotation sensor_from_start_rotation;
+  RotationT<T> sensor_from_start_rotation;
 
   // First derivative of the rotation. It is measured in radians per second
   // (rad/s).
-  Vector3 sensor_from_start_rotation_velocity;
+  Vector<3, T> sensor_from_start_rotation_velocity;
+
+  // Low-pass filtered second derivative of the rotation. It is measured in
+  // radians per second squared (rad/s^2).
+  Vector<3, T> sensor_from_start_rotation_acceleration;
+
+  // Largest variance of the tilt error, i.e. of the rotation error around a
+  // horizontal axis, derived from the filter covariance. The heading error is
+  // left out: it is unobservable, and Start Space is defined by the heading of
+  // the filter. It is measured in squared radians (rad^2).
+  T rotation_variance;
+
+  // Growth of rotation_variance per squared second of prediction horizon, from
+  // the process noise and the gyroscope bias uncertainty. It is measured in
+  // squared radians per squared second (rad^2/s^2).
+  T rotation_variance_growth;
 };
 
+typedef RotationStateT<double> RotationState;
+
 }  // namespace cardboard
 
 #endif  // CARDBOARD_SDK_SENSORS_ROTATION_STATE_H_
@@ -0,0 +1,181 @@
+/*
+ * Copyright 2019 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "rotation_state_history.h"
+
+#include <cstring>
+
+namespace cardboard {
+
+namespace {
+
+uint64_t ToWord(double value) {
+  uint64_t word;
+  std::memcpy(&word, &value, sizeof(word));
+  return word;
+}
+
+double FromWord(uint64_t word) {
+  double value;
+  std::memcpy(&value, &word, sizeof(value));
+  return value;
+}
+
+}  // namespace
+
+RotationStateHistory::RotationStateHistory()
+    : num_started_(0),
+      num_written_(0),
+      first_index_(0),
+      latest_timestamp_(0),
+      is_empty_(true) {}
+
+void RotationStateHistory::Add(const RotationState& state) {
+  if (!is_empty_ && state.timestamp <= latest_timestamp_) {
+    return;
+  }
+  latest_timestamp_ = state.timestamp;
+  is_empty_ = false;
+
+  const uint64_t index = num_written_.load(std::memory_order_relaxed);
+  num_started_.store(index + 1, std::memory_order_relaxed);
+  // Readers seeing any word of this state also see num_started_.
+  std::atomic_thread_fence(std::memory_order_release);
+
+  const Rotation::QuaternionType& quaternion =
+      state.sensor_from_start_rotation.GetQuaternion();
+  const Vector3& velocity = state.sensor_from_start_rotation_velocity;
+  const Vector3& acceleration = state.sensor_from_start_rotation_acceleration;
+  Slot& slot = slots_[index & kIndexMask];
+  slot[0].store(static_cast<uint64_t>(state.timestamp),
+                std::memory_order_relaxed);
+  for (int i = 0; i < 4; ++i) {
+    slot[1 + i].store(ToWord(quaternion[i]), std::memory_order_relaxed);
+  }
+  for (int i = 0; i < 3; ++i) {
+    slot[5 + i].store(ToWord(velocity[i]), std::memory_order_relaxed);
+    slot[8 + i].store(ToWord(acceleration[i]), std::memory_order_relaxed);
+  }
+  slot[11].store(ToWord(state.rotation_variance), std::memory_order_relaxed);
+  slot[12].store(ToWord(state.rotation_variance_growth),
+                 std::memory_order_relaxed);
+
+  num_written_.store(index + 1, std::memory_order_release);
+}
+
+void RotationStateHistory::Clear() {
+  first_index_.store(num_written_.load(std::memory_order_relaxed),
+                     std::memory_order_release);
+  is_empty_ = true;
+}
+
+bool RotationStateHistory::GetRotationState(int64_t timestamp,
+                                            RotationState* state) const {
+  while (true) {
+    const uint64_t end = num_written_.load(std::memory_order_acquire);
+    uint64_t begin = first_index_.load(std::memory_order_acquire);
+    // The oldest slot may be overwritten by the next write already.
+    if (end > begin + kCapacity - 1) {
+      begin = end - (kCapacity - 1);
+    }
+    if (begin >= end) {
+      return false;
+    }
+
+    // Binary search of the last state at or before the timestamp.
+    bool is_in_history = false;
+    RotationState before;
+    RotationState after;
+    if (LoadTimestamp(begin) <= timestamp &&
+        timestamp <= LoadTimestamp(end - 1)) {
+      uint64_t low = begin;
+      uint64_t high = end - 1;
+      while (low < high) {
+        const uint64_t middle = low + (high - low + 1) / 2;
+        if (LoadTimestamp(middle) <= timestamp) {
+          low = middle;
+        } else {
+          high = middle - 1;
+        }
+      }
+      before = LoadState(low);
+      after = low + 1 < end ? LoadState(low + 1) : before;
+      is_in_history = true;
+    }
+
+    // Retries if a slot that was read was overwritten meanwhile.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (num_started_.load(std::memory_order_relaxed) > begin + kCapacity) {
+      continue;
+    }
+    if (!is_in_history) {
+      return false;
+    }
+
+    *state = before;
+    state->timestamp = timestamp;
+    if (after.timestamp > before.timestamp) {
+      const double t = static_cast<double>(timestamp - before.timestamp) /
+                       static_cast<double>(after.timestamp - before.timestamp);
+      state->sensor_from_start_rotation = Rotation::Slerp(
+          before.sensor_from_start_rotation, after.sensor_from_start_rotation,
+          t);
+      state->sensor_from_start_rotation_velocity =
+          (1 - t) * before.sensor_from_start_rotation_velocity +
+          t * after.sensor_from_start_rotation_velocity;
+      state->sensor_from_start_rotation_acceleration =
+          (1 - t) * before.sensor_from_start_rotation_acceleration +
+          t * after.sensor_from_start_rotation_acceleration;
+      state->rotation_variance =
+          (1 - t) * before.rotation_variance + t * after.rotation_variance;
+      state->rotation_variance_growth =
+          (1 - t) * before.rotation_variance_growth +
+          t * after.rotation_variance_growth;
+    }
+    return true;
+  }
+}
+
+int64_t RotationStateHistory::LoadTimestamp(uint64_t index) const {
+  return static_cast<int64_t>(
+      slots_[index & kIndexMask][0].load(std::memory_order_relaxed));
+}
+
+RotationState RotationStateHistory::LoadState(uint64_t index) const {
+  const Slot& slot = slots_[index & kIndexMask];
+  RotationState state;
+  state.timestamp =
+      static_cast<int64_t>(slot[0].load(std::memory_order_relaxed));
+  state.sensor_from_start_rotation =
+      Rotation::FromQuaternion(Rotation::QuaternionType(
+          FromWord(slot[1].load(std::memory_order_relaxed)),
+          FromWord(slot[2].load(std::memory_order_relaxed)),
+          FromWord(slot[3].load(std::memory_order_relaxed)),
+          FromWord(slot[4].load(std::memory_order_relaxed))));
+  state.sensor_from_start_rotation_velocity =
+      Vector3(FromWord(slot[5].load(std::memory_order_relaxed)),
+              FromWord(slot[6].load(std::memory_order_relaxed)),
+              FromWord(slot[7].load(std::memory_order_relaxed)));
+  state.sensor_from_start_rotation_acceleration =
+      Vector3(FromWord(slot[8].load(std::memory_order_relaxed)),
+              FromWord(slot[9].load(std::memory_order_relaxed)),
+              FromWord(slot[10].load(std::memory_order_relaxed)));
+  state.rotation_variance = FromWord(slot[11].load(std::memory_order_relaxed));
+  state.rotation_variance_growth =
+      FromWord(slot[12].load(std::memory_order_relaxed));
+  return state;
+}
+
+}  // namespace cardboard
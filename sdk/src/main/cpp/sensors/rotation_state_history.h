@@ -0,0 +1,98 @@
+/*
+ * Copyright 2019 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef CARDBOARD_SDK_SENSORS_ROTATION_STATE_HISTORY_H_
+#define CARDBOARD_SDK_SENSORS_ROTATION_STATE_HISTORY_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "rotation_state.h"
+
+namespace cardboard {
+
+// Fixed capacity history of the recent rotation states, e.g. for late latching
+// or to tag video frames with the pose at their capture time.
+//
+// Add() and Clear() must be called from a single thread (e.g. the fusion
+// thread); they never allocate and are wait-free. GetRotationState() can be
+// called from any thread and is lock-free: it only retries when the states it
+// read were overwritten meanwhile, which requires the writer to add
+// kCapacity - 1 states during the query.
+//
+// The states are stored as relaxed atomic words. The writer announces each
+// write before storing it, so that a reader detects overwritten states
+// (sequence lock).
+class RotationStateHistory {
+ public:
+  // Number of states kept. About 2 seconds at 500 Hz.
+  static constexpr size_t kCapacity = 1024;
+
+  RotationStateHistory();
+
+  // Adds a state. Must only be called by the writer.
+  //
+  // @param state state to add. It is ignored unless its timestamp is later
+  //     than the one of the previously added state.
+  void Add(const RotationState& state);
+
+  // Removes all states. Must only be called by the writer.
+  void Clear();
+
+  // Gets the state at @p timestamp, interpolated between the states
+  // bracketing it: the rotation spherically, the other members linearly. The
+  // lookup is a binary search.
+  //
+  // @param timestamp requested time, in the clock of the states.
+  // @param state receives the interpolated state.
+  // @return false if @p timestamp is not within the history, in which case
+  //     @p state is not modified.
+  bool GetRotationState(int64_t timestamp, RotationState* state) const;
+
+ private:
+  static_assert((kCapacity & (kCapacity - 1)) == 0,
+                "kCapacity must be a power of two.");
+  static constexpr size_t kIndexMask = kCapacity - 1;
+  // Timestamp, quaternion, velocity, acceleration and variances.
+  static constexpr size_t kNumWords = 13;
+  // Avoids false sharing between the writer counters and the reader.
+  static constexpr size_t kCacheLineSize = 64;
+
+  typedef std::array<std::atomic<uint64_t>, kNumWords> Slot;
+
+  // Loads the timestamp of the state of index @p index.
+  int64_t LoadTimestamp(uint64_t index) const;
+  // Loads the state of index @p index.
+  RotationState LoadState(uint64_t index) const;
+
+  std::array<Slot, kCapacity> slots_;
+  // Number of states whose write started, and number of states written.
+  alignas(kCacheLineSize) std::atomic<uint64_t> num_started_;
+  std::atomic<uint64_t> num_written_;
+  // Index of the oldest state kept by Clear().
+  std::atomic<uint64_t> first_index_;
+  // Timestamp of the latest added state. Only accessed by the writer.
+  int64_t latest_timestamp_;
+  bool is_empty_;
+
+  RotationStateHistory(const RotationStateHistory&) = delete;
+  RotationStateHistory& operator=(const RotationStateHistory&) = delete;
+};
+
+}  // namespace cardboard
+
+#endif  // CARDBOARD_SDK_SENSORS_ROTATION_STATE_HISTORY_H_
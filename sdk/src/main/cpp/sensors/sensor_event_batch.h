@@ -0,0 +1,69 @@
+/*
+ * Copyright 2019 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef CARDBOARD_SDK_SENSORS_SENSOR_EVENT_BATCH_H_
+#define CARDBOARD_SDK_SENSORS_SENSOR_EVENT_BATCH_H_
+
+#include <array>
+#include <cstddef>
+
+namespace cardboard {
+
+// Maximum number of events read from a sensor event queue with a single call.
+// Sensor hubs deliver FIFO batches of a few tens of events per wakeup, so this
+// keeps the number of reads per wakeup at one or two.
+constexpr size_t kSensorEventBatchSize = 32;
+
+// Fixed size buffer holding one batch of sensor events. It is allocated once by
+// the capture thread and reused for every read.
+template <typename DataType>
+using SensorEventBatch = std::array<DataType, kSensorEventBatchSize>;
+
+// Reads up to kSensorEventBatchSize events from a sensor event queue and
+// converts them into sensor samples.
+//
+// The queue is abstracted behind @p read_events so that the same batching logic
+// is used with the platform queue (e.g. ASensorEventQueue_getEvents() on
+// Android) and with a fake queue on the host.
+//
+// @param read_events callable with signature
+//     `int(EventType* events, size_t max_count)` returning the number of events
+//     written to @p events, or a value <= 0 if the queue is empty.
+// @param parse_event callable with signature
+//     `bool(const EventType& event, DataType* sample)` returning false if the
+//     event must be discarded.
+// @param event_buffer scratch buffer for the raw events.
+// @param results buffer that receives the parsed samples.
+// @return number of samples written to @p results.
+template <typename EventType, typename DataType, typename ReadEventsFn,
+          typename ParseEventFn>
+size_t ReadSensorEventBatch(const ReadEventsFn& read_events,
+                            const ParseEventFn& parse_event,
+                            SensorEventBatch<EventType>* event_buffer,
+                            SensorEventBatch<DataType>* results) {
+  const int num_events =
+      read_events(event_buffer->data(), event_buffer->size());
+  size_t num_results = 0;
+  for (int i = 0; i < num_events; ++i) {
+    if (parse_event((*event_buffer)[i], &(*results)[num_results])) {
+      ++num_results;
+    }
+  }
+  return num_results;
+}
+
+}  // namespace cardboard
+
+#endif  // CARDBOARD_SDK_SENSORS_SENSOR_EVENT_BATCH_H_
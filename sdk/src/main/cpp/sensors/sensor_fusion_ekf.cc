@@ -17,6 +17,8 @@
 
 #include <algorithm>
 #include <cmath>
+#include <limits>
+#include <type_traits>
 
 #include "accelerometer_data.h"
 #include "gyroscope_data.h"
@@ -27,7 +29,14 @@ namespace cardboard {
 
 namespace {
 
+// Step of the numerical differentiation. It is raised to the square root of the
+// machine epsilon for the scalar types where 1e-7 is below it.
 const double kFiniteDifferencingEpsilon = 1e-7;
+// Below this sine of the innovation angle the closed-form measurement Jacobian
+// uses its small-angle limit, or numerical differentiation when the predicted
+// and measured down directions are opposite. It is raised like
+// kFiniteDifferencingEpsilon.
+const double kMinInnovationSine = 1e-6;
 const double kEpsilon = 1e-15;
 // Default gyroscope frequency. This corresponds to 100 Hz.
 const double kDefaultGyroscopeTimestep_s = 0.01f;
@@ -44,6 +53,22 @@ const double kMaxAccelNoiseSigma = 7.0;
 // Initial value for the diagonal elements of the different covariance matrices.
 const double kInitialStateCovarianceValue = 25.0;
 const double kInitialProcessCovarianceValue = 1.0;
+// Initial standard deviation of the gyroscope bias in the state, in rad/s.
+const double kInitialGyroscopeBiasSigma = 0.03;
+// Standard deviation of the bias reported by the sensor driver, when it seeds
+// the gyroscope bias in the state, in rad/s.
+const double kHardwareGyroscopeBiasSigma = 0.01;
+// Variance of the random walk of the gyroscope bias in the state, in
+// (rad/s)^2/s.
+const double kGyroscopeBiasRandomWalkVariance = 1e-8;
+// Standard deviation of the bias learned while the device lies still, when it
+// is fused as a measurement, in rad/s.
+const double kStaticGyroscopeBiasSigma = 0.002;
+// Minimum time between two fusions of the static bias, in nanoseconds. The
+// bias estimator low-pass filters the gyroscope with a time constant of about
+// one second, so its estimates are only independent measurements that far
+// apart.
+const uint64_t kStaticGyroscopeBiasFusionPeriodNs = 1000000000;
 // Maximum accelerometer norm change allowed before capping it covariance to a
 // large value.
 const double kMaxAccelNormChange = 0.15;
@@ -51,20 +76,122 @@ const double kMaxAccelNormChange = 0.15;
 const double kTimestepFilterCoeff = 0.95;
 // Minimum number of sample for timestep filtering.
 const int kTimestepFilterMinSamples = 10;
+// Sizes of the windows of the median and mean filters aligning the rotation
+// with gravity. The alignment needs their sum minus one samples.
+const size_t kGravityAlignmentMedianWindowSize = 5;
+const size_t kGravityAlignmentMeanWindowSize = 8;
+// Maximum deviation in m/s^2 of the accelerometer median within the gravity
+// alignment window. About 3 degrees of tilt.
+const double kMaxGravityAlignmentDeviation = 0.5;
+// Maximum delay of the gravity alignment in nanoseconds. When the device does
+// not settle in time, the rotation is aligned with the latest median.
+const uint64_t kMaxGravityAlignmentDelayNs = 200000000;
+
+// Time constant in seconds of the low-pass filter of the angular acceleration.
+// It trades the gyroscope noise amplified by the differentiation for delay.
+const double kAngularAccelerationFilterTimeConstant_s = 0.01;
+// Time constant in seconds of the damping of the angular acceleration in the
+// prediction. Head turns rarely accelerate for longer.
+const double kAngularAccelerationDampingTime_s = 0.08;
+
+// Number of standard deviations of the rotation uncertainty.
+const double kRotationUncertaintySigmas = 3.0;
+
+// Period of the snapshots of the learned state, in nanoseconds.
+const uint64_t kSnapshotPeriodNs = 1000000000;
 
 // Z direction in start space.
-const Vector3 kCanonicalZDirection(0.0, 0.0, 1.0);
+template <typename T>
+const Vector<3, T> kCanonicalZDirection(0.0, 0.0, 1.0);
+
+// Returns @p value, raised to the square root of the machine epsilon of @p T.
+template <typename T>
+T AtLeastSqrtEpsilon(double value) {
+  return std::max(static_cast<T>(value),
+                  std::sqrt(std::numeric_limits<T>::epsilon()));
+}
+
+// Returns the matrix [v]x such that [v]x * a = v x a.
+template <typename T>
+Matrix3x3T<T> CrossProductMatrix(const Vector<3, T>& v) {
+  return Matrix3x3T<T>(0, -v[2], v[1], v[2], 0, -v[0], -v[1], v[0], 0);
+}
+
+// Converts a rotation between scalar types. This is a copy when both types
+// are the same.
+template <typename To, typename From>
+RotationT<To> ConvertRotation(const RotationT<From>& rotation) {
+  if constexpr (std::is_same<To, From>::value) {
+    return rotation;
+  } else {
+    return RotationT<To>::FromQuaternion(
+        Vector<4, To>(rotation.GetQuaternion()));
+  }
+}
+
+// Converts a symmetric matrix between scalar types.
+template <typename To, typename From>
+SymmetricMatrix3x3T<To> ConvertSymmetricMatrix(
+    const SymmetricMatrix3x3T<From>& m) {
+  SymmetricMatrix3x3T<To> result;
+  for (int row = 0; row < 3; ++row) {
+    for (int col = row; col < 3; ++col) {
+      result(row, col) = static_cast<To>(m(row, col));
+    }
+  }
+  return result;
+}
+
+// Returns an upper bound of the largest eigenvalue of the symmetric matrix
+// @p m, i.e. its largest absolute row sum (Gershgorin circle theorem).
+template <typename T>
+T LargestEigenvalueBound(const SymmetricMatrix3x3T<T>& m) {
+  T bound = 0;
+  for (int row = 0; row < 3; ++row) {
+    bound = std::max(bound, std::abs(m(row, 0)) + std::abs(m(row, 1)) +
+                                std::abs(m(row, 2)));
+  }
+  return bound;
+}
+
+// Returns the largest eigenvalue of the symmetric matrix @p m restricted to the
+// plane orthogonal to the unit vector @p normal.
+template <typename T>
+T LargestEigenvalueInPlane(const SymmetricMatrix3x3T<T>& m,
+                           const Vector<3, T>& normal) {
+  // Orthonormal basis (u, v) of the plane, built from the canonical axis
+  // least aligned with the normal.
+  int axis = 0;
+  for (int i = 1; i < 3; ++i) {
+    if (std::abs(normal[i]) < std::abs(normal[axis])) {
+      axis = i;
+    }
+  }
+  Vector<3, T> canonical_axis = Vector<3, T>::Zero();
+  canonical_axis[axis] = 1;
+  const Vector<3, T> u = Normalized(Cross(normal, canonical_axis));
+  const Vector<3, T> v = Cross(normal, u);
+
+  const Matrix3x3T<T> matrix = m.ToMatrix();
+  const T uu = Dot(u, matrix * u);
+  const T uv = Dot(u, matrix * v);
+  const T vv = Dot(v, matrix * v);
+  const T half_difference = (uu - vv) / 2;
+  return (uu + vv) / 2 +
+         std::sqrt(half_difference * half_difference + uv * uv);
+}
 
 // Computes a axis angle rotation from the input vector.
 // angle = norm(a)
 // axis = a.normalized()
 // If norm(a) == 0, it returns an identity rotation.
-Rotation RotationFromVector(const Vector3& a) {
-  const double norm_a = Length(a);
+template <typename T>
+RotationT<T> RotationFromVector(const Vector<3, T>& a) {
+  const T norm_a = Length(a);
   if (norm_a < kEpsilon) {
-    return Rotation::Identity();
+    return RotationT<T>::Identity();
   }
-  return Rotation::FromAxisAndAngle(a / norm_a, norm_a);
+  return RotationT<T>::FromAxisAndAngle(a / norm_a, norm_a);
 }
 
 // Computes a rotation matrix based on the integration of the gyroscope_value
@@ -74,24 +201,41 @@ Rotation RotationFromVector(const Vector3& a) {
 // @param timestep_s integration period in seconds.
 // @return Integration of the gyroscope value the rotation is from Start to
 //         Sensor Space.
-Rotation GetRotationFromGyroscope(const Vector3& gyroscope_value,
-                                  double timestep_s) {
-  const double velocity = Length(gyroscope_value);
+template <typename T>
+RotationT<T> GetRotationFromGyroscope(const Vector<3, T>& gyroscope_value,
+                                      double timestep_s) {
+  const T velocity = Length(gyroscope_value);
 
   // When there is no rotation data return an identity rotation.
   if (velocity < kEpsilon) {
     CARDBOARD_LOGI(
         "PosePrediction::GetRotationFromGyroscope: Velocity really small, "
         "returning identity rotation.");
-    return Rotation::Identity();
+    return RotationT<T>::Identity();
   }
   // Since the gyroscope_value is a start from sensor transformation we need to
   // invert it to have a sensor from start transformation, hence the minus sign.
   // For more info:
   // - http://developer.android.com/guide/topics/sensors/sensors_motion.html#sensors-motion-gyro
   // - https://developer.apple.com/documentation/coremotion/getting_raw_gyroscope_events
-  return Rotation::FromAxisAndAngle(gyroscope_value / velocity,
-                                    -timestep_s * velocity);
+  return RotationT<T>::FromAxisAndAngle(gyroscope_value / velocity,
+                                        static_cast<T>(-timestep_s) * velocity);
+}
+
+// Returns the derivative of the unit quaternion @p q of a rotation from the
+// start of the timestep to the Sensor Space, q' = 0.5 * q * (velocity, 0).
+template <typename T>
+Vector<4, T> QuaternionDerivative(const Vector<4, T>& q,
+                                  const Vector<3, T>& velocity) {
+  return static_cast<T>(0.5) *
+         Vector<4, T>(q[3] * velocity[0] + q[1] * velocity[2] -
+                          q[2] * velocity[1],
+                      q[3] * velocity[1] + q[2] * velocity[0] -
+                          q[0] * velocity[2],
+                      q[3] * velocity[2] + q[0] * velocity[1] -
+                          q[1] * velocity[0],
+                      -q[0] * velocity[0] - q[1] * velocity[1] -
+                          q[2] * velocity[2]);
 }
 
 // Returns the difference of @p timestamp_ns_a and @p timestamp_ns_b in
@@ -103,80 +247,360 @@ constexpr double ComputeTimeDifferenceInSeconds(int64_t timestamp_ns_a,
 
 }  // namespace
 
-SensorFusionEkf::SensorFusionEkf()
-    : execute_reset_with_next_accelerometer_sample_(false),
-      gyroscope_bias_estimate_({0, 0, 0}) {
+template <typename T>
+SensorFusionEkfT<T>::SensorFusionEkfT(SensorFusionStateModel state_model)
+    : gravity_alignment_median_filter_(kGravityAlignmentMedianWindowSize),
+      gravity_alignment_mean_filter_(kGravityAlignmentMeanWindowSize),
+      state_model_(state_model),
+      gyroscope_integration_scheme_(kGyroscopeIntegrationExponentialMap),
+      correction_schedule_(kEverySampleCorrectionSchedule),
+      execute_reset_with_next_accelerometer_sample_(false),
+      has_pending_start_space_rotation_(false),
+      has_pending_yaw_recenter_(false),
+      pending_start_space_rotation_(RotationType::Identity()),
+      has_snapshot_(false),
+      rotation_prediction_model_(kRotationPredictionConstantVelocity),
+      gyroscope_bias_estimate_({0, 0, 0}),
+      has_learned_gyroscope_bias_(false) {
   ResetState();
+  PublishState();
 }
 
-void SensorFusionEkf::Reset() {
+template <typename T>
+void SensorFusionEkfT<T>::Reset() {
   execute_reset_with_next_accelerometer_sample_ = true;
 }
 
-void SensorFusionEkf::RotateSensorSpaceToStartSpaceTransformation(
+template <typename T>
+bool SensorFusionEkfT<T>::GetSnapshot(SensorFusionSnapshot* snapshot) const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (!has_snapshot_) {
+    return false;
+  }
+  *snapshot = latest_snapshot_;
+  return true;
+}
+
+template <typename T>
+void SensorFusionEkfT<T>::RestoreSnapshot(
+    const SensorFusionSnapshot& snapshot) {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    latest_snapshot_ = snapshot;
+    has_snapshot_ = true;
+  }
+  // ResetState() initializes the learned state from the latest snapshot.
+  Reset();
+}
+
+template <typename T>
+void SensorFusionEkfT<T>::RotateSensorSpaceToStartSpaceTransformation(
     const Rotation& rotation) {
-  current_state_.sensor_from_start_rotation *= rotation;
+  std::unique_lock<std::mutex> lock(mutex_);
+  pending_start_space_rotation_ *= ConvertRotation<T>(rotation);
+  has_pending_start_space_rotation_ = true;
+}
+
+template <typename T>
+void SensorFusionEkfT<T>::RecenterYaw() {
+  has_pending_yaw_recenter_ = true;
+}
+
+template <typename T>
+void SensorFusionEkfT<T>::ApplyPendingStartSpaceRotation() {
+  if (ApplyPendingStartSpaceRotationToState()) {
+    PublishState();
+  }
+}
+
+template <typename T>
+bool SensorFusionEkfT<T>::ApplyPendingStartSpaceRotationToState() {
+  bool is_applied = false;
+  // The state error is a rotation of Sensor Space, so neither the covariance
+  // nor the pre-integrated motion depend on Start Space.
+  if (has_pending_start_space_rotation_.exchange(false)) {
+    RotationType rotation;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      rotation = pending_start_space_rotation_;
+      pending_start_space_rotation_ = RotationType::Identity();
+    }
+    current_state_.sensor_from_start_rotation *= rotation;
+    // The states of the history are in the previous Start Space.
+    rotation_state_history_.Clear();
+    is_applied = true;
+  }
+
+  // The recenter stays pending until the alignment with gravity.
+  if (is_aligned_with_gravity_ && has_pending_yaw_recenter_.exchange(false)) {
+    // A reset would align Start Space with the current gravity along the
+    // shortest arc. Both rotations map the Start Space Z axis to gravity, so
+    // they only differ by a rotation around it.
+    const RotationType& sensor_from_start =
+        current_state_.sensor_from_start_rotation;
+    const RotationType recentered_sensor_from_start = RotationType::RotateInto(
+        kCanonicalZDirection<T>, sensor_from_start * kCanonicalZDirection<T>);
+    const typename RotationType::QuaternionType yaw_correction =
+        (-sensor_from_start * recentered_sensor_from_start).GetQuaternion();
+    // Only the rotation around Z is kept, the rounding errors tilting it are
+    // dropped.
+    current_state_.sensor_from_start_rotation *= RotationType::FromAxisAndAngle(
+        kCanonicalZDirection<T>,
+        2 * std::atan2(yaw_correction[2], yaw_correction[3]));
+    rotation_state_history_.Clear();
+    is_applied = true;
+  }
+  return is_applied;
 }
 
-void SensorFusionEkf::ResetState() {
-  current_state_.sensor_from_start_rotation = Rotation::Identity();
-  current_state_.sensor_from_start_rotation_velocity = Vector3::Zero();
+template <typename T>
+void SensorFusionEkfT<T>::ResetState() {
+  current_state_.timestamp = 0;
+  current_state_.sensor_from_start_rotation = RotationType::Identity();
+  current_state_.sensor_from_start_rotation_velocity = VectorType::Zero();
+  current_state_.sensor_from_start_rotation_acceleration = VectorType::Zero();
 
   current_gyroscope_sensor_timestamp_ns_ = 0;
   current_accelerometer_sensor_timestamp_ns_ = 0;
+  last_correction_sensor_timestamp_ns_ = 0;
+  last_snapshot_sensor_timestamp_ns_ = 0;
+  last_static_bias_fusion_sensor_timestamp_ns_ = 0;
+  can_seed_gyroscope_bias_state_ = true;
+
+  state_covariance_ =
+      SymmetricMatrixType::Identity() * kInitialStateCovarianceValue;
+  rotation_bias_covariance_ = MatrixType::Zero();
+  gyroscope_bias_covariance_ =
+      SymmetricMatrixType::Identity() *
+      (kInitialGyroscopeBiasSigma * kInitialGyroscopeBiasSigma);
+  process_noise_variance_ = kInitialProcessCovarianceValue;
+  accelerometer_measurement_variance_ =
+      kMinAccelNoiseSigma * kMinAccelNoiseSigma;
 
-  state_covariance_ = Matrix3x3::Identity() * kInitialStateCovarianceValue;
-  process_covariance_ = Matrix3x3::Identity() * kInitialProcessCovarianceValue;
-  accelerometer_measurement_covariance_ =
-      Matrix3x3::Identity() * kMinAccelNoiseSigma * kMinAccelNoiseSigma;
-  innovation_covariance_ = Matrix3x3::Identity();
+  accelerometer_measurement_jacobian_ = MatrixType::Zero();
+  innovation_ = VectorType::Zero();
+  accelerometer_measurement_ = VectorType::Zero();
+  prediction_ = VectorType::Zero();
+  control_input_ = VectorType::Zero();
+  state_update_ = VectorType::Zero();
+  gyroscope_bias_update_ = VectorType::Zero();
 
-  accelerometer_measurement_jacobian_ = Matrix3x3::Zero();
-  kalman_gain_ = Matrix3x3::Zero();
-  innovation_ = Vector3::Zero();
-  accelerometer_measurement_ = Vector3::Zero();
-  prediction_ = Vector3::Zero();
-  control_input_ = Vector3::Zero();
-  state_update_ = Vector3::Zero();
+  preintegrated_rotation_ = RotationType::Identity();
+  preintegrated_squared_timestep_s2_ = 0;
+  preintegrated_bias_jacobian_ = MatrixType::Zero();
+  preintegrated_time_s_ = 0;
+
+  accumulated_accelerometer_measurement_ = VectorType::Zero();
+  num_accumulated_accelerometer_samples_ = 0;
 
   moving_average_accelerometer_norm_change_ = 0.0;
 
   is_timestep_filter_initialized_ = false;
   is_gyroscope_filter_valid_ = false;
   is_aligned_with_gravity_ = false;
+  rotation_state_history_.Clear();
+  gravity_alignment_median_filter_.Reset();
+  gravity_alignment_mean_filter_.Reset();
+  gravity_alignment_reference_ = Vector3::Zero();
+  gravity_alignment_start_timestamp_ns_ = 0;
+  is_device_static_ = false;
 
   // Reset biases.
   gyroscope_bias_estimator_.Reset();
   gyroscope_bias_estimate_ = {0, 0, 0};
+  has_learned_gyroscope_bias_ = false;
+
+  // Warm start. The latest snapshot holds the state learned before the reset,
+  // or restored from a previous session.
+  SensorFusionSnapshot snapshot;
+  bool has_snapshot;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    snapshot = latest_snapshot_;
+    has_snapshot = has_snapshot_;
+  }
+  if (has_snapshot) {
+    ApplySnapshot(snapshot);
+  }
+  UpdateRotationVariance();
+}
+
+template <typename T>
+void SensorFusionEkfT<T>::ApplySnapshot(const SensorFusionSnapshot& snapshot) {
+  // The rotation covariance is not restored: it is expressed in the Sensor
+  // Space of the previous alignment with gravity, so it starts again from
+  // kInitialStateCovarianceValue.
+  if (snapshot.has_gyroscope_timestep) {
+    filtered_gyroscope_timestep_s_ = snapshot.gyroscope_timestep_s;
+    num_gyroscope_timestep_samples_ = kTimestepFilterMinSamples + 1;
+    is_timestep_filter_initialized_ = true;
+    is_gyroscope_filter_valid_ = true;
+  }
+
+  if (snapshot.has_gyroscope_bias) {
+    gyroscope_bias_estimate_ = VectorType(snapshot.gyroscope_bias);
+    gyroscope_bias_covariance_ =
+        ConvertSymmetricMatrix<T>(snapshot.gyroscope_bias_covariance);
+    // Without the bias in the state, the bias estimator provides the bias
+    // until the device lies still.
+    gyroscope_bias_estimator_.SeedGyroscopeBias(snapshot.gyroscope_bias);
+    has_learned_gyroscope_bias_ = true;
+    // The learned bias is more accurate than the one of the sensor driver.
+    can_seed_gyroscope_bias_state_ = false;
+  }
+}
+
+template <typename T>
+bool SensorFusionEkfT<T>::AlignWithGravity(const AccelerometerData& sample) {
+  if (gravity_alignment_start_timestamp_ns_ == 0) {
+    gravity_alignment_start_timestamp_ns_ = sample.sensor_timestamp_ns;
+  }
+
+  gravity_alignment_median_filter_.AddSample(sample.data);
+  if (gravity_alignment_median_filter_.IsValid()) {
+    const Vector3 median = gravity_alignment_median_filter_.GetFilteredData();
+    if (Length(median - gravity_alignment_reference_) >
+        kMaxGravityAlignmentDeviation) {
+      // The device moves, so the window restarts from the current median.
+      gravity_alignment_mean_filter_.Reset();
+      gravity_alignment_reference_ = median;
+    }
+    gravity_alignment_mean_filter_.AddSample(median);
+  }
+
+  Vector3 gravity;
+  if (gravity_alignment_mean_filter_.IsValid()) {
+    gravity = gravity_alignment_mean_filter_.GetFilteredData();
+  } else if (sample.sensor_timestamp_ns -
+                 gravity_alignment_start_timestamp_ns_ >=
+             kMaxGravityAlignmentDelayNs) {
+    gravity = gravity_alignment_median_filter_.IsValid()
+                  ? gravity_alignment_median_filter_.GetFilteredData()
+                  : sample.data;
+  } else {
+    return false;
+  }
+
+  current_state_.sensor_from_start_rotation =
+      RotationType::RotateInto(kCanonicalZDirection<T>, VectorType(gravity));
+  return true;
+}
+
+template <typename T>
+void SensorFusionEkfT<T>::CaptureSnapshot() {
+  SensorFusionSnapshot snapshot;
+  snapshot.gyroscope_bias = Vector3(gyroscope_bias_estimate_);
+  if (state_model_ == kRotationAndGyroscopeBiasStateModel) {
+    // The covariance tells how much of the bias was learned.
+    snapshot.has_gyroscope_bias = true;
+    snapshot.gyroscope_bias_covariance =
+        ConvertSymmetricMatrix<double>(gyroscope_bias_covariance_);
+  } else {
+    snapshot.has_gyroscope_bias = has_learned_gyroscope_bias_;
+    const double sigma = has_learned_gyroscope_bias_
+                             ? kStaticGyroscopeBiasSigma
+                             : kInitialGyroscopeBiasSigma;
+    snapshot.gyroscope_bias_covariance =
+        SymmetricMatrix3x3::Identity() * (sigma * sigma);
+  }
+  snapshot.gyroscope_timestep_s = filtered_gyroscope_timestep_s_;
+  snapshot.has_gyroscope_timestep = is_gyroscope_filter_valid_;
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  latest_snapshot_ = snapshot;
+  has_snapshot_ = true;
 }
 
 // Here I am doing something wrong relative to time stamps. The state timestamps
 // always correspond to the gyrostamps because it would require additional
 // extrapolation if I wanted to do otherwise.
-RotationState SensorFusionEkf::GetLatestRotationState() const {
-  std::unique_lock<std::mutex> lock(mutex_);
-  return current_state_;
+template <typename T>
+RotationState SensorFusionEkfT<T>::GetLatestRotationState() const {
+  return published_state_.Read();
 }
 
-Rotation SensorFusionEkf::PredictRotation(int64_t requested_timestamp) const {
-  std::unique_lock<std::mutex> lock(mutex_);
+template <typename T>
+Rotation SensorFusionEkfT<T>::PredictRotation(
+    int64_t requested_timestamp) const {
+  return PredictRotation(published_state_.Read(), requested_timestamp);
+}
+
+template <typename T>
+Rotation SensorFusionEkfT<T>::PredictRotation(
+    const RotationState& state, int64_t requested_timestamp) const {
   // If the required timestamp is equal to zero, return the current pose.
   if (requested_timestamp == 0) {
-    return current_state_.sensor_from_start_rotation;
+    return state.sensor_from_start_rotation;
+  }
+
+  RotationState past_state;
+  if (requested_timestamp < state.timestamp &&
+      rotation_state_history_.GetRotationState(requested_timestamp,
+                                               &past_state)) {
+    return past_state.sensor_from_start_rotation;
   }
 
   // Subtracting unsigned numbers is bad when the result is negative.
-  const double timestep_s = ComputeTimeDifferenceInSeconds(
-      requested_timestamp, current_state_.timestamp);
+  const double timestep_s =
+      ComputeTimeDifferenceInSeconds(requested_timestamp, state.timestamp);
 
-  const Rotation update = GetRotationFromGyroscope(
-      current_state_.sensor_from_start_rotation_velocity, timestep_s);
-  return update * current_state_.sensor_from_start_rotation;
+  Vector3 velocity = state.sensor_from_start_rotation_velocity;
+  if (rotation_prediction_model_ == kRotationPredictionConstantAcceleration &&
+      timestep_s > 0) {
+    // With the acceleration damped with the time constant tau, the velocity is
+    // w(t) = w0 + a * tau * (1 - exp(-t / tau)). Its mean over the horizon
+    // gives the rotation.
+    const double tau = kAngularAccelerationDampingTime_s;
+    velocity += state.sensor_from_start_rotation_acceleration *
+                (tau * (1 - tau / timestep_s *
+                                (1 - std::exp(-timestep_s / tau))));
+  }
+  const Rotation update = GetRotationFromGyroscope(velocity, timestep_s);
+  return update * state.sensor_from_start_rotation;
 }
 
-void SensorFusionEkf::ProcessGyroscopeSample(const GyroscopeData& sample) {
-  std::unique_lock<std::mutex> lock(mutex_);
+template <typename T>
+double SensorFusionEkfT<T>::GetRotationUncertainty(
+    const RotationState& state, int64_t requested_timestamp) const {
+  double variance = state.rotation_variance;
+  RotationState past_state;
+  if (requested_timestamp != 0 && requested_timestamp < state.timestamp &&
+      rotation_state_history_.GetRotationState(requested_timestamp,
+                                               &past_state)) {
+    variance = past_state.rotation_variance;
+  } else if (requested_timestamp > state.timestamp) {
+    // The prediction is a single step of the filter model over the horizon.
+    const double timestep_s =
+        ComputeTimeDifferenceInSeconds(requested_timestamp, state.timestamp);
+    variance += state.rotation_variance_growth * timestep_s * timestep_s;
+  }
+  return std::min(kRotationUncertaintySigmas * std::sqrt(variance), M_PI);
+}
+
+template <typename T>
+bool SensorFusionEkfT<T>::GetPastRotationState(int64_t timestamp,
+                                               RotationState* state) const {
+  return rotation_state_history_.GetRotationState(timestamp, state);
+}
+
+template <typename T>
+RotationState SensorFusionEkfT<T>::PublishState() {
+  RotationState state;
+  state.timestamp = current_state_.timestamp;
+  state.sensor_from_start_rotation =
+      ConvertRotation<double>(current_state_.sensor_from_start_rotation);
+  state.sensor_from_start_rotation_velocity =
+      Vector3(current_state_.sensor_from_start_rotation_velocity);
+  state.sensor_from_start_rotation_acceleration =
+      Vector3(current_state_.sensor_from_start_rotation_acceleration);
+  state.rotation_variance = current_state_.rotation_variance;
+  state.rotation_variance_growth = current_state_.rotation_variance_growth;
+  published_state_.Write(state);
+  return state;
+}
 
+template <typename T>
+void SensorFusionEkfT<T>::ProcessGyroscopeSample(const GyroscopeData& sample) {
   // Don't accept gyroscope sample when waiting for a reset.
   if (execute_reset_with_next_accelerometer_sample_) {
     return;
@@ -187,6 +611,13 @@ void SensorFusionEkf::ProcessGyroscopeSample(const GyroscopeData& sample) {
     return;
   }
 
+  // With the gyroscope bias in the state, the filter starts from the first bias
+  // reported by the sensor driver.
+  if (state_model_ == kRotationAndGyroscopeBiasStateModel &&
+      sample.has_hardware_bias && can_seed_gyroscope_bias_state_) {
+    SeedGyroscopeBiasState(sample.hardware_bias);
+  }
+
   // Checks that we received at least one gyroscope sample in the past.
   if (current_gyroscope_sensor_timestamp_ns_ != 0) {
     double current_timestep_s =
@@ -194,7 +625,9 @@ void SensorFusionEkf::ProcessGyroscopeSample(const GyroscopeData& sample) {
             std::chrono::nanoseconds(sample.sensor_timestamp_ns -
                                      current_gyroscope_sensor_timestamp_ns_))
             .count();
-    if (current_timestep_s > kMaximumGyroscopeSampleDelay_s) {
+    const bool is_sampling_gap =
+        current_timestep_s > kMaximumGyroscopeSampleDelay_s;
+    if (is_sampling_gap) {
       if (is_gyroscope_filter_valid_) {
         // Replaces the delta timestamp by the filtered estimates of the delta
         // time.
@@ -207,33 +640,86 @@ void SensorFusionEkf::ProcessGyroscopeSample(const GyroscopeData& sample) {
     }
 
     // { Process gyroscope bias estimation
+    if (sample.has_hardware_bias) {
+      gyroscope_bias_estimator_.ProcessHardwareBias(sample.hardware_bias,
+                                                    sample.sensor_timestamp_ns);
+    }
     gyroscope_bias_estimator_.ProcessGyroscope(sample.data,
                                                sample.sensor_timestamp_ns);
+    is_device_static_ = gyroscope_bias_estimator_.IsStatic();
 
-    if (gyroscope_bias_estimator_.IsCurrentEstimateValid()) {
+    if (state_model_ == kRotationAndGyroscopeBiasStateModel) {
+      // The filter estimates the bias itself.
+    } else if (gyroscope_bias_estimator_.IsCurrentEstimateValid()) {
       // As soon as the device is considered to be static, the bias estimator
       // should have a precise estimate of the gyroscope bias.
-      gyroscope_bias_estimate_ = gyroscope_bias_estimator_.GetGyroscopeBias();
+      gyroscope_bias_estimate_ =
+          VectorType(gyroscope_bias_estimator_.GetGyroscopeBias());
+      has_learned_gyroscope_bias_ = true;
+    } else if (gyroscope_bias_estimator_.IsHardwareBiasEstimate()) {
+      // Until then, the bias reported by the sensor driver or restored from a
+      // previous session avoids drifting.
+      gyroscope_bias_estimate_ =
+          VectorType(gyroscope_bias_estimator_.GetGyroscopeBias());
+      has_learned_gyroscope_bias_ = true;
     }
     // }
 
     // Only integrate after receiving a accelerometer sample.
     if (is_aligned_with_gravity_) {
-      const Rotation rotation_from_gyroscope =
-          GetRotationFromGyroscope(
-              {sample.data[0] - gyroscope_bias_estimate_[0],
-               sample.data[1] - gyroscope_bias_estimate_[1],
-               sample.data[2] - gyroscope_bias_estimate_[2]},
-              current_timestep_s);
+      const RotationType rotation_from_gyroscope = IntegrateGyroscope(
+          current_state_.sensor_from_start_rotation_velocity,
+          VectorType(sample.data[0] - gyroscope_bias_estimate_[0],
+                     sample.data[1] - gyroscope_bias_estimate_[1],
+                     sample.data[2] - gyroscope_bias_estimate_[2]),
+          current_timestep_s);
       current_state_.sensor_from_start_rotation =
           rotation_from_gyroscope * current_state_.sensor_from_start_rotation;
-      UpdateStateCovariance(RotationMatrixNH(rotation_from_gyroscope));
-      state_covariance_ =
-          state_covariance_ +
-          ((current_timestep_s * current_timestep_s) * process_covariance_);
+      preintegrated_rotation_ =
+          rotation_from_gyroscope * preintegrated_rotation_;
+      preintegrated_squared_timestep_s2_ +=
+          static_cast<T>(current_timestep_s * current_timestep_s);
+      if (state_model_ == kRotationAndGyroscopeBiasStateModel) {
+        // A bias error e rotates the state by e * dt over the timestep, which
+        // is then carried by the following motion.
+        preintegrated_bias_jacobian_ =
+            RotationMatrixNH(rotation_from_gyroscope) *
+            preintegrated_bias_jacobian_;
+        for (int i = 0; i < 3; ++i) {
+          preintegrated_bias_jacobian_(i, i) +=
+              static_cast<T>(current_timestep_s);
+        }
+        preintegrated_time_s_ += static_cast<T>(current_timestep_s);
+      }
     }
+
+    // { Angular acceleration for prediction
+    VectorType& acceleration =
+        current_state_.sensor_from_start_rotation_acceleration;
+    if (is_sampling_gap || (sample.data[0] == 0 && sample.data[1] == 0 &&
+                            sample.data[2] == 0)) {
+      // An exactly zero velocity stops the prediction, e.g. while the sensors
+      // are paused.
+      acceleration = VectorType::Zero();
+    } else {
+      // Low-pass filtered finite difference of the velocity.
+      const VectorType velocity(sample.data[0] - gyroscope_bias_estimate_[0],
+                                sample.data[1] - gyroscope_bias_estimate_[1],
+                                sample.data[2] - gyroscope_bias_estimate_[2]);
+      const T weight = static_cast<T>(
+          current_timestep_s /
+          (current_timestep_s + kAngularAccelerationFilterTimeConstant_s));
+      acceleration +=
+          weight *
+          ((velocity - current_state_.sensor_from_start_rotation_velocity) /
+               static_cast<T>(current_timestep_s) -
+           acceleration);
+    }
+    // }
   }
 
+  ApplyPendingStartSpaceRotationToState();
+
   // Saves gyroscope event for future prediction.
   current_state_.timestamp = sample.system_timestamp;
   current_gyroscope_sensor_timestamp_ns_ = sample.sensor_timestamp_ns;
@@ -241,46 +727,149 @@ void SensorFusionEkf::ProcessGyroscopeSample(const GyroscopeData& sample) {
       sample.data[0] - gyroscope_bias_estimate_[0],
       sample.data[1] - gyroscope_bias_estimate_[1],
       sample.data[2] - gyroscope_bias_estimate_[2]);
+  const RotationState state = PublishState();
+  if (is_aligned_with_gravity_) {
+    rotation_state_history_.Add(state);
+  }
 }
 
-Vector3 SensorFusionEkf::ComputeInnovation(const Rotation& rotation_in) {
-  const Vector3 predicted_down_direction = rotation_in * kCanonicalZDirection;
+template <typename T>
+typename SensorFusionEkfT<T>::RotationType
+SensorFusionEkfT<T>::IntegrateGyroscope(const VectorType& previous_velocity,
+                                        const VectorType& velocity,
+                                        double timestep_s) const {
+  const T dt = static_cast<T>(timestep_s);
+  const VectorType mean_velocity =
+      static_cast<T>(0.5) * (previous_velocity + velocity);
+  // The rotation vectors are negated, as the state is a rotation from Start
+  // to Sensor Space. See GetRotationFromGyroscope().
+  switch (gyroscope_integration_scheme_) {
+    case kGyroscopeIntegrationMidpoint:
+      return RotationFromVector(-dt * mean_velocity);
+    case kGyroscopeIntegrationRungeKutta4: {
+      const Vector<4, T> q0(0, 0, 0, 1);
+      const Vector<4, T> k1 = QuaternionDerivative(q0, previous_velocity);
+      const Vector<4, T> k2 = QuaternionDerivative(
+          q0 + static_cast<T>(0.5) * dt * k1, mean_velocity);
+      const Vector<4, T> k3 = QuaternionDerivative(
+          q0 + static_cast<T>(0.5) * dt * k2, mean_velocity);
+      const Vector<4, T> k4 = QuaternionDerivative(q0 + dt * k3, velocity);
+      const Vector<4, T> q =
+          q0 + (dt / 6) * (k1 + static_cast<T>(2) * (k2 + k3) + k4);
+      return -RotationType::FromQuaternion(q);
+    }
+    case kGyroscopeIntegrationConing:
+      // With a linear angular velocity over the timestep, the coning term
+      // is dt^2 / 12 * (w_previous x w).
+      return RotationFromVector(
+          -dt * mean_velocity -
+          (dt * dt / 12) * Cross(previous_velocity, velocity));
+    case kGyroscopeIntegrationExponentialMap:
+    default:
+      return GetRotationFromGyroscope(velocity, timestep_s);
+  }
+}
 
-  const Rotation rotation = Rotation::RotateInto(predicted_down_direction,
-                                                 accelerometer_measurement_);
-  Vector3 axis;
-  double angle;
+template <typename T>
+typename SensorFusionEkfT<T>::VectorType
+SensorFusionEkfT<T>::ComputeInnovation(const RotationType& rotation_in) {
+  const VectorType predicted_down_direction =
+      rotation_in * kCanonicalZDirection<T>;
+
+  const RotationType rotation = RotationType::RotateInto(
+      predicted_down_direction, accelerometer_measurement_);
+  VectorType axis;
+  T angle;
   rotation.GetAxisAndAngle(&axis, &angle);
   return axis * angle;
 }
 
-void SensorFusionEkf::ComputeMeasurementJacobian() {
+template <typename T>
+void SensorFusionEkfT<T>::ComputeMeasurementJacobian() {
+  // The innovation is nu = theta * u, the axis-angle rotation bringing the
+  // predicted down direction p onto the measured one m (unit vectors), with
+  // w = p x m, s = |w| = sin(theta), c = p.m = cos(theta), u = w / s.
+  // Perturbing the rotation by a small left rotation delta moves p by
+  // dp = delta x p, and the Jacobian is H = -dnu/ddelta.
+  const VectorType predicted_down_direction =
+      current_state_.sensor_from_start_rotation * kCanonicalZDirection<T>;
+  VectorType measured_down_direction = accelerometer_measurement_;
+  if (!Normalize(&measured_down_direction)) {
+    // A null measurement carries no information.
+    accelerometer_measurement_jacobian_ = MatrixType::Zero();
+    return;
+  }
+
+  const VectorType w = Cross(predicted_down_direction, measured_down_direction);
+  const T s = Length(w);
+  const T c = Dot(predicted_down_direction, measured_down_direction);
+  const T min_innovation_sine = AtLeastSqrtEpsilon<T>(kMinInnovationSine);
+  if (c < 0 && s < min_innovation_sine) {
+    // The innovation axis is arbitrary when both directions are opposite.
+    ComputeMeasurementJacobianNumerically();
+    return;
+  }
+
+  // dnu/dp = (theta / s) * dw/dp + w * d(theta / s)/dp, with dw/dp = -[m]x.
+  const MatrixType minus_cross_measured =
+      -CrossProductMatrix(measured_down_direction);
+  MatrixType innovation_from_predicted_down;
+  if (s < min_innovation_sine) {
+    // theta / s = 1 + O(s^2), and the second term vanishes.
+    innovation_from_predicted_down = minus_cross_measured;
+  } else {
+    const T theta = std::atan2(s, c);
+    // dtheta/dp = -m' / s, and ds/dp = w' * dw/dp / s.
+    const VectorType ds_dp = Transpose(minus_cross_measured) * (w / s);
+    MatrixType ratio_derivative;
+    for (int row = 0; row < 3; ++row) {
+      for (int col = 0; col < 3; ++col) {
+        ratio_derivative(row, col) =
+            w[row] * (-measured_down_direction[col] / (s * s) -
+                      theta * ds_dp[col] / (s * s));
+      }
+    }
+    innovation_from_predicted_down =
+        (theta / s) * minus_cross_measured + ratio_derivative;
+  }
+
+  // dp/ddelta = -[p]x.
+  accelerometer_measurement_jacobian_ =
+      innovation_from_predicted_down *
+      CrossProductMatrix(predicted_down_direction);
+}
+
+template <typename T>
+void SensorFusionEkfT<T>::ComputeMeasurementJacobianNumerically() {
+  const T finite_differencing_epsilon =
+      AtLeastSqrtEpsilon<T>(kFiniteDifferencingEpsilon);
   for (int dof = 0; dof < 3; dof++) {
-    Vector3 delta = Vector3::Zero();
-    delta[dof] = kFiniteDifferencingEpsilon;
+    VectorType delta = VectorType::Zero();
+    delta[dof] = finite_differencing_epsilon;
 
-    const Rotation epsilon_rotation = RotationFromVector(delta);
-    const Vector3 delta_rotation = ComputeInnovation(
+    const RotationType epsilon_rotation = RotationFromVector(delta);
+    const VectorType delta_rotation = ComputeInnovation(
         epsilon_rotation * current_state_.sensor_from_start_rotation);
 
-    const Vector3 col =
-        (innovation_ - delta_rotation) / kFiniteDifferencingEpsilon;
+    const VectorType col =
+        (innovation_ - delta_rotation) / finite_differencing_epsilon;
     accelerometer_measurement_jacobian_(0, dof) = col[0];
     accelerometer_measurement_jacobian_(1, dof) = col[1];
     accelerometer_measurement_jacobian_(2, dof) = col[2];
   }
 }
 
-void SensorFusionEkf::ProcessAccelerometerSample(
+template <typename T>
+void SensorFusionEkfT<T>::ProcessAccelerometerSample(
     const AccelerometerData& sample) {
-  std::unique_lock<std::mutex> lock(mutex_);
-
   // Discard outdated samples.
   if (current_accelerometer_sensor_timestamp_ns_ >=
       sample.sensor_timestamp_ns) {
     return;
   }
 
+  ApplyPendingStartSpaceRotationToState();
+
   // Call reset state if required.
   if (execute_reset_with_next_accelerometer_sample_.exchange(false)) {
     ResetState();
@@ -293,56 +882,301 @@ void SensorFusionEkf::ProcessAccelerometerSample(
   // Process gyroscope bias estimation.
   gyroscope_bias_estimator_.ProcessAccelerometer(sample.data,
                                                  sample.sensor_timestamp_ns);
+  is_device_static_ = gyroscope_bias_estimator_.IsStatic();
 
   if (!is_aligned_with_gravity_) {
-    // This is the first accelerometer measurement so it initializes the
-    // orientation estimate.
-    current_state_.sensor_from_start_rotation =
-        Rotation::RotateInto(kCanonicalZDirection, accelerometer_measurement_);
+    // The first accelerometer measurements initialize the orientation
+    // estimate.
+    if (!AlignWithGravity(sample)) {
+      return;
+    }
     is_aligned_with_gravity_ = true;
+    last_correction_sensor_timestamp_ns_ = sample.sensor_timestamp_ns;
+    last_snapshot_sensor_timestamp_ns_ = sample.sensor_timestamp_ns;
 
     previous_accelerometer_norm_ = Length(accelerometer_measurement_);
+    UpdateRotationVariance();
+    PublishState();
     return;
   }
 
+  // The noise model follows every sample, including the skipped ones.
   UpdateMeasurementCovariance();
 
-  innovation_ = ComputeInnovation(current_state_.sensor_from_start_rotation);
-  ComputeMeasurementJacobian();
-
-  // S = H * P * H' + R
-  innovation_covariance_ = accelerometer_measurement_jacobian_ *
-                               state_covariance_ *
-                               Transpose(accelerometer_measurement_jacobian_) +
-                           accelerometer_measurement_covariance_;
+  if (correction_schedule_.average_skipped_samples) {
+    // The pre-integrated rotation brings the sensor frame of the last
+    // correction to the current one.
+    accumulated_accelerometer_measurement_ +=
+        -preintegrated_rotation_ * accelerometer_measurement_;
+    ++num_accumulated_accelerometer_samples_;
+  }
+  if (!IsAccelerometerCorrectionDue()) {
+    return;
+  }
+  if (num_accumulated_accelerometer_samples_ > 0) {
+    const T num_samples =
+        static_cast<T>(num_accumulated_accelerometer_samples_);
+    accelerometer_measurement_ =
+        preintegrated_rotation_ *
+        (accumulated_accelerometer_measurement_ / num_samples);
+    accumulated_accelerometer_measurement_ = VectorType::Zero();
+    num_accumulated_accelerometer_samples_ = 0;
+  }
+  last_correction_sensor_timestamp_ns_ = sample.sensor_timestamp_ns;
 
-  // K = P * H' * S^-1
-  kalman_gain_ = state_covariance_ *
-                 Transpose(accelerometer_measurement_jacobian_) *
-                 Inverse(innovation_covariance_);
+  FoldGyroscopePreintegration();
 
-  // x_update = K*nu
-  state_update_ = kalman_gain_ * innovation_;
+  innovation_ = ComputeInnovation(current_state_.sensor_from_start_rotation);
+  ComputeMeasurementJacobian();
+  UpdateStateWithMeasurement();
+  if (state_model_ == kRotationAndGyroscopeBiasStateModel &&
+      gyroscope_bias_estimator_.IsCurrentEstimateValid() &&
+      (last_static_bias_fusion_sensor_timestamp_ns_ == 0 ||
+       sample.sensor_timestamp_ns -
+               last_static_bias_fusion_sensor_timestamp_ns_ >=
+           kStaticGyroscopeBiasFusionPeriodNs)) {
+    last_static_bias_fusion_sensor_timestamp_ns_ = sample.sensor_timestamp_ns;
+    UpdateStateWithStaticGyroscopeBias();
+  }
+  ApplyStateUpdate();
+  UpdateRotationVariance();
+  PublishState();
 
-  // P = (I - K * H) * P;
-  state_covariance_ = (Matrix3x3::Identity() -
-                       kalman_gain_ * accelerometer_measurement_jacobian_) *
-                      state_covariance_;
+  if (current_accelerometer_sensor_timestamp_ns_ -
+          last_snapshot_sensor_timestamp_ns_ >=
+      kSnapshotPeriodNs) {
+    last_snapshot_sensor_timestamp_ns_ =
+        current_accelerometer_sensor_timestamp_ns_;
+    CaptureSnapshot();
+  }
+}
 
+template <typename T>
+void SensorFusionEkfT<T>::ApplyStateUpdate() {
   // Updates rotation and associate covariance matrix.
-  const Rotation rotation_from_state_update = RotationFromVector(state_update_);
+  const RotationType rotation_from_state_update =
+      RotationFromVector(state_update_);
 
   current_state_.sensor_from_start_rotation =
       rotation_from_state_update * current_state_.sensor_from_start_rotation;
-  UpdateStateCovariance(RotationMatrixNH(rotation_from_state_update));
+  const MatrixType motion_update = RotationMatrixNH(rotation_from_state_update);
+  UpdateStateCovariance(motion_update);
+  if (state_model_ == kRotationAndGyroscopeBiasStateModel) {
+    rotation_bias_covariance_ = motion_update * rotation_bias_covariance_;
+    gyroscope_bias_estimate_ += gyroscope_bias_update_;
+    // The bias state now holds learned information.
+    can_seed_gyroscope_bias_state_ = false;
+  }
+}
+
+template <typename T>
+void SensorFusionEkfT<T>::SeedGyroscopeBiasState(const Vector3& hardware_bias) {
+  if (!std::isfinite(hardware_bias[0]) || !std::isfinite(hardware_bias[1]) ||
+      !std::isfinite(hardware_bias[2])) {
+    return;
+  }
+  gyroscope_bias_estimate_ = VectorType(hardware_bias);
+  // The driver estimate is independent of the rotation error.
+  rotation_bias_covariance_ = MatrixType::Zero();
+  gyroscope_bias_covariance_ =
+      SymmetricMatrixType::Identity() *
+      static_cast<T>(kHardwareGyroscopeBiasSigma * kHardwareGyroscopeBiasSigma);
+  can_seed_gyroscope_bias_state_ = false;
+}
+
+template <typename T>
+void SensorFusionEkfT<T>::SetAccelerometerCorrectionSchedule(
+    const AccelerometerCorrectionSchedule& schedule) {
+  if (correction_schedule_ == schedule) {
+    return;
+  }
+  correction_schedule_ = schedule;
+  // Samples accumulated under the previous schedule are dropped.
+  accumulated_accelerometer_measurement_ = VectorType::Zero();
+  num_accumulated_accelerometer_samples_ = 0;
+}
+
+template <typename T>
+bool SensorFusionEkfT<T>::IsAccelerometerCorrectionDue() const {
+  double correction_period_ns =
+      static_cast<double>(correction_schedule_.min_correction_period_ns);
+  if (correction_schedule_.max_correction_period_ns >
+      correction_schedule_.min_correction_period_ns) {
+    // Same ratio as the accelerometer noise sigma.
+    const double norm_change_ratio = std::min(
+        1.0, moving_average_accelerometer_norm_change_ / kMaxAccelNormChange);
+    correction_period_ns +=
+        norm_change_ratio *
+        static_cast<double>(correction_schedule_.max_correction_period_ns -
+                            correction_schedule_.min_correction_period_ns);
+  }
+  return static_cast<double>(current_accelerometer_sensor_timestamp_ns_ -
+                             last_correction_sensor_timestamp_ns_) >=
+         correction_period_ns;
+}
+
+template <typename T>
+void SensorFusionEkfT<T>::UpdateStateWithMeasurement() {
+  state_update_ = VectorType::Zero();
+  gyroscope_bias_update_ = VectorType::Zero();
+  for (int row = 0; row < 3; ++row) {
+    // h, the row of H of this measurement. The accelerometer does not depend
+    // on the gyroscope bias.
+    const VectorType h(accelerometer_measurement_jacobian_(row, 0),
+                       accelerometer_measurement_jacobian_(row, 1),
+                       accelerometer_measurement_jacobian_(row, 2));
+    ProcessScalarMeasurement(h, VectorType::Zero(), innovation_[row],
+                             accelerometer_measurement_variance_);
+  }
+}
+
+template <typename T>
+void SensorFusionEkfT<T>::UpdateStateWithStaticGyroscopeBias() {
+  const VectorType static_bias(gyroscope_bias_estimator_.GetGyroscopeBias());
+  const T variance = static_cast<T>(kStaticGyroscopeBiasSigma *
+                                    kStaticGyroscopeBiasSigma);
+  for (int row = 0; row < 3; ++row) {
+    VectorType h = VectorType::Zero();
+    h[row] = 1;
+    ProcessScalarMeasurement(VectorType::Zero(), h,
+                             static_bias[row] - gyroscope_bias_estimate_[row],
+                             variance);
+  }
+}
+
+template <typename T>
+void SensorFusionEkfT<T>::ProcessScalarMeasurement(
+    const VectorType& rotation_jacobian, const VectorType& bias_jacobian,
+    T innovation, T variance) {
+  const bool has_bias = state_model_ == kRotationAndGyroscopeBiasStateModel;
+  const VectorType& h = rotation_jacobian;
+  // P * h', split into its rotation and bias parts.
+  VectorType ph = state_covariance_ * h;
+  VectorType ph_bias = VectorType::Zero();
+  // h * x_update
+  T predicted_update = Dot(h, state_update_);
+  if (has_bias) {
+    ph += rotation_bias_covariance_ * bias_jacobian;
+    ph_bias = Transpose(rotation_bias_covariance_) * h +
+              gyroscope_bias_covariance_ * bias_jacobian;
+    predicted_update += Dot(bias_jacobian, gyroscope_bias_update_);
+  }
+  // s = h * P * h' + r
+  T innovation_variance = Dot(h, ph) + variance;
+  if (has_bias) {
+    innovation_variance += Dot(bias_jacobian, ph_bias);
+  }
+  // k = P * h' / s
+  const VectorType gain = ph / innovation_variance;
+
+  // x_update = x_update + k * (nu - h * x_update)
+  state_update_ += gain * (innovation - predicted_update);
+
+  // Joseph form, expanded for a scalar measurement:
+  // P = (I - k * h) * P * (I - k * h)' + k * r * k'
+  //   = P - k * (P * h')' - (P * h') * k' + s * k * k'
+  // Unlike P = (I - k * h) * P, this holds for any gain, so rounding errors
+  // on k only perturb P at second order.
+  for (int i = 0; i < 3; ++i) {
+    for (int j = i; j < 3; ++j) {
+      state_covariance_(i, j) += innovation_variance * gain[i] * gain[j] -
+                                 gain[i] * ph[j] - ph[i] * gain[j];
+    }
+  }
+  if (!has_bias) {
+    return;
+  }
+
+  const VectorType gain_bias = ph_bias / innovation_variance;
+  gyroscope_bias_update_ += gain_bias * (innovation - predicted_update);
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 3; ++j) {
+      rotation_bias_covariance_(i, j) +=
+          innovation_variance * gain[i] * gain_bias[j] -
+          gain[i] * ph_bias[j] - ph[i] * gain_bias[j];
+    }
+    for (int j = i; j < 3; ++j) {
+      gyroscope_bias_covariance_(i, j) +=
+          innovation_variance * gain_bias[i] * gain_bias[j] -
+          gain_bias[i] * ph_bias[j] - ph_bias[i] * gain_bias[j];
+    }
+  }
 }
 
-void SensorFusionEkf::UpdateStateCovariance(const Matrix3x3& motion_update) {
+template <typename T>
+void SensorFusionEkfT<T>::UpdateStateCovariance(
+    const MatrixType& motion_update) {
+  state_covariance_ =
+      SymmetricMatrixType::Congruence(motion_update, state_covariance_);
+}
+
+template <typename T>
+void SensorFusionEkfT<T>::FoldGyroscopePreintegration() {
+  // The rotation matrix of a product of rotations is the product of their
+  // matrices, and Q is invariant under rotation, so this is the same as
+  // P = M * P * M' + dt^2 * Q for each gyroscope sample.
+  const MatrixType motion_update = RotationMatrixNH(preintegrated_rotation_);
+  if (state_model_ == kRotationAndGyroscopeBiasStateModel) {
+    // P = F * P * F' with F = [M J; 0 I], J the bias Jacobian. The random
+    // walk of the bias during the pre-integration is only added to its own
+    // block.
+    const MatrixType& bias_jacobian = preintegrated_bias_jacobian_;
+    const MatrixType rotated_cross_covariance =
+        motion_update * rotation_bias_covariance_;
+    const MatrixType propagated_bias_covariance =
+        bias_jacobian * gyroscope_bias_covariance_.ToMatrix();
+    state_covariance_ =
+        SymmetricMatrixType::Congruence(motion_update, state_covariance_) +
+        SymmetricMatrixType::FromMatrix(
+            (static_cast<T>(2) * rotated_cross_covariance +
+             propagated_bias_covariance) *
+            Transpose(bias_jacobian));
+    rotation_bias_covariance_ =
+        rotated_cross_covariance + propagated_bias_covariance;
+    gyroscope_bias_covariance_ =
+        gyroscope_bias_covariance_ +
+        SymmetricMatrixType::Identity() *
+            (preintegrated_time_s_ *
+             static_cast<T>(kGyroscopeBiasRandomWalkVariance));
+    preintegrated_bias_jacobian_ = MatrixType::Zero();
+    preintegrated_time_s_ = 0;
+  } else {
+    UpdateStateCovariance(motion_update);
+  }
   state_covariance_ =
-      motion_update * state_covariance_ * Transpose(motion_update);
+      state_covariance_ +
+      SymmetricMatrixType::Identity() *
+          (preintegrated_squared_timestep_s2_ * process_noise_variance_);
+  preintegrated_rotation_ = RotationType::Identity();
+  preintegrated_squared_timestep_s2_ = 0;
 }
 
-void SensorFusionEkf::FilterGyroscopeTimestep(double gyroscope_timestep_s) {
+template <typename T>
+void SensorFusionEkfT<T>::UpdateRotationVariance() {
+  // This is only called when the covariance changes, i.e. with the
+  // accelerometer corrections: the gyroscope samples in between only add a few
+  // samples worth of process noise, and barely tilt the gravity direction.
+  if (is_aligned_with_gravity_) {
+    // The rotation errors are in Sensor Space, where gravity is along the Z
+    // direction of Start Space.
+    current_state_.rotation_variance = LargestEigenvalueInPlane(
+        state_covariance_,
+        current_state_.sensor_from_start_rotation * kCanonicalZDirection<T>);
+  } else {
+    // The rotation is arbitrary until it is aligned with gravity.
+    current_state_.rotation_variance = std::numeric_limits<T>::infinity();
+  }
+  // The process noise is added with the squared timestep, and an error of the
+  // gyroscope bias grows linearly with the horizon.
+  current_state_.rotation_variance_growth = process_noise_variance_;
+  if (state_model_ == kRotationAndGyroscopeBiasStateModel) {
+    current_state_.rotation_variance_growth +=
+        LargestEigenvalueBound(gyroscope_bias_covariance_);
+  }
+}
+
+template <typename T>
+void SensorFusionEkfT<T>::FilterGyroscopeTimestep(double gyroscope_timestep_s) {
   if (!is_timestep_filter_initialized_) {
     // Initializes the filter.
     filtered_gyroscope_timestep_s_ = gyroscope_timestep_s;
@@ -362,7 +1196,8 @@ void SensorFusionEkf::FilterGyroscopeTimestep(double gyroscope_timestep_s) {
   }
 }
 
-void SensorFusionEkf::UpdateMeasurementCovariance() {
+template <typename T>
+void SensorFusionEkfT<T>::UpdateMeasurementCovariance() {
   const double current_accelerometer_norm = Length(accelerometer_measurement_);
   // Norm change between current and previous accel readings.
   const double current_accelerometer_norm_change =
@@ -384,9 +1219,11 @@ void SensorFusionEkf::UpdateMeasurementCovariance() {
           norm_change_ratio * (kMaxAccelNoiseSigma - kMinAccelNoiseSigma));
 
   // Updates the accel covariance matrix with the new sigma value.
-  accelerometer_measurement_covariance_ = Matrix3x3::Identity() *
-                                          accelerometer_noise_sigma *
-                                          accelerometer_noise_sigma;
+  accelerometer_measurement_variance_ =
+      accelerometer_noise_sigma * accelerometer_noise_sigma;
 }
 
+template class SensorFusionEkfT<float>;
+template class SensorFusionEkfT<double>;
+
 }  // namespace cardboard
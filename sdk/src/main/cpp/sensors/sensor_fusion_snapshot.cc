@@ -0,0 +1,189 @@
+/*
+ * Copyright 2019 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "sensor_fusion_snapshot.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace cardboard {
+
+namespace {
+
+// "CBFS" read as a little-endian integer.
+constexpr uint32_t kSnapshotMagic = 0x53464243;
+// Current version of the format. Snapshots of other versions are rejected.
+constexpr uint32_t kSnapshotVersion = 1;
+// Bits of the flags field.
+constexpr uint32_t kHasGyroscopeBiasFlag = 1 << 0;
+constexpr uint32_t kHasGyroscopeTimestepFlag = 1 << 1;
+// Offset of the checksum, which covers the bytes before it.
+constexpr size_t kChecksumOffset = kSerializedSensorFusionSnapshotSize - 4;
+// Maximum filtered gyroscope timestep accepted, in seconds. This corresponds
+// to 1 Hz.
+constexpr double kMaxGyroscopeTimestepS = 1.0;
+
+// Layout, all fields being 4 bytes little-endian:
+// magic, version, flags, gyroscope timestep, gyroscope bias (3), gyroscope
+// bias covariance (6), checksum.
+// The covariance is stored as the upper triangle in row-major order.
+
+// Serializes data sequentially into a buffer.
+class Writer {
+ public:
+  explicit Writer(uint8_t* buffer) : buffer_(buffer), offset_(0) {}
+
+  void WriteUint32(uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+      buffer_[offset_++] = static_cast<uint8_t>(value >> (8 * i));
+    }
+  }
+
+  void WriteFloat(double value) {
+    const float single_value = static_cast<float>(value);
+    uint32_t bits;
+    std::memcpy(&bits, &single_value, sizeof(bits));
+    WriteUint32(bits);
+  }
+
+  void WriteSymmetricMatrix(const SymmetricMatrix3x3& m) {
+    for (int row = 0; row < 3; ++row) {
+      for (int col = row; col < 3; ++col) {
+        WriteFloat(m(row, col));
+      }
+    }
+  }
+
+ private:
+  uint8_t* buffer_;
+  size_t offset_;
+};
+
+// Deserializes data sequentially from a buffer.
+class Reader {
+ public:
+  explicit Reader(const uint8_t* buffer) : buffer_(buffer), offset_(0) {}
+
+  uint32_t ReadUint32() {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i) {
+      value |= static_cast<uint32_t>(buffer_[offset_++]) << (8 * i);
+    }
+    return value;
+  }
+
+  double ReadFloat() {
+    const uint32_t bits = ReadUint32();
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+
+  SymmetricMatrix3x3 ReadSymmetricMatrix() {
+    SymmetricMatrix3x3 m;
+    for (int row = 0; row < 3; ++row) {
+      for (int col = row; col < 3; ++col) {
+        m(row, col) = ReadFloat();
+      }
+    }
+    return m;
+  }
+
+ private:
+  const uint8_t* buffer_;
+  size_t offset_;
+};
+
+// Returns the FNV-1a hash of @p size bytes of @p data.
+uint32_t ComputeChecksum(const uint8_t* data, size_t size) {
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < size; ++i) {
+    hash = (hash ^ data[i]) * 16777619u;
+  }
+  return hash;
+}
+
+// Returns true if @p m is finite and has a positive diagonal.
+bool IsValidCovariance(const SymmetricMatrix3x3& m) {
+  for (int row = 0; row < 3; ++row) {
+    if (!(m(row, row) > 0)) {
+      return false;
+    }
+    for (int col = row; col < 3; ++col) {
+      if (!std::isfinite(m(row, col))) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+void SerializeSensorFusionSnapshot(const SensorFusionSnapshot& snapshot,
+                                   uint8_t* buffer) {
+  Writer writer(buffer);
+  writer.WriteUint32(kSnapshotMagic);
+  writer.WriteUint32(kSnapshotVersion);
+  writer.WriteUint32(
+      (snapshot.has_gyroscope_bias ? kHasGyroscopeBiasFlag : 0) |
+      (snapshot.has_gyroscope_timestep ? kHasGyroscopeTimestepFlag : 0));
+  writer.WriteFloat(snapshot.gyroscope_timestep_s);
+  for (int i = 0; i < 3; ++i) {
+    writer.WriteFloat(snapshot.gyroscope_bias[i]);
+  }
+  writer.WriteSymmetricMatrix(snapshot.gyroscope_bias_covariance);
+  writer.WriteUint32(ComputeChecksum(buffer, kChecksumOffset));
+}
+
+bool DeserializeSensorFusionSnapshot(const uint8_t* buffer, size_t size,
+                                     SensorFusionSnapshot* snapshot) {
+  if (size < kSerializedSensorFusionSnapshotSize) {
+    return false;
+  }
+  Reader reader(buffer);
+  if (reader.ReadUint32() != kSnapshotMagic ||
+      reader.ReadUint32() != kSnapshotVersion) {
+    return false;
+  }
+  SensorFusionSnapshot result;
+  const uint32_t flags = reader.ReadUint32();
+  result.has_gyroscope_bias = (flags & kHasGyroscopeBiasFlag) != 0;
+  result.has_gyroscope_timestep = (flags & kHasGyroscopeTimestepFlag) != 0;
+  result.gyroscope_timestep_s = reader.ReadFloat();
+  for (int i = 0; i < 3; ++i) {
+    result.gyroscope_bias[i] = reader.ReadFloat();
+  }
+  result.gyroscope_bias_covariance = reader.ReadSymmetricMatrix();
+  if (reader.ReadUint32() != ComputeChecksum(buffer, kChecksumOffset)) {
+    return false;
+  }
+
+  if (!std::isfinite(result.gyroscope_bias[0]) ||
+      !std::isfinite(result.gyroscope_bias[1]) ||
+      !std::isfinite(result.gyroscope_bias[2]) ||
+      !IsValidCovariance(result.gyroscope_bias_covariance)) {
+    return false;
+  }
+  if (result.has_gyroscope_timestep &&
+      !(result.gyroscope_timestep_s > 0 &&
+        result.gyroscope_timestep_s <= kMaxGyroscopeTimestepS)) {
+    return false;
+  }
+  *snapshot = result;
+  return true;
+}
+
+}  // namespace cardboard
@@ -0,0 +1,67 @@
+/*
+ * Copyright 2019 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef CARDBOARD_SDK_SENSORS_SENSOR_FUSION_SNAPSHOT_H_
+#define CARDBOARD_SDK_SENSORS_SENSOR_FUSION_SNAPSHOT_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "../util/symmetric_matrix_3x3.h"
+#include "../util/vector.h"
+
+namespace cardboard {
+
+// State learned by sensor fusion that carries over to a later session on the
+// same device. It does not contain the orientation nor its covariance: they are
+// expressed in the Sensor Space of the session, and the orientation is aligned
+// again with gravity.
+struct SensorFusionSnapshot {
+  // Gyroscope bias in rad/s.
+  Vector3 gyroscope_bias;
+  // Whether gyroscope_bias was learned. Otherwise it is the initial zero bias.
+  bool has_gyroscope_bias;
+  // Covariance of the gyroscope bias in (rad/s)^2.
+  SymmetricMatrix3x3 gyroscope_bias_covariance;
+  // Filtered timestep between gyroscope samples in seconds.
+  double gyroscope_timestep_s;
+  // Whether gyroscope_timestep_s was estimated from enough samples.
+  bool has_gyroscope_timestep;
+};
+
+// Size in bytes of a serialized SensorFusionSnapshot.
+constexpr size_t kSerializedSensorFusionSnapshotSize = 56;
+
+// Serializes a snapshot into a compact, versioned, byte order independent
+// format. Values are stored in single precision.
+//
+// @param snapshot snapshot to serialize.
+// @param buffer buffer of at least kSerializedSensorFusionSnapshotSize bytes.
+void SerializeSensorFusionSnapshot(const SensorFusionSnapshot& snapshot,
+                                   uint8_t* buffer);
+
+// Deserializes a snapshot written by SerializeSensorFusionSnapshot().
+//
+// @param buffer serialized snapshot.
+// @param size size of @p buffer in bytes.
+// @param snapshot receives the snapshot.
+// @return false if @p buffer is not a valid snapshot of a supported version,
+//     in which case @p snapshot is not modified.
+bool DeserializeSensorFusionSnapshot(const uint8_t* buffer, size_t size,
+                                     SensorFusionSnapshot* snapshot);
+
+}  // namespace cardboard
+
+#endif  // CARDBOARD_SDK_SENSORS_SENSOR_FUSION_SNAPSHOT_H_
@@ -0,0 +1,119 @@
+/*
+ * Copyright 2019 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef CARDBOARD_SDK_SENSORS_SENSOR_HUB_H_
+#define CARDBOARD_SDK_SENSORS_SENSOR_HUB_H_
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+
+#include "accelerometer_data.h"
+#include "clock_offset_estimator.h"
+#include "gyroscope_data.h"
+#include "sensor_sampling_config.h"
+#include "../util/latency_histogram.h"
+#include "../util/thread_policy.h"
+
+namespace cardboard {
+
+// Stream publisher that reads the accelerometer and the gyroscope from a
+// single capture thread.
+//
+// Both sensor event queues are attached to the event loop of that thread, so
+// one wakeup drains both sensors. Events are delivered in batches, in the order
+// they were read from each sensor queue. The callbacks must return quickly as
+// they run on the capture thread; the consumer is responsible for merging both
+// streams by timestamp. The system_timestamp of the events is converted from
+// the sensor clock with an online clock offset estimate.
+//
+// The capture thread and the sensor event queues are created by the first call
+// to StartSensorPolling() and live as long as this object. While polling is
+// stopped the thread is parked on its event loop with the sensors disabled, so
+// stopping and restarting polling only signals the thread and does not wait for
+// it.
+class SensorHub {
+ public:
+  // Callbacks receiving a contiguous batch of events of one sensor.
+  typedef std::function<void(const AccelerometerData* events,
+                             size_t num_events)>
+      AccelerometerCallback;
+  typedef std::function<void(const GyroscopeData* events, size_t num_events)>
+      GyroscopeCallback;
+
+  SensorHub();
+
+  // Stops polling and terminates the capture thread.
+  ~SensorHub();
+
+  // Registers callbacks and starts polling from the device sensors if it is
+  // not running yet. Sensors that are not supported by the platform are
+  // skipped.
+  void StartSensorPolling(const AccelerometerCallback* on_accel_callback,
+                          const GyroscopeCallback* on_gyro_callback);
+
+  // This stops sensor polling if it is currently running. The capture thread is
+  // parked, not terminated. Once this method returns the callbacks are not
+  // called anymore.
+  void StopSensorPolling();
+
+  // Sets the sampling of both sensors. It is applied by the capture thread, and
+  // kept across stops and restarts of polling. The default is
+  // kFastestSensorSamplingConfig.
+  //
+  // @param config requested sampling period and hardware batching.
+  void SetSamplingConfig(const SensorSamplingConfig& config);
+
+  // Sets the scheduling policy of the capture thread. It is applied by the
+  // capture thread when it starts or wakes up.
+  //
+  // @param policy scheduling policy.
+  void SetThreadPolicy(const ThreadPolicy& policy);
+
+  // Gets the current estimate of the offset between the sensor clock and the
+  // system clock, for diagnostics. This can be called from any thread.
+  ClockOffsetEstimate GetClockOffsetEstimate() const;
+
+  // Gets the histogram of the delays between the sensor events and the moment
+  // they were read by the capture thread. Its spread is the delivery jitter.
+  // This can be called from any thread.
+  LatencyHistogram::Snapshot GetDeliveryLatencyHistogram() const;
+
+ private:
+  // Internal function to wake up the capture thread with the assumption that
+  // the lock has already been obtained.
+  void WakeUpThreadLocked();
+
+  // Worker method that polls for sensor data and executes the callbacks.
+  void WorkFn();
+
+  // The implementation of device sensors differs between iOS and Android.
+  struct EventProducer;
+  std::unique_ptr<EventProducer> event_producer_;
+
+  // Estimates the sensor clock offset. Updated by the capture thread.
+  ClockOffsetEstimator clock_offset_estimator_;
+
+  // Delivery latency of the sensor events. Updated by the capture thread.
+  LatencyHistogram delivery_latency_histogram_;
+
+  // Callbacks to call when events are received.
+  const AccelerometerCallback* on_accel_callback_;
+  const GyroscopeCallback* on_gyro_callback_;
+};
+
+}  // namespace cardboard
+
+#endif  // CARDBOARD_SDK_SENSORS_SENSOR_HUB_H_
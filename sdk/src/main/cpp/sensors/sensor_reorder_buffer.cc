@@ -0,0 +1,116 @@
+/*
+ * Copyright 2019 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "sensor_reorder_buffer.h"
+
+namespace cardboard {
+
+namespace {
+
+// Increments a counter that only the calling thread writes.
+void IncrementCounter(std::atomic<uint64_t>* counter) {
+  counter->store(counter->load(std::memory_order_relaxed) + 1,
+                 std::memory_order_relaxed);
+}
+
+}  // namespace
+
+SensorReorderBuffer::SensorReorderBuffer(int64_t latency_budget_ns)
+    : latency_budget_ns_(latency_budget_ns),
+      newest_accel_timestamp_ns_(0),
+      newest_gyro_timestamp_ns_(0),
+      released_timestamp_ns_(0),
+      num_reordered_samples_(0),
+      num_dropped_samples_(0) {
+  accel_samples_.reserve(kInitialStreamCapacity);
+  gyro_samples_.reserve(kInitialStreamCapacity);
+}
+
+void SensorReorderBuffer::Reset() {
+  accel_samples_.clear();
+  gyro_samples_.clear();
+  newest_accel_timestamp_ns_ = 0;
+  newest_gyro_timestamp_ns_ = 0;
+  released_timestamp_ns_ = 0;
+}
+
+void SensorReorderBuffer::SetLatencyBudget(int64_t latency_budget_ns) {
+  latency_budget_ns_ = latency_budget_ns;
+}
+
+void SensorReorderBuffer::AddAccelerometerSamples(
+    const AccelerometerData* samples, size_t num_samples) {
+  for (size_t i = 0; i < num_samples; ++i) {
+    Insert(samples[i], &accel_samples_, &newest_accel_timestamp_ns_);
+  }
+}
+
+void SensorReorderBuffer::AddGyroscopeSamples(const GyroscopeData* samples,
+                                              size_t num_samples) {
+  for (size_t i = 0; i < num_samples; ++i) {
+    Insert(samples[i], &gyro_samples_, &newest_gyro_timestamp_ns_);
+  }
+}
+
+SensorReorderStatistics SensorReorderBuffer::GetStatistics() const {
+  return {num_reordered_samples_.load(std::memory_order_relaxed),
+          num_dropped_samples_.load(std::memory_order_relaxed)};
+}
+
+template <typename DataType>
+void SensorReorderBuffer::Insert(const DataType& sample,
+                                 std::vector<DataType>* stream,
+                                 uint64_t* newest_timestamp_ns) {
+  const uint64_t timestamp_ns = sample.sensor_timestamp_ns;
+  // Later samples were released already, this one cannot be put in order.
+  if (timestamp_ns < released_timestamp_ns_) {
+    IncrementCounter(&num_dropped_samples_);
+    return;
+  }
+
+  // Samples mostly arrive in order, so the search usually ends at the back.
+  auto position = stream->end();
+  while (position != stream->begin() &&
+         (position - 1)->sensor_timestamp_ns > timestamp_ns) {
+    --position;
+  }
+  if (position != stream->end()) {
+    IncrementCounter(&num_reordered_samples_);
+  }
+  stream->insert(position, sample);
+  *newest_timestamp_ns = std::max(*newest_timestamp_ns, timestamp_ns);
+}
+
+uint64_t SensorReorderBuffer::GetWatermark() const {
+  const uint64_t newest_timestamp_ns =
+      std::max(newest_accel_timestamp_ns_, newest_gyro_timestamp_ns_);
+  const uint64_t latency_budget_ns =
+      static_cast<uint64_t>(std::max<int64_t>(latency_budget_ns_, 0));
+
+  // Samples are not held longer than the latency budget.
+  uint64_t watermark_ns = newest_timestamp_ns > latency_budget_ns
+                              ? newest_timestamp_ns - latency_budget_ns
+                              : 0;
+  // Once both streams have samples, any later sample is newer than the oldest
+  // of their newest timestamps.
+  if (newest_accel_timestamp_ns_ != 0 && newest_gyro_timestamp_ns_ != 0) {
+    watermark_ns = std::max(
+        watermark_ns,
+        std::min(newest_accel_timestamp_ns_, newest_gyro_timestamp_ns_));
+  }
+  return watermark_ns;
+}
+
+}  // namespace cardboard
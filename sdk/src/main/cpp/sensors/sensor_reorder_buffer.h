@@ -0,0 +1,191 @@
+/*
+ * Copyright 2019 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef CARDBOARD_SDK_SENSORS_SENSOR_REORDER_BUFFER_H_
+#define CARDBOARD_SDK_SENSORS_SENSOR_REORDER_BUFFER_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "accelerometer_data.h"
+#include "gyroscope_data.h"
+
+namespace cardboard {
+
+// Counters of a SensorReorderBuffer.
+struct SensorReorderStatistics {
+  // Samples that arrived after a held sample of the same stream with a later
+  // timestamp and were put back in order. Interleaving the two streams does
+  // not count as reordering.
+  uint64_t num_reordered_samples;
+
+  // Samples that arrived after samples with later timestamps had already been
+  // released, i.e. later than the latency budget allows.
+  uint64_t num_dropped_samples;
+};
+
+// Merges the accelerometer and the gyroscope streams by sensor timestamp.
+//
+// Samples are held until no sample with an earlier timestamp can arrive
+// anymore: each stream is assumed to be in order once its samples are sorted,
+// so everything up to the oldest of the newest timestamps of both streams can
+// be released. When one stream stalls, samples are held at most for the
+// latency budget, measured in sensor time from the newest sample. Samples
+// arriving after later ones were released are dropped and counted.
+//
+// This class is not thread safe, except for GetStatistics().
+class SensorReorderBuffer {
+ public:
+  // @param latency_budget_ns maximum time in nanoseconds a sample is held
+  //     waiting for the other stream.
+  explicit SensorReorderBuffer(int64_t latency_budget_ns);
+
+  // Sets the maximum time in nanoseconds a sample is held waiting for the other
+  // stream.
+  void SetLatencyBudget(int64_t latency_budget_ns);
+
+  // Adds samples in arrival order.
+  void AddAccelerometerSamples(const AccelerometerData* samples,
+                               size_t num_samples);
+  void AddGyroscopeSamples(const GyroscopeData* samples, size_t num_samples);
+
+  // Releases, in sensor timestamp order, the samples that cannot be preceded
+  // by a sample arriving later anymore. On equal timestamps accelerometer
+  // samples go first.
+  //
+  // @param on_accel callable with signature
+  //     `void(const AccelerometerData* samples, size_t num_samples)`. Same
+  //     for @p on_gyro.
+  template <typename OnAccelFn, typename OnGyroFn>
+  void ReleaseSamples(const OnAccelFn& on_accel, const OnGyroFn& on_gyro) {
+    Release(GetWatermark(), on_accel, on_gyro);
+  }
+
+  // Releases all held samples in sensor timestamp order, e.g. before pausing.
+  template <typename OnAccelFn, typename OnGyroFn>
+  void ReleaseAllSamples(const OnAccelFn& on_accel, const OnGyroFn& on_gyro) {
+    Release(UINT64_MAX, on_accel, on_gyro);
+  }
+
+  // Forgets the held samples and the timestamps seen so far, e.g. when the
+  // sensors restart: their clock may restart too, and later samples would
+  // otherwise be dropped as late. The counters and the latency budget are kept.
+  void Reset();
+
+  // Gets the counters. This can be called from any thread.
+  SensorReorderStatistics GetStatistics() const;
+
+ private:
+  // Inserts @p sample in @p stream, keeping it sorted.
+  template <typename DataType>
+  void Insert(const DataType& sample, std::vector<DataType>* stream,
+              uint64_t* newest_timestamp_ns);
+
+  // Returns the newest timestamp that can be released.
+  uint64_t GetWatermark() const;
+
+  // Releases the samples with a timestamp lower or equal to @p watermark_ns.
+  template <typename OnAccelFn, typename OnGyroFn>
+  void Release(uint64_t watermark_ns, const OnAccelFn& on_accel,
+               const OnGyroFn& on_gyro);
+
+  // Capacity reserved for each stream.
+  static constexpr size_t kInitialStreamCapacity = 128;
+
+  int64_t latency_budget_ns_;
+
+  // Held samples of each stream, sorted by sensor timestamp.
+  std::vector<AccelerometerData> accel_samples_;
+  std::vector<GyroscopeData> gyro_samples_;
+
+  // Newest sensor timestamp added to each stream, zero if none was added.
+  uint64_t newest_accel_timestamp_ns_;
+  uint64_t newest_gyro_timestamp_ns_;
+  // Newest sensor timestamp released.
+  uint64_t released_timestamp_ns_;
+
+  std::atomic<uint64_t> num_reordered_samples_;
+  std::atomic<uint64_t> num_dropped_samples_;
+};
+
+template <typename OnAccelFn, typename OnGyroFn>
+void SensorReorderBuffer::Release(uint64_t watermark_ns,
+                                  const OnAccelFn& on_accel,
+                                  const OnGyroFn& on_gyro) {
+  const auto is_released = [watermark_ns](uint64_t timestamp_ns) {
+    return timestamp_ns <= watermark_ns;
+  };
+
+  size_t accel_index = 0;
+  size_t gyro_index = 0;
+  const size_t num_accel = accel_samples_.size();
+  const size_t num_gyro = gyro_samples_.size();
+  while (true) {
+    const bool has_accel =
+        accel_index < num_accel &&
+        is_released(accel_samples_[accel_index].sensor_timestamp_ns);
+    const bool has_gyro =
+        gyro_index < num_gyro &&
+        is_released(gyro_samples_[gyro_index].sensor_timestamp_ns);
+    if (!has_accel && !has_gyro) {
+      break;
+    }
+
+    const uint64_t next_accel_timestamp_ns =
+        has_accel ? accel_samples_[accel_index].sensor_timestamp_ns
+                  : UINT64_MAX;
+    const uint64_t next_gyro_timestamp_ns =
+        has_gyro ? gyro_samples_[gyro_index].sensor_timestamp_ns : UINT64_MAX;
+
+    // Passes the run of consecutive samples of the same stream as one batch.
+    if (next_accel_timestamp_ns <= next_gyro_timestamp_ns) {
+      size_t end = accel_index;
+      do {
+        ++end;
+      } while (end < num_accel &&
+               is_released(accel_samples_[end].sensor_timestamp_ns) &&
+               accel_samples_[end].sensor_timestamp_ns <=
+                   next_gyro_timestamp_ns);
+      on_accel(&accel_samples_[accel_index], end - accel_index);
+      released_timestamp_ns_ = std::max(
+          released_timestamp_ns_, accel_samples_[end - 1].sensor_timestamp_ns);
+      accel_index = end;
+    } else {
+      size_t end = gyro_index;
+      do {
+        ++end;
+      } while (end < num_gyro &&
+               is_released(gyro_samples_[end].sensor_timestamp_ns) &&
+               gyro_samples_[end].sensor_timestamp_ns <
+                   next_accel_timestamp_ns);
+      on_gyro(&gyro_samples_[gyro_index], end - gyro_index);
+      released_timestamp_ns_ = std::max(
+          released_timestamp_ns_, gyro_samples_[end - 1].sensor_timestamp_ns);
+      gyro_index = end;
+    }
+  }
+
+  accel_samples_.erase(accel_samples_.begin(),
+                       accel_samples_.begin() + accel_index);
+  gyro_samples_.erase(gyro_samples_.begin(),
+                      gyro_samples_.begin() + gyro_index);
+}
+
+}  // namespace cardboard
+
+#endif  // CARDBOARD_SDK_SENSORS_SENSOR_REORDER_BUFFER_H_
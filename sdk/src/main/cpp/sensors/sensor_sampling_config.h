@@ -0,0 +1,48 @@
+/*
+ * Copyright 2019 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef CARDBOARD_SDK_SENSORS_SENSOR_SAMPLING_CONFIG_H_
+#define CARDBOARD_SDK_SENSORS_SENSOR_SAMPLING_CONFIG_H_
+
+#include <cstdint>
+
+namespace cardboard {
+
+// Requested sampling of a device sensor.
+struct SensorSamplingConfig {
+  // Sampling period in microseconds. Values below the minimum delay of the
+  // sensor select the highest possible sampling rate.
+  int32_t sampling_period_us;
+
+  // Maximum time in microseconds events may be batched in the hardware FIFO
+  // before being reported. Zero reports events as soon as they are available.
+  int64_t max_report_latency_us;
+
+  bool operator==(const SensorSamplingConfig& other) const {
+    return sampling_period_us == other.sampling_period_us &&
+           max_report_latency_us == other.max_report_latency_us;
+  }
+
+  bool operator!=(const SensorSamplingConfig& other) const {
+    return !(*this == other);
+  }
+};
+
+// Samples as fast as possible and reports every event immediately.
+constexpr SensorSamplingConfig kFastestSensorSamplingConfig = {0, 0};
+
+}  // namespace cardboard
+
+#endif  // CARDBOARD_SDK_SENSORS_SENSOR_SAMPLING_CONFIG_H_
@@ -0,0 +1,92 @@
+/*
+ * Copyright 2019 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "sensors/clock_offset_estimator.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+
+#include "gtest/gtest.h"
+
+namespace cardboard {
+namespace {
+
+constexpr int64_t kSamplePeriodNs = 10000000;
+
+TEST(ClockOffsetEstimatorTest, KeepsTimestampsBeforeAnyObservation) {
+  ClockOffsetEstimator estimator;
+  EXPECT_FALSE(estimator.GetEstimate().is_valid);
+  EXPECT_EQ(estimator.ConvertToSystemTime(12345), 12345);
+}
+
+TEST(ClockOffsetEstimatorTest, KeepsTimestampsOfEqualClocks) {
+  ClockOffsetEstimator estimator;
+  for (int64_t t = 1; t < 5000000000; t += kSamplePeriodNs) {
+    // Within the delivery latency of an event read right away.
+    estimator.AddObservation(t, t + 500000);
+  }
+  EXPECT_TRUE(estimator.GetEstimate().is_valid);
+  EXPECT_EQ(estimator.ConvertToSystemTime(12345), 12345);
+}
+
+TEST(ClockOffsetEstimatorTest, TracksOffsetAndDrift) {
+  constexpr int64_t kOffsetNs = 50000000;
+  constexpr double kSkew = 1e-5;
+  const auto system_time = [](int64_t sensor_timestamp_ns) {
+    return sensor_timestamp_ns + kOffsetNs +
+           static_cast<int64_t>(kSkew * sensor_timestamp_ns);
+  };
+  ClockOffsetEstimator estimator;
+  std::mt19937 random_engine(1);
+  std::uniform_int_distribution<int64_t> delivery_latency_ns(0, 20000000);
+
+  for (int64_t t = 0; t < 40000000000; t += kSamplePeriodNs) {
+    estimator.AddObservation(t, system_time(t) + delivery_latency_ns(
+                                                     random_engine));
+    if (t > 5000000000) {
+      ASSERT_LT(std::llabs(estimator.ConvertToSystemTime(t) - system_time(t)),
+                1000000);
+    }
+  }
+  EXPECT_NEAR(estimator.GetEstimate().skew, kSkew, 5e-6);
+}
+
+TEST(ClockOffsetEstimatorTest, IgnoresOpenWindowOnceAWindowCompleted) {
+  constexpr int64_t kOffsetNs = 50000000;
+  constexpr int64_t kWindowDurationNs = 1000000000;
+  ClockOffsetEstimator estimator;
+  for (int64_t t = 0; t < kWindowDurationNs; t += kSamplePeriodNs) {
+    estimator.AddObservation(t, t + kOffsetNs);
+  }
+  // This late event completes the first window and opens the next one.
+  estimator.AddObservation(kWindowDurationNs,
+                           kWindowDurationNs + kOffsetNs + 30000000);
+
+  EXPECT_EQ(estimator.GetEstimate().skew, 0.0);
+  EXPECT_EQ(estimator.ConvertToSystemTime(kWindowDurationNs),
+            kWindowDurationNs + kOffsetNs);
+}
+
+TEST(ClockOffsetEstimatorTest, ForgetsObservationsOnReset) {
+  ClockOffsetEstimator estimator;
+  estimator.AddObservation(1000, 1000 + 50000000);
+  estimator.Reset();
+  EXPECT_FALSE(estimator.GetEstimate().is_valid);
+  EXPECT_EQ(estimator.ConvertToSystemTime(1000), 1000);
+}
+
+}  // namespace
+}  // namespace cardboard
@@ -0,0 +1,112 @@
+/*
+ * Copyright 2019 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "headtracker/display_latency_estimator.h"
+
+#include <cstdint>
+
+#include "gtest/gtest.h"
+
+namespace cardboard {
+namespace {
+
+constexpr int64_t kFramePeriodNs = 16666667;
+constexpr int64_t kDefaultLatencyNs = 50000000;
+
+// Deterministic display jitter of +/- 2 ms around the latency.
+int64_t GetJitterNs(int frame) {
+  return ((frame * 7919) % 5 - 2) * 1000000;
+}
+
+DisplayLatencySample CreateFrame(int frame, int64_t latency_ns) {
+  DisplayLatencySample sample;
+  sample.render_timestamp_ns = frame * kFramePeriodNs;
+  sample.predicted_display_timestamp_ns =
+      sample.render_timestamp_ns + kDefaultLatencyNs;
+  sample.actual_display_timestamp_ns = sample.render_timestamp_ns + latency_ns;
+  return sample;
+}
+
+TEST(DisplayLatencyEstimatorTest, ReturnsDefaultWithoutFrames) {
+  DisplayLatencyEstimator estimator;
+  EXPECT_EQ(estimator.GetLatencyEstimateNs(kDefaultLatencyNs),
+            kDefaultLatencyNs);
+
+  estimator.AddFrame(CreateFrame(0, 34000000));
+  EXPECT_EQ(estimator.GetLatencyEstimateNs(kDefaultLatencyNs), 34000000);
+
+  estimator.Reset();
+  EXPECT_EQ(estimator.GetLatencyEstimateNs(kDefaultLatencyNs),
+            kDefaultLatencyNs);
+}
+
+TEST(DisplayLatencyEstimatorTest, ConvergesWithJitter) {
+  DisplayLatencyEstimator estimator;
+  for (int frame = 0; frame < 200; ++frame) {
+    estimator.AddFrame(CreateFrame(frame, 34000000 + GetJitterNs(frame)));
+  }
+  EXPECT_NEAR(estimator.GetLatencyEstimateNs(kDefaultLatencyNs), 34000000,
+              1000000);
+}
+
+TEST(DisplayLatencyEstimatorTest, FollowsLatencyStep) {
+  DisplayLatencyEstimator estimator;
+  int frame = 0;
+  for (; frame < 200; ++frame) {
+    estimator.AddFrame(CreateFrame(frame, 34000000));
+  }
+
+  // The moving average follows 90% of the step within 22 frames.
+  for (int i = 0; i < 22; ++i, ++frame) {
+    estimator.AddFrame(CreateFrame(frame, 50000000));
+  }
+  EXPECT_GT(estimator.GetLatencyEstimateNs(kDefaultLatencyNs), 48400000);
+  EXPECT_LT(estimator.GetLatencyEstimateNs(kDefaultLatencyNs), 50000000);
+}
+
+TEST(DisplayLatencyEstimatorTest, IgnoresInvalidLatencies) {
+  DisplayLatencyEstimator estimator;
+  estimator.AddFrame(CreateFrame(0, 34000000));
+  estimator.AddFrame(CreateFrame(1, -1));
+  estimator.AddFrame(CreateFrame(2, 500000001));
+  EXPECT_EQ(estimator.GetLatencyEstimateNs(kDefaultLatencyNs), 34000000);
+
+  DisplayLatencySample trace[4];
+  EXPECT_EQ(estimator.GetTrace(trace, 4), 1u);
+}
+
+TEST(DisplayLatencyEstimatorTest, KeepsLatestFramesInTrace) {
+  constexpr int kNumFrames = DisplayLatencyEstimator::kTraceCapacity + 10;
+  DisplayLatencyEstimator estimator;
+  for (int frame = 0; frame < kNumFrames; ++frame) {
+    estimator.AddFrame(CreateFrame(frame, 34000000));
+  }
+
+  DisplayLatencySample trace[DisplayLatencyEstimator::kTraceCapacity + 1];
+  ASSERT_EQ(estimator.GetTrace(trace, DisplayLatencyEstimator::kTraceCapacity +
+                                          1),
+            DisplayLatencyEstimator::kTraceCapacity);
+  EXPECT_EQ(trace[0].render_timestamp_ns, 10 * kFramePeriodNs);
+  EXPECT_EQ(trace[DisplayLatencyEstimator::kTraceCapacity - 1]
+                .render_timestamp_ns,
+            (kNumFrames - 1) * kFramePeriodNs);
+
+  // A smaller buffer receives the latest frames.
+  ASSERT_EQ(estimator.GetTrace(trace, 2), 2u);
+  EXPECT_EQ(trace[1].render_timestamp_ns, (kNumFrames - 1) * kFramePeriodNs);
+}
+
+}  // namespace
+}  // namespace cardboard
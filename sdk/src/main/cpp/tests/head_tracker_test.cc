@@ -0,0 +1,251 @@
+/*
+ * Copyright 2019 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "headtracker/head_tracker.h"
+
+#include <array>
+#include <chrono>  // NOLINT
+#include <cmath>
+#include <cstdint>
+#include <thread>  // NOLINT
+
+#include "gtest/gtest.h"
+#include "tests/synthetic_sensor_hub.h"
+#include "util/rotation.h"
+#include "util/vector.h"
+
+namespace cardboard {
+namespace {
+
+constexpr uint64_t kStartTimestampNs = 1000000000;
+constexpr uint64_t kGyroscopePeriodNs = 5000000;
+constexpr int kNumGyroscopeSamples = 80;
+// Number of accelerometer samples aligning sensor fusion with gravity.
+constexpr int kNumGravityAlignmentSamples = 12;
+constexpr double kYawVelocity = 1.0;
+constexpr double kGravity = 9.81;
+constexpr auto kTimeout = std::chrono::seconds(5);
+
+Rotation GetRotation(HeadTracker* head_tracker, int64_t timestamp_ns,
+                     CardboardViewportOrientation viewport_orientation =
+                         kLandscapeLeft) {
+  std::array<float, 3> position;
+  std::array<float, 4> orientation;
+  head_tracker->GetPose(timestamp_ns, viewport_orientation, position,
+                        orientation);
+  return Rotation::FromQuaternion(Rotation::QuaternionType(
+      orientation[0], orientation[1], orientation[2], orientation[3]));
+}
+
+double GetAngle(const Rotation& rotation) {
+  Vector3 axis;
+  double angle;
+  rotation.GetAxisAndAngle(&axis, &angle);
+  return angle;
+}
+
+// Emits gravity along the device z axis and a constant yaw velocity through
+// the synthetic sensor hub. Sensor fusion is aligned with gravity before the
+// first gyroscope sample.
+//
+// @return the timestamp of the last gyroscope sample.
+uint64_t EmitYawMotion() {
+  for (int i = kNumGravityAlignmentSamples; i > 0; --i) {
+    AccelerometerData accel = {};
+    accel.system_timestamp = kStartTimestampNs - i * kGyroscopePeriodNs;
+    accel.sensor_timestamp_ns = accel.system_timestamp;
+    accel.data = Vector3(0, 0, kGravity);
+    EXPECT_TRUE(testing::EmitAccelerometerSamples(&accel, 1));
+  }
+  uint64_t timestamp_ns = kStartTimestampNs;
+  for (int i = 0; i < kNumGyroscopeSamples; ++i) {
+    if (i % 10 == 0) {
+      AccelerometerData accel = {};
+      accel.system_timestamp = timestamp_ns;
+      accel.sensor_timestamp_ns = timestamp_ns;
+      accel.data = Vector3(0, 0, kGravity);
+      EXPECT_TRUE(testing::EmitAccelerometerSamples(&accel, 1));
+    }
+    timestamp_ns += kGyroscopePeriodNs;
+    GyroscopeData gyro = {};
+    gyro.system_timestamp = timestamp_ns;
+    gyro.sensor_timestamp_ns = timestamp_ns;
+    gyro.data = Vector3(0, 0, kYawVelocity);
+    EXPECT_TRUE(testing::EmitGyroscopeSamples(&gyro, 1));
+  }
+  return timestamp_ns;
+}
+
+TEST(HeadTrackerTest, PauseFreezesPoseAfterQueuedSamples) {
+  HeadTracker head_tracker;
+  // Gravity along the device z axis aligns sensor fusion with the identity.
+  const Rotation initial_rotation =
+      GetRotation(&head_tracker, kStartTimestampNs);
+
+  head_tracker.Resume();
+  const uint64_t last_timestamp_ns = EmitYawMotion();
+  // Samples still queued when pausing are processed before the prediction is
+  // stopped.
+  head_tracker.Pause();
+  EXPECT_FALSE(testing::EmitGyroscopeSamples(nullptr, 0));
+
+  // The first gyroscope sample only starts the integration.
+  const double expected_angle =
+      kYawVelocity * (kNumGyroscopeSamples - 1) * kGyroscopePeriodNs * 1e-9;
+  const auto deadline = std::chrono::steady_clock::now() + kTimeout;
+  bool is_frozen = false;
+  while (!is_frozen && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::yield();
+    const Rotation rotation =
+        GetRotation(&head_tracker, last_timestamp_ns + 100000000);
+    const Rotation later_rotation =
+        GetRotation(&head_tracker, last_timestamp_ns + 1000000000);
+    is_frozen =
+        std::abs(GetAngle(-initial_rotation * rotation) - expected_angle) <
+            1e-3 &&
+        GetAngle(-rotation * later_rotation) < 1e-6;
+  }
+  EXPECT_TRUE(is_frozen);
+}
+
+TEST(HeadTrackerTest, ViewportChangeIsAppliedWhilePaused) {
+  HeadTracker head_tracker;
+  head_tracker.Resume();
+  const uint64_t last_timestamp_ns = EmitYawMotion();
+  head_tracker.Pause();
+  const int64_t timestamp_ns = last_timestamp_ns + 100000000;
+  // Waits for the fusion thread to process all the samples and stop the
+  // prediction, so that no sample follows the viewport change.
+  const auto deadline = std::chrono::steady_clock::now() + kTimeout;
+  while (GetAngle(-GetRotation(&head_tracker, timestamp_ns) *
+                  GetRotation(&head_tracker, timestamp_ns + 1000000000)) >
+             1e-6 &&
+         std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::yield();
+  }
+
+  // The first pose in the new orientation is computed before the viewport
+  // change compensation is requested.
+  GetRotation(&head_tracker, timestamp_ns);
+  const Rotation portrait_rotation =
+      GetRotation(&head_tracker, timestamp_ns, kPortrait);
+  bool is_compensated = false;
+  while (!is_compensated && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::yield();
+    is_compensated =
+        GetAngle(-portrait_rotation *
+                 GetRotation(&head_tracker, timestamp_ns, kPortrait)) > 1e-3;
+  }
+  EXPECT_TRUE(is_compensated);
+}
+
+TEST(HeadTrackerTest, GetPosesMatchesSuccessiveGetPose) {
+  HeadTracker head_tracker;
+  const Rotation initial_rotation =
+      GetRotation(&head_tracker, kStartTimestampNs);
+  head_tracker.Resume();
+  const uint64_t last_timestamp_ns = EmitYawMotion();
+  // Waits for the fusion thread to process all the samples, so that the state
+  // does not change between the queries.
+  const double expected_angle =
+      kYawVelocity * (kNumGyroscopeSamples - 1) * kGyroscopePeriodNs * 1e-9;
+  const auto deadline = std::chrono::steady_clock::now() + kTimeout;
+  while (std::abs(GetAngle(-initial_rotation *
+                           GetRotation(&head_tracker, last_timestamp_ns)) -
+                  expected_angle) > 1e-3 &&
+         std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::yield();
+  }
+
+  constexpr size_t kNumPoses = 3;
+  const std::array<int64_t, kNumPoses> timestamps_ns = {
+      static_cast<int64_t>(last_timestamp_ns) + 10000000,
+      static_cast<int64_t>(last_timestamp_ns) + 20000000,
+      static_cast<int64_t>(last_timestamp_ns) + 30000000};
+  const std::array<CardboardViewportOrientation, kNumPoses>
+      viewport_orientations = {kLandscapeLeft, kLandscapeLeft, kLandscapeLeft};
+  std::array<float, 3 * kNumPoses> positions;
+  std::array<float, 4 * kNumPoses> orientations;
+  head_tracker.GetPoses(timestamps_ns.data(), viewport_orientations.data(),
+                        kNumPoses, positions.data(), orientations.data());
+
+  for (size_t i = 0; i < kNumPoses; ++i) {
+    std::array<float, 3> position;
+    std::array<float, 4> orientation;
+    head_tracker.GetPose(timestamps_ns[i], kLandscapeLeft, position,
+                         orientation);
+    for (size_t j = 0; j < 3; ++j) {
+      EXPECT_FLOAT_EQ(positions[3 * i + j], position[j]);
+    }
+    for (size_t j = 0; j < 4; ++j) {
+      EXPECT_FLOAT_EQ(orientations[4 * i + j], orientation[j]);
+    }
+  }
+  // The poses are predicted to their own timestamps.
+  const Rotation first_rotation =
+      Rotation::FromQuaternion(Rotation::QuaternionType(
+          orientations[0], orientations[1], orientations[2], orientations[3]));
+  const Rotation last_rotation = Rotation::FromQuaternion(
+      Rotation::QuaternionType(orientations[8], orientations[9],
+                               orientations[10], orientations[11]));
+  EXPECT_NEAR(GetAngle(-first_rotation * last_rotation), kYawVelocity * 0.02,
+              1e-3);
+}
+
+TEST(HeadTrackerTest, PeriodicSourceFillsLatencyHistograms) {
+  constexpr int kNumSamples = 100;
+  constexpr auto kSamplePeriod = std::chrono::microseconds(2500);
+  HeadTracker head_tracker;
+  // Lowering the priority and pinning to the first CPU is always permitted.
+  const ThreadPolicy policy = {true, 1, false, 0, 1};
+  head_tracker.SetThreadPolicies(policy, policy);
+  head_tracker.Resume();
+
+  // Synthetic 400 Hz source, stamping the samples when they are emitted.
+  std::thread source([&kSamplePeriod]() {
+    auto next_sample_time = std::chrono::steady_clock::now();
+    for (int i = 0; i < kNumSamples; ++i) {
+      std::this_thread::sleep_until(next_sample_time);
+      next_sample_time += kSamplePeriod;
+      const uint64_t timestamp_ns = testing::GetBootTimeNanos();
+      GyroscopeData gyro = {};
+      gyro.system_timestamp = timestamp_ns;
+      gyro.sensor_timestamp_ns = timestamp_ns;
+      EXPECT_TRUE(testing::EmitGyroscopeSamples(&gyro, 1));
+    }
+  });
+  source.join();
+  head_tracker.Pause();
+
+  const LatencyHistogram::Snapshot delivery_latency =
+      head_tracker.GetSensorDeliveryLatencyHistogram();
+  EXPECT_EQ(delivery_latency.num_samples, static_cast<uint64_t>(kNumSamples));
+  // The synthetic hub emits on the source thread, right after stamping.
+  EXPECT_LE(delivery_latency.GetPercentileNs(50), 10000000);
+
+  // The fusion thread wakes up at least once, at most once per notification.
+  const auto deadline = std::chrono::steady_clock::now() + kTimeout;
+  while (head_tracker.GetFusionWakeUpLatencyHistogram().num_samples == 0 &&
+         std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::yield();
+  }
+  const LatencyHistogram::Snapshot wake_up_latency =
+      head_tracker.GetFusionWakeUpLatencyHistogram();
+  EXPECT_GE(wake_up_latency.num_samples, 1u);
+  EXPECT_LE(wake_up_latency.num_samples, static_cast<uint64_t>(kNumSamples));
+}
+
+}  // namespace
+}  // namespace cardboard
@@ -0,0 +1,59 @@
+/*
+ * Copyright 2019 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "util/latency_histogram.h"
+
+#include "gtest/gtest.h"
+
+namespace cardboard {
+namespace {
+
+TEST(LatencyHistogramTest, RecordsInLogarithmicMicrosecondBuckets) {
+  LatencyHistogram histogram;
+  histogram.Record(-1000);
+  histogram.Record(999);
+  histogram.Record(1000);
+  histogram.Record(3999);
+  histogram.Record(int64_t{1} << 62);
+
+  const LatencyHistogram::Snapshot snapshot = histogram.GetSnapshot();
+  EXPECT_EQ(snapshot.num_samples, 5u);
+  EXPECT_EQ(snapshot.counts[0], 2u);
+  EXPECT_EQ(snapshot.counts[1], 1u);
+  EXPECT_EQ(snapshot.counts[2], 1u);
+  EXPECT_EQ(snapshot.counts[LatencyHistogram::kNumBuckets - 1], 1u);
+}
+
+TEST(LatencyHistogramTest, GetsPercentileUpperBounds) {
+  LatencyHistogram histogram;
+  EXPECT_EQ(histogram.GetSnapshot().GetPercentileNs(50), 0);
+
+  for (int i = 0; i < 90; ++i) {
+    histogram.Record(1500);
+  }
+  for (int i = 0; i < 10; ++i) {
+    histogram.Record(100000);
+  }
+  const LatencyHistogram::Snapshot snapshot = histogram.GetSnapshot();
+  EXPECT_EQ(snapshot.GetPercentileNs(50), 2000);
+  EXPECT_EQ(snapshot.GetPercentileNs(90), 2000);
+  EXPECT_EQ(snapshot.GetPercentileNs(99), 128000);
+
+  histogram.Reset();
+  EXPECT_EQ(histogram.GetSnapshot().num_samples, 0u);
+}
+
+}  // namespace
+}  // namespace cardboard
@@ -0,0 +1,159 @@
+/*
+ * Copyright 2019 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "sensors/rotation_state_history.h"
+
+#include <atomic>
+#include <cstdint>
+#include <thread>  // NOLINT
+
+#include "gtest/gtest.h"
+#include "util/rotation.h"
+#include "util/vector.h"
+
+namespace cardboard {
+namespace {
+
+constexpr int64_t kPeriod = 1000;
+
+// Angle of the rotation around Z at a timestamp, for a constant velocity.
+double GetYawAngle(int64_t timestamp) { return 1e-7 * timestamp; }
+
+// State of a constant yaw velocity, whose velocity field holds the timestamp
+// so that its linear interpolation can be checked.
+RotationState CreateState(int64_t timestamp) {
+  RotationState state;
+  state.timestamp = timestamp;
+  state.sensor_from_start_rotation =
+      Rotation::FromAxisAndAngle(Vector3(0, 0, 1), GetYawAngle(timestamp));
+  state.sensor_from_start_rotation_velocity =
+      Vector3(static_cast<double>(timestamp), 0, 1);
+  return state;
+}
+
+// Returns the angle between the rotation of a state and the one of
+// CreateState() at its timestamp.
+double GetRotationError(const RotationState& state) {
+  Vector3 axis;
+  double angle;
+  (-CreateState(state.timestamp).sensor_from_start_rotation *
+   state.sensor_from_start_rotation)
+      .GetAxisAndAngle(&axis, &angle);
+  return angle;
+}
+
+TEST(RotationStateHistoryTest, InterpolatesBetweenStates) {
+  RotationStateHistory history;
+  for (int64_t i = 1; i <= 10; ++i) {
+    history.Add(CreateState(i * kPeriod));
+  }
+
+  RotationState state;
+  ASSERT_TRUE(history.GetRotationState(4 * kPeriod + kPeriod / 4, &state));
+  EXPECT_EQ(state.timestamp, 4 * kPeriod + kPeriod / 4);
+  EXPECT_LT(GetRotationError(state), 1e-12);
+  EXPECT_DOUBLE_EQ(state.sensor_from_start_rotation_velocity[0],
+                   4 * kPeriod + kPeriod / 4);
+  EXPECT_DOUBLE_EQ(state.sensor_from_start_rotation_velocity[2], 1);
+
+  // The boundaries of the history are included.
+  ASSERT_TRUE(history.GetRotationState(kPeriod, &state));
+  EXPECT_LT(GetRotationError(state), 1e-12);
+  ASSERT_TRUE(history.GetRotationState(10 * kPeriod, &state));
+  EXPECT_LT(GetRotationError(state), 1e-12);
+}
+
+TEST(RotationStateHistoryTest, RejectsTimestampsOutsideHistory) {
+  RotationStateHistory history;
+  RotationState state;
+  EXPECT_FALSE(history.GetRotationState(0, &state));
+
+  history.Add(CreateState(kPeriod));
+  history.Add(CreateState(2 * kPeriod));
+  EXPECT_FALSE(history.GetRotationState(kPeriod - 1, &state));
+  EXPECT_FALSE(history.GetRotationState(2 * kPeriod + 1, &state));
+}
+
+TEST(RotationStateHistoryTest, IgnoresStatesOutOfOrder) {
+  RotationStateHistory history;
+  history.Add(CreateState(2 * kPeriod));
+  history.Add(CreateState(kPeriod));
+  history.Add(CreateState(2 * kPeriod));
+
+  RotationState state;
+  EXPECT_FALSE(history.GetRotationState(kPeriod, &state));
+  EXPECT_TRUE(history.GetRotationState(2 * kPeriod, &state));
+}
+
+TEST(RotationStateHistoryTest, KeepsLatestStates) {
+  RotationStateHistory history;
+  constexpr int64_t kNumStates = 3 * RotationStateHistory::kCapacity;
+  for (int64_t i = 1; i <= kNumStates; ++i) {
+    history.Add(CreateState(i * kPeriod));
+  }
+
+  RotationState state;
+  EXPECT_FALSE(history.GetRotationState(
+      (kNumStates - RotationStateHistory::kCapacity) * kPeriod, &state));
+  ASSERT_TRUE(history.GetRotationState(
+      (kNumStates - RotationStateHistory::kCapacity + 2) * kPeriod, &state));
+  EXPECT_LT(GetRotationError(state), 1e-12);
+}
+
+TEST(RotationStateHistoryTest, ClearRemovesStates) {
+  RotationStateHistory history;
+  history.Add(CreateState(kPeriod));
+  history.Add(CreateState(2 * kPeriod));
+  history.Clear();
+
+  RotationState state;
+  EXPECT_FALSE(history.GetRotationState(kPeriod, &state));
+  // The timestamps may restart after a clear.
+  history.Add(CreateState(kPeriod / 2));
+  history.Add(CreateState(kPeriod));
+  EXPECT_TRUE(history.GetRotationState(kPeriod - 1, &state));
+}
+
+TEST(RotationStateHistoryTest, ConcurrentReadsAreConsistent) {
+  constexpr int64_t kNumWrites = 200000;
+  RotationStateHistory history;
+  std::atomic<bool> is_done(false);
+
+  std::thread writer([&history, &is_done]() {
+    for (int64_t i = 1; i <= kNumWrites; ++i) {
+      history.Add(CreateState(i * kPeriod));
+    }
+    is_done = true;
+  });
+
+  int64_t query = 0;
+  while (!is_done) {
+    // Spreads the queries over the whole history, both in and out of it.
+    query = (query + 997 * kPeriod + 7) % (kNumWrites * kPeriod);
+    RotationState state;
+    if (history.GetRotationState(query, &state)) {
+      ASSERT_LT(GetRotationError(state), 1e-9);
+      ASSERT_NEAR(state.sensor_from_start_rotation_velocity[0], query, 1e-6);
+    }
+  }
+  writer.join();
+
+  RotationState state;
+  ASSERT_TRUE(history.GetRotationState(kNumWrites * kPeriod - 1, &state));
+  EXPECT_LT(GetRotationError(state), 1e-9);
+}
+
+}  // namespace
+}  // namespace cardboard
@@ -0,0 +1,116 @@
+/*
+ * Copyright 2019 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "sensors/sensor_event_batch.h"
+
+#include <cstddef>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace cardboard {
+namespace {
+
+// Raw event of the fake queue.
+struct FakeEvent {
+  int value;
+  bool is_valid;
+};
+
+// Fake sensor event queue, standing in for ASensorEventQueue on the host.
+class FakeEventQueue {
+ public:
+  void Add(int value, bool is_valid = true) {
+    events_.push_back({value, is_valid});
+  }
+
+  // Same contract as ASensorEventQueue_getEvents().
+  int GetEvents(FakeEvent* events, size_t max_count) {
+    ++num_reads_;
+    size_t count = 0;
+    while (count < max_count && next_event_ < events_.size()) {
+      events[count++] = events_[next_event_++];
+    }
+    return count == 0 ? -1 : static_cast<int>(count);
+  }
+
+  int num_reads() const { return num_reads_; }
+
+ private:
+  std::vector<FakeEvent> events_;
+  size_t next_event_ = 0;
+  int num_reads_ = 0;
+};
+
+// Reads one batch from @p queue into @p results.
+size_t ReadBatch(FakeEventQueue* queue, SensorEventBatch<FakeEvent>* events,
+                 SensorEventBatch<int>* results) {
+  return ReadSensorEventBatch<FakeEvent, int>(
+      [queue](FakeEvent* raw_events, size_t max_count) {
+        return queue->GetEvents(raw_events, max_count);
+      },
+      [](const FakeEvent& event, int* sample) {
+        *sample = event.value;
+        return event.is_valid;
+      },
+      events, results);
+}
+
+TEST(SensorEventBatchTest, EmptyQueueYieldsNoSample) {
+  FakeEventQueue queue;
+  SensorEventBatch<FakeEvent> events;
+  SensorEventBatch<int> results;
+  EXPECT_EQ(ReadBatch(&queue, &events, &results), 0u);
+}
+
+TEST(SensorEventBatchTest, DrainsQueueInFullBatches) {
+  FakeEventQueue queue;
+  const int num_events = 2 * static_cast<int>(kSensorEventBatchSize) + 5;
+  for (int i = 0; i < num_events; ++i) {
+    queue.Add(i);
+  }
+  SensorEventBatch<FakeEvent> events;
+  SensorEventBatch<int> results;
+
+  std::vector<int> samples;
+  size_t num_results;
+  while ((num_results = ReadBatch(&queue, &events, &results)) > 0) {
+    samples.insert(samples.end(), results.begin(),
+                   results.begin() + num_results);
+  }
+
+  // Three batches and the read finding the queue empty.
+  EXPECT_EQ(queue.num_reads(), 4);
+  ASSERT_EQ(samples.size(), static_cast<size_t>(num_events));
+  for (int i = 0; i < num_events; ++i) {
+    EXPECT_EQ(samples[i], i);
+  }
+}
+
+TEST(SensorEventBatchTest, DiscardedEventsLeaveNoGap) {
+  FakeEventQueue queue;
+  queue.Add(1);
+  queue.Add(2, false);
+  queue.Add(3);
+  SensorEventBatch<FakeEvent> events;
+  SensorEventBatch<int> results;
+
+  ASSERT_EQ(ReadBatch(&queue, &events, &results), 2u);
+  EXPECT_EQ(results[0], 1);
+  EXPECT_EQ(results[1], 3);
+}
+
+}  // namespace
+}  // namespace cardboard
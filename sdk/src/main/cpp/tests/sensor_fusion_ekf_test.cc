@@ -0,0 +1,854 @@
+/*
+ * Copyright 2019 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "sensors/sensor_fusion_ekf.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <random>
+
+#include "gtest/gtest.h"
+#include "sensors/accelerometer_correction_schedule.h"
+#include "util/matrix_3x3.h"
+#include "util/matrixutils.h"
+#include "util/rotation.h"
+#include "util/symmetric_matrix_3x3.h"
+#include "util/vector.h"
+#include "util/vectorutils.h"
+
+namespace cardboard {
+
+namespace {
+
+// Returns the rotation vector of @p rotation.
+template <typename T>
+Vector<3, T> ToRotationVector(const RotationT<T>& rotation) {
+  Vector<3, T> axis;
+  T angle;
+  rotation.GetAxisAndAngle(&axis, &angle);
+  return axis * angle;
+}
+
+// Returns the largest absolute difference between two matrices.
+template <typename T>
+T MaxDifference(const Matrix3x3T<T>& a, const Matrix3x3T<T>& b) {
+  T max_difference = 0;
+  for (int row = 0; row < 3; ++row) {
+    for (int col = 0; col < 3; ++col) {
+      max_difference =
+          std::max(max_difference, std::abs(a(row, col) - b(row, col)));
+    }
+  }
+  return max_difference;
+}
+
+// Returns a random unit vector.
+Vector3 RandomDirection(std::mt19937* random_engine) {
+  std::normal_distribution<double> normal;
+  Vector3 direction(normal(*random_engine), normal(*random_engine),
+                    normal(*random_engine));
+  return direction / Length(direction);
+}
+
+}  // namespace
+
+// Gives the tests access to the internals of the filter.
+class SensorFusionEkfTest : public ::testing::Test {
+ protected:
+  // Closed form and finite-difference measurement Jacobians of a filter.
+  template <typename T>
+  struct MeasurementJacobians {
+    Matrix3x3T<T> closed_form;
+    Matrix3x3T<T> numerical;
+  };
+
+  template <typename T>
+  static MeasurementJacobians<T> ComputeMeasurementJacobians(
+      const RotationT<T>& rotation, const Vector<3, T>& measurement) {
+    auto ekf = std::make_unique<SensorFusionEkfT<T>>();
+    ekf->current_state_.sensor_from_start_rotation = rotation;
+    ekf->accelerometer_measurement_ = measurement;
+    ekf->innovation_ = ekf->ComputeInnovation(rotation);
+
+    MeasurementJacobians<T> jacobians;
+    ekf->ComputeMeasurementJacobianNumerically();
+    jacobians.numerical = ekf->accelerometer_measurement_jacobian_;
+    ekf->ComputeMeasurementJacobian();
+    jacobians.closed_form = ekf->accelerometer_measurement_jacobian_;
+    return jacobians;
+  }
+
+  // Applies the sequential measurement update of a filter.
+  //
+  // @param state_update receives the update of the state.
+  // @param covariance covariance before the update, receives the updated one.
+  static void UpdateStateWithMeasurement(const Matrix3x3& jacobian,
+                                         const Vector3& innovation,
+                                         double measurement_variance,
+                                         Vector3* state_update,
+                                         SymmetricMatrix3x3* covariance) {
+    auto ekf = std::make_unique<SensorFusionEkf>();
+    ekf->state_covariance_ = *covariance;
+    ekf->accelerometer_measurement_jacobian_ = jacobian;
+    ekf->innovation_ = innovation;
+    ekf->accelerometer_measurement_variance_ = measurement_variance;
+    ekf->UpdateStateWithMeasurement();
+    *state_update = ekf->state_update_;
+    *covariance = ekf->state_covariance_;
+  }
+
+  // Accuracy and number of gravity corrections of a replay.
+  struct ReplayResult {
+    double max_tilt_error;
+    int num_corrections;
+  };
+
+  // Replays 30 s of synthetic 400 Hz head motion with linear acceleration and
+  // gyroscope noise, and compares the estimated tilt against the true one
+  // after the first 5 s.
+  static ReplayResult ReplayHeadMotion(
+      const AccelerometerCorrectionSchedule& schedule) {
+    auto ekf = std::make_unique<SensorFusionEkf>();
+    ekf->SetAccelerometerCorrectionSchedule(schedule);
+    std::mt19937 random_engine(1);
+    std::normal_distribution<double> gyroscope_noise(0.0, 0.01);
+
+    constexpr int64_t kSamplePeriodNs = 2500000;
+    constexpr int kNumSamples = 30 * 400;
+    constexpr int kNumSettlingSamples = 5 * 400;
+    Rotation sensor_from_start_rotation = Rotation::Identity();
+    ReplayResult result = {0, 0};
+    uint64_t last_correction_timestamp_ns = 0;
+    for (int i = 1; i <= kNumSamples; ++i) {
+      const double t = i * 0.0025;
+      const Vector3 velocity(0.8 * std::sin(1.3 * t), 1.2 * std::sin(0.7 * t),
+                             0.4 * std::cos(2.1 * t));
+      sensor_from_start_rotation =
+          Rotation::FromAxisAndAngle(velocity / Length(velocity),
+                                     -Length(velocity) * 0.0025) *
+          sensor_from_start_rotation;
+      // Horizontal head translation in Start Space.
+      const Vector3 linear_acceleration(0.8 * std::sin(3.0 * t),
+                                        0.8 * std::cos(2.3 * t), 0);
+
+      GyroscopeData gyroscope_sample = {};
+      gyroscope_sample.sensor_timestamp_ns = i * kSamplePeriodNs;
+      gyroscope_sample.data =
+          velocity + Vector3(gyroscope_noise(random_engine),
+                             gyroscope_noise(random_engine),
+                             gyroscope_noise(random_engine));
+      AccelerometerData accelerometer_sample = {};
+      accelerometer_sample.sensor_timestamp_ns = i * kSamplePeriodNs;
+      accelerometer_sample.data =
+          sensor_from_start_rotation *
+          (Vector3(0, 0, 9.81) + linear_acceleration);
+      ekf->ProcessGyroscopeSample(gyroscope_sample);
+      ekf->ProcessAccelerometerSample(accelerometer_sample);
+
+      if (ekf->last_correction_sensor_timestamp_ns_ !=
+          last_correction_timestamp_ns) {
+        last_correction_timestamp_ns =
+            ekf->last_correction_sensor_timestamp_ns_;
+        ++result.num_corrections;
+      }
+      if (i > kNumSettlingSamples) {
+        const Rotation rotation =
+            ekf->GetLatestRotationState().sensor_from_start_rotation;
+        result.max_tilt_error = std::max(
+            result.max_tilt_error,
+            Length(Cross(rotation * Vector3(0, 0, 1),
+                         sensor_from_start_rotation * Vector3(0, 0, 1))));
+      }
+    }
+    return result;
+  }
+
+  // Integrates 5 s of 200 Hz gyroscope samples of a coning motion, and
+  // returns the largest orientation error against a 200 substep integration of
+  // the true angular velocity.
+  static double ComputeConingError(GyroscopeIntegrationScheme scheme) {
+    auto ekf = std::make_unique<SensorFusionEkf>();
+    ekf->SetGyroscopeIntegrationScheme(scheme);
+    ekf->is_aligned_with_gravity_ = true;
+
+    // Angular velocity of 3 rad/s rotating at 2 Hz in the x-y plane.
+    const auto velocity = [](double t) {
+      constexpr double kConingFrequency = 2 * M_PI * 2;
+      return Vector3(3 * std::cos(kConingFrequency * t),
+                     3 * std::sin(kConingFrequency * t), 0);
+    };
+    constexpr int64_t kSamplePeriodNs = 5000000;
+    constexpr double kSamplePeriodS = 0.005;
+    constexpr int kNumSubsteps = 200;
+    Rotation sensor_from_start_rotation = Rotation::Identity();
+    double max_error = 0;
+    for (int i = 0; i <= 5 * 200; ++i) {
+      if (i > 0) {
+        for (int j = 0; j < kNumSubsteps; ++j) {
+          const double t =
+              (i - 1 + (j + 0.5) / kNumSubsteps) * kSamplePeriodS;
+          const Vector3 substep_velocity = velocity(t);
+          sensor_from_start_rotation =
+              Rotation::FromAxisAndAngle(
+                  substep_velocity / Length(substep_velocity),
+                  -Length(substep_velocity) * kSamplePeriodS / kNumSubsteps) *
+              sensor_from_start_rotation;
+        }
+      }
+      GyroscopeData sample = {};
+      sample.sensor_timestamp_ns = 1000000000 + i * kSamplePeriodNs;
+      sample.data = velocity(i * kSamplePeriodS);
+      ekf->ProcessGyroscopeSample(sample);
+
+      const Rotation rotation =
+          ekf->GetLatestRotationState().sensor_from_start_rotation;
+      max_error = std::max(
+          max_error,
+          Length(ToRotationVector(rotation * -sensor_from_start_rotation)));
+    }
+    return max_error;
+  }
+
+  // Integrates gyroscope samples with the gyroscope bias in the state.
+  //
+  // @param bias_estimate gyroscope bias estimate of the filter.
+  // @param bias_jacobian receives the Jacobian of the integrated rotation with
+  //     respect to the bias.
+  // @return the integrated rotation.
+  static Rotation IntegrateGyroscope(const Vector3& bias_estimate,
+                                     Matrix3x3* bias_jacobian) {
+    auto ekf = std::make_unique<SensorFusionEkf>(
+        kRotationAndGyroscopeBiasStateModel);
+    ekf->is_aligned_with_gravity_ = true;
+    ekf->gyroscope_bias_estimate_ = bias_estimate;
+    for (int i = 0; i <= 100; ++i) {
+      GyroscopeData sample = {};
+      sample.sensor_timestamp_ns = 1000000000 + i * 5000000;
+      sample.data = Vector3(std::sin(0.1 * i), 0.5 * std::cos(0.07 * i), 0.3);
+      ekf->ProcessGyroscopeSample(sample);
+    }
+    *bias_jacobian = ekf->preintegrated_bias_jacobian_;
+    return ekf->current_state_.sensor_from_start_rotation;
+  }
+
+  // Replays two minutes of synthetic 200 Hz head motion, without the device
+  // ever lying still, with a constant gyroscope bias.
+  //
+  // @return the gyroscope bias estimated at the end.
+  static Vector3 EstimateGyroscopeBiasWhileMoving(
+      SensorFusionStateModel state_model, const Vector3& bias) {
+    auto ekf = std::make_unique<SensorFusionEkf>(state_model);
+    constexpr int64_t kSamplePeriodNs = 5000000;
+    constexpr int kNumSamples = 2 * 60 * 200;
+    Rotation sensor_from_start_rotation = Rotation::Identity();
+    for (int i = 1; i <= kNumSamples; ++i) {
+      const double t = i * 0.005;
+      const Vector3 velocity(0.8 * std::sin(1.3 * t), 1.2 * std::sin(0.7 * t),
+                             0.4 * std::cos(2.1 * t));
+      sensor_from_start_rotation =
+          Rotation::FromAxisAndAngle(velocity / Length(velocity),
+                                     -Length(velocity) * 0.005) *
+          sensor_from_start_rotation;
+
+      GyroscopeData gyroscope_sample = {};
+      gyroscope_sample.sensor_timestamp_ns = i * kSamplePeriodNs;
+      gyroscope_sample.data = velocity + bias;
+      AccelerometerData accelerometer_sample = {};
+      accelerometer_sample.sensor_timestamp_ns = i * kSamplePeriodNs;
+      accelerometer_sample.data =
+          9.81 * (sensor_from_start_rotation * Vector3(0, 0, 1));
+      ekf->ProcessGyroscopeSample(gyroscope_sample);
+      ekf->ProcessAccelerometerSample(accelerometer_sample);
+    }
+    return GetGyroscopeBiasEstimate(*ekf);
+  }
+
+  // Gets the gyroscope bias estimate of a filter.
+  static Vector3 GetGyroscopeBiasEstimate(const SensorFusionEkf& ekf) {
+    return ekf.gyroscope_bias_estimate_;
+  }
+
+  // Gets the state covariance of a filter.
+  template <typename T>
+  static SymmetricMatrix3x3T<T> GetStateCovariance(
+      const SensorFusionEkfT<T>& ekf) {
+    return ekf.state_covariance_;
+  }
+
+  // Aligns a filter with gravity along Z, then rotates it around Z at 400 Hz
+  // for 200 ms with a constant angular acceleration.
+  //
+  // @return the angular velocity of the latest gyroscope sample.
+  static double StartYawTurn(SensorFusionEkf* ekf, double acceleration) {
+    ProcessStillGyroscopeSamples(
+        ekf, [](int) { return Vector3(0, 0, 9.81); }, 1, 20);
+    double velocity = 0;
+    for (int i = 21; i <= 100; ++i) {
+      velocity = acceleration * (i - 20) * 0.0025;
+      GyroscopeData gyroscope_sample = {};
+      gyroscope_sample.system_timestamp = i * 2500000;
+      gyroscope_sample.sensor_timestamp_ns = i * 2500000;
+      gyroscope_sample.data = Vector3(0, 0, velocity);
+      ekf->ProcessGyroscopeSample(gyroscope_sample);
+    }
+    return velocity;
+  }
+
+  // Gets the angle of the rotation predicted by a filter since its latest
+  // state.
+  static double GetPredictedAngle(const SensorFusionEkf& ekf,
+                                  int64_t horizon_ns) {
+    const RotationState state = ekf.GetLatestRotationState();
+    return Length(ToRotationVector(
+        ekf.PredictRotation(state.timestamp + horizon_ns) *
+        -state.sensor_from_start_rotation));
+  }
+
+  // Tells whether a filter has a recenter of the yaw angle pending.
+  static bool HasPendingYawRecenter(const SensorFusionEkf& ekf) {
+    return ekf.has_pending_yaw_recenter_;
+  }
+
+  // Tells whether the rotation of a filter was aligned with gravity.
+  static bool IsAlignedWithGravity(const SensorFusionEkf& ekf) {
+    return ekf.is_aligned_with_gravity_;
+  }
+
+  // Feeds 400 Hz samples of a device that does not rotate to a filter.
+  //
+  // @param accelerometer_data function giving the accelerometer sample of a
+  //     sample index.
+  // @param first_sample index of the first sample, starting from 1.
+  // @param last_sample index of the last sample.
+  template <typename F>
+  static void ProcessStillGyroscopeSamples(SensorFusionEkf* ekf,
+                                           F accelerometer_data,
+                                           int first_sample, int last_sample) {
+    for (int i = first_sample; i <= last_sample; ++i) {
+      AccelerometerData accelerometer_sample = {};
+      accelerometer_sample.sensor_timestamp_ns = i * 2500000;
+      accelerometer_sample.data = accelerometer_data(i);
+      GyroscopeData gyroscope_sample = {};
+      gyroscope_sample.sensor_timestamp_ns = i * 2500000;
+      ekf->ProcessAccelerometerSample(accelerometer_sample);
+      ekf->ProcessGyroscopeSample(gyroscope_sample);
+    }
+  }
+};
+
+TEST_F(SensorFusionEkfTest, MeasurementJacobianMatchesFiniteDifferences) {
+  std::mt19937 random_engine(1);
+  std::uniform_real_distribution<double> angle(0.0, 2.5);
+  for (int i = 0; i < 100; ++i) {
+    const Rotation rotation = Rotation::FromAxisAndAngle(
+        RandomDirection(&random_engine), angle(random_engine));
+    // Measured down direction within 2.5 rad of the predicted one.
+    const Vector3 predicted_down = rotation * Vector3(0, 0, 1);
+    const Vector3 measurement =
+        9.81 * (Rotation::FromAxisAndAngle(RandomDirection(&random_engine),
+                                           angle(random_engine)) *
+                predicted_down);
+
+    const MeasurementJacobians<double> jacobians =
+        ComputeMeasurementJacobians(rotation, measurement);
+    EXPECT_LT(MaxDifference(jacobians.closed_form, jacobians.numerical), 1e-5)
+        << "rotation " << i;
+  }
+}
+
+TEST_F(SensorFusionEkfTest, MeasurementJacobianOfSmallInnovation) {
+  // Finite differences are not accurate for a tiny innovation, but the
+  // Jacobian tends to the projection orthogonal to the down direction.
+  const Rotation rotation =
+      Rotation::FromAxisAndAngle(Vector3(1, 0, 0), 0.3);
+  const Vector3 predicted_down = rotation * Vector3(0, 0, 1);
+  const Vector3 measurement =
+      9.81 * (Rotation::FromAxisAndAngle(Vector3(0, 1, 0), 1e-9) *
+              predicted_down);
+
+  Matrix3x3 projection;
+  for (int row = 0; row < 3; ++row) {
+    for (int col = 0; col < 3; ++col) {
+      projection(row, col) =
+          (row == col ? 1.0 : 0.0) - predicted_down[row] * predicted_down[col];
+    }
+  }
+  const MeasurementJacobians<double> jacobians =
+      ComputeMeasurementJacobians(rotation, measurement);
+  EXPECT_LT(MaxDifference(jacobians.closed_form, projection), 1e-6);
+}
+
+TEST_F(SensorFusionEkfTest, FloatMeasurementJacobianMatchesFiniteDifferences) {
+  const Rotationf rotation =
+      Rotationf::FromAxisAndAngle(Vector<3, float>(0.6f, 0.0f, 0.8f), 0.7f);
+  const Vector<3, float> measurement(1.0f, -2.0f, 9.5f);
+
+  const MeasurementJacobians<float> jacobians =
+      ComputeMeasurementJacobians(rotation, measurement);
+  // The finite differences use a larger step in single precision.
+  EXPECT_LT(MaxDifference(jacobians.closed_form, jacobians.numerical), 1e-2f);
+}
+
+TEST_F(SensorFusionEkfTest, FloatFilterStaysWithinEnvelopeOfDoubleFilter) {
+  auto ekf = std::make_unique<SensorFusionEkf>();
+  auto ekf_float = std::make_unique<SensorFusionEkff>();
+
+  // Two minutes of continuous head motion at 200 Hz.
+  constexpr int64_t kSamplePeriodNs = 5000000;
+  constexpr int kNumSamples = 2 * 60 * 200;
+  Rotation sensor_from_start_rotation = Rotation::Identity();
+  double max_angle_difference = 0;
+  double max_tilt_difference = 0;
+  for (int i = 1; i <= kNumSamples; ++i) {
+    const double t = i * 0.005;
+    const Vector3 velocity(0.8 * std::sin(1.3 * t), 1.2 * std::sin(0.7 * t),
+                           0.4 * std::cos(2.1 * t));
+    // The state rotates from Start to Sensor Space, i.e. by the opposite of
+    // the angular velocity.
+    sensor_from_start_rotation =
+        Rotation::FromAxisAndAngle(velocity / Length(velocity),
+                                   -Length(velocity) * 0.005) *
+        sensor_from_start_rotation;
+
+    GyroscopeData gyroscope_sample = {};
+    gyroscope_sample.sensor_timestamp_ns = i * kSamplePeriodNs;
+    gyroscope_sample.data = velocity;
+    AccelerometerData accelerometer_sample = {};
+    accelerometer_sample.sensor_timestamp_ns = i * kSamplePeriodNs;
+    accelerometer_sample.data =
+        9.81 * (sensor_from_start_rotation * Vector3(0, 0, 1));
+
+    ekf->ProcessGyroscopeSample(gyroscope_sample);
+    ekf->ProcessAccelerometerSample(accelerometer_sample);
+    ekf_float->ProcessGyroscopeSample(gyroscope_sample);
+    ekf_float->ProcessAccelerometerSample(accelerometer_sample);
+
+    const Rotation rotation =
+        ekf->GetLatestRotationState().sensor_from_start_rotation;
+    const Rotation float_rotation =
+        ekf_float->GetLatestRotationState().sensor_from_start_rotation;
+    max_angle_difference = std::max(
+        max_angle_difference,
+        Length(ToRotationVector(rotation * -float_rotation)));
+    max_tilt_difference = std::max(
+        max_tilt_difference, Length(Cross(rotation * Vector3(0, 0, 1),
+                                          float_rotation * Vector3(0, 0, 1))));
+  }
+  // See the accuracy envelope in sensor_fusion_ekf.h.
+  EXPECT_LT(max_angle_difference, 1e-3);
+  EXPECT_LT(max_tilt_difference, 1e-4);
+}
+
+TEST_F(SensorFusionEkfTest, SequentialUpdateMatchesBatchUpdate) {
+  const SymmetricMatrix3x3 covariance = SymmetricMatrix3x3::FromMatrix(
+      Matrix3x3(0.04, 0.01, -0.005, 0.01, 0.03, 0.002, -0.005, 0.002, 0.05));
+  const Matrix3x3 jacobian(0.9, -0.1, 0.2, 0.05, 0.8, -0.3, -0.2, 0.1, 0.7);
+  const Vector3 innovation(0.02, -0.01, 0.03);
+  constexpr double kMeasurementVariance = 0.01;
+
+  // K = P * H' * (H * P * H' + R)^-1, x = K * nu and P = (I - K * H) * P.
+  const Matrix3x3 p = covariance.ToMatrix();
+  const Matrix3x3 innovation_covariance =
+      jacobian * p * Transpose(jacobian) +
+      kMeasurementVariance * Matrix3x3::Identity();
+  const Matrix3x3 gain =
+      p * Transpose(jacobian) * Inverse(innovation_covariance);
+  const Vector3 expected_state_update = gain * innovation;
+  const Matrix3x3 expected_covariance =
+      (Matrix3x3::Identity() - gain * jacobian) * p;
+
+  Vector3 state_update;
+  SymmetricMatrix3x3 updated_covariance = covariance;
+  UpdateStateWithMeasurement(jacobian, innovation, kMeasurementVariance,
+                             &state_update, &updated_covariance);
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_NEAR(state_update[i], expected_state_update[i], 1e-12);
+  }
+  EXPECT_LT(MaxDifference(updated_covariance.ToMatrix(), expected_covariance),
+            1e-12);
+}
+
+TEST_F(SensorFusionEkfTest, FloatCovarianceStaysPositiveDefinite) {
+  auto ekf = std::make_unique<SensorFusionEkff>();
+
+  // Two minutes of continuous head motion at 200 Hz, with the device lying
+  // still for the last half so that the covariance shrinks.
+  constexpr int64_t kSamplePeriodNs = 5000000;
+  constexpr int kNumSamples = 2 * 60 * 200;
+  Rotation sensor_from_start_rotation = Rotation::Identity();
+  for (int i = 1; i <= kNumSamples; ++i) {
+    const double t = i * 0.005;
+    const Vector3 velocity =
+        i < kNumSamples / 2
+            ? Vector3(0.8 * std::sin(1.3 * t), 1.2 * std::sin(0.7 * t),
+                      0.4 * std::cos(2.1 * t) + 0.5)
+            : Vector3::Zero();
+    if (Length(velocity) > 0) {
+      sensor_from_start_rotation =
+          Rotation::FromAxisAndAngle(velocity / Length(velocity),
+                                     -Length(velocity) * 0.005) *
+          sensor_from_start_rotation;
+    }
+
+    GyroscopeData gyroscope_sample = {};
+    gyroscope_sample.sensor_timestamp_ns = i * kSamplePeriodNs;
+    gyroscope_sample.data = velocity;
+    AccelerometerData accelerometer_sample = {};
+    accelerometer_sample.sensor_timestamp_ns = i * kSamplePeriodNs;
+    accelerometer_sample.data =
+        9.81 * (sensor_from_start_rotation * Vector3(0, 0, 1));
+    ekf->ProcessGyroscopeSample(gyroscope_sample);
+    ekf->ProcessAccelerometerSample(accelerometer_sample);
+
+    // Sylvester's criterion, evaluated in double precision.
+    const Matrix3x3f float_covariance = GetStateCovariance(*ekf).ToMatrix();
+    Matrix3x3 covariance;
+    for (int row = 0; row < 3; ++row) {
+      for (int col = 0; col < 3; ++col) {
+        covariance(row, col) = float_covariance(row, col);
+      }
+    }
+    ASSERT_GT(covariance(0, 0), 0.0) << "sample " << i;
+    ASSERT_GT(covariance(0, 0) * covariance(1, 1) -
+                  covariance(0, 1) * covariance(1, 0),
+              0.0)
+        << "sample " << i;
+    double determinant;
+    AdjugateWithDeterminant(covariance, &determinant);
+    ASSERT_GT(determinant, 0.0) << "sample " << i;
+  }
+}
+
+TEST_F(SensorFusionEkfTest, CorrectionScheduleKeepsTiltAccuracy) {
+  const ReplayResult every_sample =
+      ReplayHeadMotion(kEverySampleCorrectionSchedule);
+  // 50 Hz corrections, lowered to 10 Hz under strong linear acceleration.
+  const ReplayResult scheduled = ReplayHeadMotion({20000000, 100000000, true});
+
+  // The first 12 accelerometer samples align the filter with gravity.
+  EXPECT_EQ(every_sample.num_corrections, 30 * 400 - 11);
+  EXPECT_LE(scheduled.num_corrections, 30 * 50 + 1);
+  EXPECT_GE(scheduled.num_corrections, 30 * 10);
+  // The linear acceleration dominates the tilt error, so fewer averaged
+  // corrections do not degrade it.
+  EXPECT_LT(every_sample.max_tilt_error, 0.1);
+  EXPECT_LT(scheduled.max_tilt_error, 1.5 * every_sample.max_tilt_error);
+}
+
+TEST_F(SensorFusionEkfTest, FixedCorrectionScheduleSkipsSamples) {
+  const ReplayResult scheduled = ReplayHeadMotion({20000000, 0, false});
+  // One correction every 8 accelerometer samples after the gravity alignment.
+  EXPECT_EQ(scheduled.num_corrections, (30 * 400 - 12) / 8 + 1);
+  EXPECT_LT(scheduled.max_tilt_error, 0.1);
+}
+
+TEST_F(SensorFusionEkfTest, HigherOrderIntegrationReducesConingError) {
+  const double exponential_map_error =
+      ComputeConingError(kGyroscopeIntegrationExponentialMap);
+  const double midpoint_error =
+      ComputeConingError(kGyroscopeIntegrationMidpoint);
+  const double runge_kutta_error =
+      ComputeConingError(kGyroscopeIntegrationRungeKutta4);
+  const double coning_error = ComputeConingError(kGyroscopeIntegrationConing);
+
+  EXPECT_LT(midpoint_error, exponential_map_error / 2);
+  EXPECT_LT(runge_kutta_error, midpoint_error / 1.5);
+  EXPECT_LT(coning_error, midpoint_error / 1.5);
+}
+
+TEST_F(SensorFusionEkfTest, BiasJacobianMatchesFiniteDifferences) {
+  const Vector3 bias_estimate(0.01, -0.02, 0.005);
+  Matrix3x3 bias_jacobian;
+  const Rotation rotation = IntegrateGyroscope(bias_estimate, &bias_jacobian);
+
+  constexpr double kBiasStep = 1e-6;
+  for (int col = 0; col < 3; ++col) {
+    Vector3 perturbed_bias_estimate = bias_estimate;
+    perturbed_bias_estimate[col] += kBiasStep;
+    Matrix3x3 unused_jacobian;
+    const Rotation perturbed_rotation =
+        IntegrateGyroscope(perturbed_bias_estimate, &unused_jacobian);
+
+    // A bias error rotates the state to the left, in Sensor Space. The
+    // Jacobian approximates the derivative of each step by its timestep, which
+    // is within about 1e-3 over half a second of motion.
+    const Vector3 rotation_error =
+        ToRotationVector(perturbed_rotation * -rotation) / kBiasStep;
+    for (int row = 0; row < 3; ++row) {
+      EXPECT_NEAR(rotation_error[row], bias_jacobian(row, col), 2e-3)
+          << "row " << row << " col " << col;
+    }
+  }
+}
+
+TEST_F(SensorFusionEkfTest, GyroscopeBiasStateConvergesWhileMoving) {
+  const Vector3 bias(0.012, -0.009, 0.007);
+  const Vector3 estimate = EstimateGyroscopeBiasWhileMoving(
+      kRotationAndGyroscopeBiasStateModel, bias);
+  EXPECT_LT(Length(estimate - bias), 2e-3);
+
+  // The rotation state model only learns the bias while lying still.
+  EXPECT_EQ(
+      Length(EstimateGyroscopeBiasWhileMoving(kRotationStateModel, bias)), 0);
+}
+
+TEST_F(SensorFusionEkfTest, HardwareBiasSeedsGyroscopeBiasState) {
+  SensorFusionEkf ekf(kRotationAndGyroscopeBiasStateModel);
+  const Vector3 hardware_bias(0.01, 0.02, -0.03);
+  for (int i = 0; i < 3; ++i) {
+    GyroscopeData sample = {};
+    sample.sensor_timestamp_ns = 1000000000 + i * 5000000;
+    sample.has_hardware_bias = true;
+    // Only the first bias reported by the driver seeds the state.
+    sample.hardware_bias = (i + 1) * hardware_bias;
+    ekf.ProcessGyroscopeSample(sample);
+  }
+  EXPECT_LT(Length(GetGyroscopeBiasEstimate(ekf) - hardware_bias), 1e-12);
+}
+
+TEST_F(SensorFusionEkfTest, RestoredSnapshotWarmStartsGyroscopeBias) {
+  SensorFusionSnapshot snapshot;
+  snapshot.gyroscope_bias = Vector3(0.012, -0.009, 0.007);
+  snapshot.has_gyroscope_bias = true;
+  snapshot.gyroscope_bias_covariance = SymmetricMatrix3x3::Identity() * 1e-6;
+  snapshot.gyroscope_timestep_s = 0.005;
+  snapshot.has_gyroscope_timestep = true;
+
+  for (const SensorFusionStateModel state_model :
+       {kRotationStateModel, kRotationAndGyroscopeBiasStateModel}) {
+    SensorFusionEkf ekf(state_model);
+    ekf.RestoreSnapshot(snapshot);
+    for (int reset = 0; reset < 2; ++reset) {
+      for (int i = 1; i <= 100; ++i) {
+        AccelerometerData accelerometer_sample = {};
+        accelerometer_sample.sensor_timestamp_ns = (reset * 100 + i) * 5000000;
+        accelerometer_sample.data = Vector3(0, 0, 9.81);
+        GyroscopeData gyroscope_sample = {};
+        gyroscope_sample.sensor_timestamp_ns = (reset * 100 + i) * 5000000;
+        gyroscope_sample.data = snapshot.gyroscope_bias;
+        ekf.ProcessAccelerometerSample(accelerometer_sample);
+        if (i == 1) {
+          // The restored bias is used from the reset on.
+          EXPECT_LT(
+              Length(GetGyroscopeBiasEstimate(ekf) - snapshot.gyroscope_bias),
+              1e-12)
+              << "state model " << state_model << " reset " << reset;
+        }
+        ekf.ProcessGyroscopeSample(gyroscope_sample);
+      }
+      EXPECT_LT(
+          Length(GetGyroscopeBiasEstimate(ekf) - snapshot.gyroscope_bias),
+          1e-7)
+          << "state model " << state_model << " reset " << reset;
+      EXPECT_LT(Length(ToRotationVector(
+                    ekf.GetLatestRotationState().sensor_from_start_rotation)),
+                1e-3)
+          << "state model " << state_model << " reset " << reset;
+      // Resets keep the learned state.
+      ekf.Reset();
+    }
+
+    SensorFusionSnapshot captured_snapshot;
+    ASSERT_TRUE(ekf.GetSnapshot(&captured_snapshot));
+    EXPECT_TRUE(captured_snapshot.has_gyroscope_bias);
+    EXPECT_TRUE(captured_snapshot.has_gyroscope_timestep);
+    EXPECT_NEAR(captured_snapshot.gyroscope_timestep_s, 0.005, 1e-6);
+  }
+}
+
+TEST_F(SensorFusionEkfTest, GravityAlignmentRejectsBumpAtReset) {
+  // The device is bumped for 10 ms when the filter resets, then lies still.
+  SensorFusionEkf ekf;
+  ProcessStillGyroscopeSamples(
+      &ekf,
+      [](int i) { return i <= 4 ? Vector3(5, 0, 9.81) : Vector3(0, 0, 9.81); },
+      1, 20);
+
+  ASSERT_TRUE(IsAlignedWithGravity(ekf));
+  const Vector3 down = ekf.GetLatestRotationState().sensor_from_start_rotation *
+                       Vector3(0, 0, 1);
+  // Aligning with the first sample would tilt the rotation by 27 degrees.
+  EXPECT_LT(std::acos(std::min(Dot(down, Vector3(0, 0, 1)), 1.0)), 1e-3);
+}
+
+TEST_F(SensorFusionEkfTest, GravityAlignmentDelayIsBounded) {
+  // The device keeps moving, so the alignment window never completes.
+  SensorFusionEkf ekf;
+  const auto accelerometer_data = [](int i) {
+    return Vector3(i % 2 == 0 ? 2 : -2, 0, 9.81);
+  };
+  ProcessStillGyroscopeSamples(&ekf, accelerometer_data, 1, 80);
+  EXPECT_FALSE(IsAlignedWithGravity(ekf));
+
+  // 200 ms after the first sample.
+  ProcessStillGyroscopeSamples(&ekf, accelerometer_data, 81, 81);
+  EXPECT_TRUE(IsAlignedWithGravity(ekf));
+}
+
+TEST_F(SensorFusionEkfTest, RecenterYawKeepsTilt) {
+  const Vector3 gravity =
+      Rotation::FromAxisAndAngle(Vector3(1, 0, 0), 0.3) * Vector3(0, 0, 9.81);
+  const auto accelerometer_data = [&gravity](int) { return gravity; };
+  SensorFusionEkf ekf;
+  // A recenter requested before the alignment with gravity waits for it.
+  ekf.RecenterYaw();
+  ProcessStillGyroscopeSamples(&ekf, accelerometer_data, 1, 1);
+  EXPECT_TRUE(HasPendingYawRecenter(ekf));
+  ProcessStillGyroscopeSamples(&ekf, accelerometer_data, 2, 20);
+  ASSERT_TRUE(IsAlignedWithGravity(ekf));
+  EXPECT_FALSE(HasPendingYawRecenter(ekf));
+
+  const Rotation aligned_rotation =
+      Rotation::RotateInto(Vector3(0, 0, 1), gravity / Length(gravity));
+  ekf.RotateSensorSpaceToStartSpaceTransformation(
+      Rotation::FromAxisAndAngle(Vector3(0, 0, 1), 1.0));
+  ProcessStillGyroscopeSamples(&ekf, accelerometer_data, 21, 21);
+  EXPECT_GT(Length(ToRotationVector(
+                -aligned_rotation *
+                ekf.GetLatestRotationState().sensor_from_start_rotation)),
+            0.9);
+
+  // The heading matches the one of a reset.
+  ekf.RecenterYaw();
+  ekf.ApplyPendingStartSpaceRotation();
+  EXPECT_LT(Length(ToRotationVector(
+                -aligned_rotation *
+                ekf.GetLatestRotationState().sensor_from_start_rotation)),
+            1e-6);
+}
+
+TEST_F(SensorFusionEkfTest, PastRotationStatesAreInCurrentStartSpace) {
+  SensorFusionEkf ekf;
+  ProcessStillGyroscopeSamples(
+      &ekf, [](int) { return Vector3(0, 0, 9.81); }, 1, 20);
+  ASSERT_TRUE(IsAlignedWithGravity(ekf));
+  for (int i = 21; i <= 40; ++i) {
+    GyroscopeData gyroscope_sample = {};
+    gyroscope_sample.system_timestamp = i * 2500000;
+    gyroscope_sample.sensor_timestamp_ns = i * 2500000;
+    gyroscope_sample.data = Vector3(0, 0, 1);
+    ekf.ProcessGyroscopeSample(gyroscope_sample);
+  }
+
+  // Halfway between two gyroscope samples.
+  const int64_t timestamp = 30 * 2500000 + 1250000;
+  RotationState state;
+  ASSERT_TRUE(ekf.GetPastRotationState(timestamp, &state));
+  RotationState before;
+  RotationState after;
+  ASSERT_TRUE(ekf.GetPastRotationState(30 * 2500000, &before));
+  ASSERT_TRUE(ekf.GetPastRotationState(31 * 2500000, &after));
+  EXPECT_LT(Length(ToRotationVector(
+                -Rotation::Slerp(before.sensor_from_start_rotation,
+                                 after.sensor_from_start_rotation, 0.5) *
+                state.sensor_from_start_rotation)),
+            1e-12);
+  EXPECT_GT(Length(ToRotationVector(-before.sensor_from_start_rotation *
+                                    after.sensor_from_start_rotation)),
+            2e-3);
+
+  ekf.RecenterYaw();
+  ekf.ApplyPendingStartSpaceRotation();
+  EXPECT_FALSE(ekf.GetPastRotationState(timestamp, &state));
+}
+
+TEST_F(SensorFusionEkfTest, ConstantAccelerationPredictionAnticipatesTurn) {
+  constexpr double kAcceleration = 10;
+  constexpr int64_t kHorizonNs = 32000000;
+  constexpr double kHorizonS = 0.032;
+  SensorFusionEkf ekf;
+  const double velocity = StartYawTurn(&ekf, kAcceleration);
+  const double expected_angle =
+      velocity * kHorizonS + 0.5 * kAcceleration * kHorizonS * kHorizonS;
+
+  const double constant_velocity_error =
+      std::abs(GetPredictedAngle(ekf, kHorizonNs) - expected_angle);
+  ekf.SetRotationPredictionModel(kRotationPredictionConstantAcceleration);
+  const double constant_acceleration_error =
+      std::abs(GetPredictedAngle(ekf, kHorizonNs) - expected_angle);
+  EXPECT_NEAR(constant_velocity_error,
+              0.5 * kAcceleration * kHorizonS * kHorizonS, 1e-4);
+  // The damping of the acceleration keeps part of the error.
+  EXPECT_LT(constant_acceleration_error, 0.25 * constant_velocity_error);
+}
+
+TEST_F(SensorFusionEkfTest, ZeroVelocityStopsAccelerationPrediction) {
+  SensorFusionEkf ekf;
+  ekf.SetRotationPredictionModel(kRotationPredictionConstantAcceleration);
+  StartYawTurn(&ekf, 10);
+  ASSERT_GT(GetPredictedAngle(ekf, 100000000), 0.1);
+
+  // Zero velocity event, e.g. while the sensors are paused.
+  GyroscopeData gyroscope_sample = {};
+  gyroscope_sample.system_timestamp = 101 * 2500000;
+  gyroscope_sample.sensor_timestamp_ns = 101 * 2500000;
+  ekf.ProcessGyroscopeSample(gyroscope_sample);
+  EXPECT_LT(GetPredictedAngle(ekf, 100000000), 1e-6);
+}
+
+TEST_F(SensorFusionEkfTest, RotationUncertaintyIsPiUntilAlignedWithGravity) {
+  SensorFusionEkf ekf;
+  ProcessStillGyroscopeSamples(
+      &ekf, [](int) { return Vector3(0, 0, 9.81); }, 1, 5);
+  ASSERT_FALSE(IsAlignedWithGravity(ekf));
+  const RotationState state = ekf.GetLatestRotationState();
+  EXPECT_DOUBLE_EQ(ekf.GetRotationUncertainty(state, state.timestamp), M_PI);
+}
+
+TEST_F(SensorFusionEkfTest, RotationUncertaintyGrowsWithPredictionHorizon) {
+  SensorFusionEkf ekf;
+  ProcessStillGyroscopeSamples(
+      &ekf, [](int) { return Vector3(0, 0, 9.81); }, 1, 400);
+  ASSERT_TRUE(IsAlignedWithGravity(ekf));
+  const RotationState state = ekf.GetLatestRotationState();
+  const double uncertainty = ekf.GetRotationUncertainty(state, state.timestamp);
+  ASSERT_GT(uncertainty, 0);
+  ASSERT_LT(uncertainty, M_PI);
+
+  // The variance grows quadratically with the prediction horizon.
+  const auto get_variance_growth = [&ekf, &state,
+                                    uncertainty](int64_t horizon_ns) {
+    const double horizon_uncertainty =
+        ekf.GetRotationUncertainty(state, state.timestamp + horizon_ns);
+    return (horizon_uncertainty * horizon_uncertainty -
+            uncertainty * uncertainty) /
+           9;
+  };
+  const double variance_growth_50ms = get_variance_growth(50000000);
+  EXPECT_GT(variance_growth_50ms, 0);
+  EXPECT_NEAR(get_variance_growth(100000000), 4 * variance_growth_50ms,
+              1e-9);
+}
+
+TEST_F(SensorFusionEkfTest, RotationUncertaintyShrinksWithCorrections) {
+  SensorFusionEkf ekf;
+  ProcessStillGyroscopeSamples(
+      &ekf, [](int) { return Vector3(0, 0, 9.81); }, 1, 20);
+  ASSERT_TRUE(IsAlignedWithGravity(ekf));
+  const RotationState aligned_state = ekf.GetLatestRotationState();
+  const double aligned_uncertainty =
+      ekf.GetRotationUncertainty(aligned_state, aligned_state.timestamp);
+  EXPECT_LT(aligned_uncertainty, M_PI);
+
+  ProcessStillGyroscopeSamples(
+      &ekf, [](int) { return Vector3(0, 0, 9.81); }, 21, 400);
+  const RotationState state = ekf.GetLatestRotationState();
+  EXPECT_LT(ekf.GetRotationUncertainty(state, state.timestamp),
+            aligned_uncertainty);
+}
+
+}  // namespace cardboard
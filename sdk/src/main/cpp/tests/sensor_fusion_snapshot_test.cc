@@ -0,0 +1,152 @@
+/*
+ * Copyright 2019 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "sensors/sensor_fusion_snapshot.h"
+
+#include <array>
+#include <cstring>
+#include <limits>
+
+#include "gtest/gtest.h"
+
+namespace cardboard {
+namespace {
+
+typedef std::array<uint8_t, kSerializedSensorFusionSnapshotSize> Buffer;
+
+SensorFusionSnapshot CreateSnapshot() {
+  SensorFusionSnapshot snapshot;
+  snapshot.gyroscope_bias = Vector3(0.01, -0.02, 0.005);
+  snapshot.has_gyroscope_bias = true;
+  snapshot.gyroscope_bias_covariance = SymmetricMatrix3x3::Identity() * 1e-6;
+  snapshot.gyroscope_bias_covariance(0, 1) = 2e-7;
+  snapshot.gyroscope_timestep_s = 0.0025;
+  snapshot.has_gyroscope_timestep = true;
+  return snapshot;
+}
+
+Buffer Serialize(const SensorFusionSnapshot& snapshot) {
+  Buffer buffer;
+  SerializeSensorFusionSnapshot(snapshot, buffer.data());
+  return buffer;
+}
+
+// Writes a little-endian 32-bit value at @p offset.
+void WriteUint32(Buffer* buffer, size_t offset, uint32_t value) {
+  for (int i = 0; i < 4; ++i) {
+    (*buffer)[offset + i] = static_cast<uint8_t>(value >> (8 * i));
+  }
+}
+
+// Writes a single precision value at @p offset.
+void WriteFloat(Buffer* buffer, size_t offset, float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  WriteUint32(buffer, offset, bits);
+}
+
+// Updates the FNV-1a checksum stored in the last 4 bytes after a field was
+// modified, so that only the validation of the field is tested.
+void UpdateChecksum(Buffer* buffer) {
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < buffer->size() - 4; ++i) {
+    hash = (hash ^ (*buffer)[i]) * 16777619u;
+  }
+  WriteUint32(buffer, buffer->size() - 4, hash);
+}
+
+bool Deserialize(const Buffer& buffer) {
+  SensorFusionSnapshot snapshot;
+  return DeserializeSensorFusionSnapshot(buffer.data(), buffer.size(),
+                                         &snapshot);
+}
+
+TEST(SensorFusionSnapshotTest, SerializesVersion1Layout) {
+  const Buffer buffer = Serialize(CreateSnapshot());
+  EXPECT_EQ(buffer.size(), 56u);
+  // Magic "CBFS" followed by version 1, both little-endian.
+  EXPECT_EQ(std::memcmp(buffer.data(), "CBFS", 4), 0);
+  EXPECT_EQ(buffer[4], 1);
+  EXPECT_EQ(buffer[5], 0);
+  EXPECT_EQ(buffer[6], 0);
+  EXPECT_EQ(buffer[7], 0);
+  // Both flags are set.
+  EXPECT_EQ(buffer[8], 3);
+}
+
+TEST(SensorFusionSnapshotTest, RoundTripsInSinglePrecision) {
+  const SensorFusionSnapshot snapshot = CreateSnapshot();
+  const Buffer buffer = Serialize(snapshot);
+
+  SensorFusionSnapshot result;
+  ASSERT_TRUE(
+      DeserializeSensorFusionSnapshot(buffer.data(), buffer.size(), &result));
+  EXPECT_TRUE(result.has_gyroscope_bias);
+  EXPECT_TRUE(result.has_gyroscope_timestep);
+  EXPECT_FLOAT_EQ(result.gyroscope_timestep_s, 0.0025);
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_FLOAT_EQ(result.gyroscope_bias[i], snapshot.gyroscope_bias[i]);
+    for (int j = 0; j < 3; ++j) {
+      EXPECT_FLOAT_EQ(result.gyroscope_bias_covariance(i, j),
+                      snapshot.gyroscope_bias_covariance(i, j));
+    }
+  }
+}
+
+TEST(SensorFusionSnapshotTest, RejectsTruncatedSnapshot) {
+  const Buffer buffer = Serialize(CreateSnapshot());
+  SensorFusionSnapshot snapshot;
+  EXPECT_FALSE(DeserializeSensorFusionSnapshot(buffer.data(),
+                                               buffer.size() - 1, &snapshot));
+  EXPECT_FALSE(DeserializeSensorFusionSnapshot(buffer.data(), 0, &snapshot));
+}
+
+TEST(SensorFusionSnapshotTest, RejectsCorruptedSnapshot) {
+  for (size_t i = 0; i < kSerializedSensorFusionSnapshotSize; ++i) {
+    Buffer buffer = Serialize(CreateSnapshot());
+    buffer[i] ^= 0x10;
+    EXPECT_FALSE(Deserialize(buffer)) << "byte " << i;
+  }
+}
+
+TEST(SensorFusionSnapshotTest, RejectsOtherVersion) {
+  Buffer buffer = Serialize(CreateSnapshot());
+  WriteUint32(&buffer, 4, 2);
+  UpdateChecksum(&buffer);
+  EXPECT_FALSE(Deserialize(buffer));
+}
+
+TEST(SensorFusionSnapshotTest, RejectsValuesOutOfRange) {
+  // Gyroscope timestep.
+  Buffer buffer = Serialize(CreateSnapshot());
+  WriteFloat(&buffer, 12, 2.0f);
+  UpdateChecksum(&buffer);
+  EXPECT_FALSE(Deserialize(buffer));
+
+  // Gyroscope bias.
+  buffer = Serialize(CreateSnapshot());
+  WriteFloat(&buffer, 16, std::numeric_limits<float>::quiet_NaN());
+  UpdateChecksum(&buffer);
+  EXPECT_FALSE(Deserialize(buffer));
+
+  // Diagonal of the gyroscope bias covariance.
+  buffer = Serialize(CreateSnapshot());
+  WriteFloat(&buffer, 28, 0.0f);
+  UpdateChecksum(&buffer);
+  EXPECT_FALSE(Deserialize(buffer));
+}
+
+}  // namespace
+}  // namespace cardboard
@@ -0,0 +1,150 @@
+/*
+ * Copyright 2019 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "sensors/sensor_reorder_buffer.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace cardboard {
+namespace {
+
+constexpr int64_t kLatencyBudgetNs = 10000000;
+
+AccelerometerData Accel(uint64_t timestamp_ns) {
+  AccelerometerData sample = {};
+  sample.sensor_timestamp_ns = timestamp_ns;
+  return sample;
+}
+
+GyroscopeData Gyro(uint64_t timestamp_ns) {
+  GyroscopeData sample = {};
+  sample.sensor_timestamp_ns = timestamp_ns;
+  return sample;
+}
+
+// Released sample, negative timestamps standing for accelerometer samples.
+class ReleasedSamples {
+ public:
+  void Release(SensorReorderBuffer* buffer, bool release_all = false) {
+    const auto on_accel = [this](const AccelerometerData* samples,
+                                 size_t num_samples) {
+      for (size_t i = 0; i < num_samples; ++i) {
+        timestamps_.push_back(-static_cast<int64_t>(
+            samples[i].sensor_timestamp_ns));
+      }
+    };
+    const auto on_gyro = [this](const GyroscopeData* samples,
+                                size_t num_samples) {
+      for (size_t i = 0; i < num_samples; ++i) {
+        timestamps_.push_back(
+            static_cast<int64_t>(samples[i].sensor_timestamp_ns));
+      }
+    };
+    if (release_all) {
+      buffer->ReleaseAllSamples(on_accel, on_gyro);
+    } else {
+      buffer->ReleaseSamples(on_accel, on_gyro);
+    }
+  }
+
+  const std::vector<int64_t>& timestamps() const { return timestamps_; }
+
+ private:
+  std::vector<int64_t> timestamps_;
+};
+
+TEST(SensorReorderBufferTest, MergesStreamsByTimestamp) {
+  SensorReorderBuffer buffer(kLatencyBudgetNs);
+  const GyroscopeData gyro[] = {Gyro(1000), Gyro(3000)};
+  const AccelerometerData accel[] = {Accel(2000), Accel(3000), Accel(4000)};
+  buffer.AddGyroscopeSamples(gyro, 2);
+  buffer.AddAccelerometerSamples(accel, 3);
+
+  ReleasedSamples released;
+  released.Release(&buffer);
+  // Everything up to the newest gyroscope sample can be released, the
+  // accelerometer sample going first on equal timestamps.
+  EXPECT_EQ(released.timestamps(),
+            (std::vector<int64_t>{1000, -2000, -3000, 3000}));
+
+  released.Release(&buffer, true);
+  EXPECT_EQ(released.timestamps().back(), -4000);
+  // Interleaving the two streams is not reordering.
+  EXPECT_EQ(buffer.GetStatistics().num_reordered_samples, 0u);
+}
+
+TEST(SensorReorderBufferTest, PutsLateSampleBackInOrder) {
+  SensorReorderBuffer buffer(kLatencyBudgetNs);
+  const GyroscopeData gyro[] = {Gyro(1000), Gyro(3000), Gyro(2000)};
+  buffer.AddGyroscopeSamples(gyro, 3);
+
+  ReleasedSamples released;
+  released.Release(&buffer, true);
+  EXPECT_EQ(released.timestamps(), (std::vector<int64_t>{1000, 2000, 3000}));
+  EXPECT_EQ(buffer.GetStatistics().num_reordered_samples, 1u);
+  EXPECT_EQ(buffer.GetStatistics().num_dropped_samples, 0u);
+}
+
+TEST(SensorReorderBufferTest, HoldsStalledStreamForLatencyBudget) {
+  SensorReorderBuffer buffer(kLatencyBudgetNs);
+  const AccelerometerData accel[] = {Accel(1000)};
+  buffer.AddAccelerometerSamples(accel, 1);
+
+  ReleasedSamples released;
+  released.Release(&buffer);
+  EXPECT_TRUE(released.timestamps().empty());
+
+  const GyroscopeData gyro[] = {Gyro(1000 + kLatencyBudgetNs)};
+  buffer.AddGyroscopeSamples(gyro, 1);
+  released.Release(&buffer);
+  // The accelerometer sample is released once it is older than the budget.
+  EXPECT_EQ(released.timestamps(), (std::vector<int64_t>{-1000}));
+}
+
+TEST(SensorReorderBufferTest, DropsSampleOlderThanReleasedOnes) {
+  SensorReorderBuffer buffer(kLatencyBudgetNs);
+  const GyroscopeData gyro[] = {Gyro(5000)};
+  buffer.AddGyroscopeSamples(gyro, 1);
+  ReleasedSamples released;
+  released.Release(&buffer, true);
+
+  const AccelerometerData late_accel[] = {Accel(4000)};
+  buffer.AddAccelerometerSamples(late_accel, 1);
+  released.Release(&buffer, true);
+  EXPECT_EQ(released.timestamps(), (std::vector<int64_t>{5000}));
+  EXPECT_EQ(buffer.GetStatistics().num_dropped_samples, 1u);
+}
+
+TEST(SensorReorderBufferTest, AcceptsRestartedClockAfterReset) {
+  SensorReorderBuffer buffer(kLatencyBudgetNs);
+  const GyroscopeData gyro[] = {Gyro(5000000000)};
+  buffer.AddGyroscopeSamples(gyro, 1);
+  ReleasedSamples released;
+  released.Release(&buffer, true);
+
+  buffer.Reset();
+  const GyroscopeData restarted_gyro[] = {Gyro(1000), Gyro(2000)};
+  buffer.AddGyroscopeSamples(restarted_gyro, 2);
+  released.Release(&buffer, true);
+  EXPECT_EQ(released.timestamps(),
+            (std::vector<int64_t>{5000000000, 1000, 2000}));
+  EXPECT_EQ(buffer.GetStatistics().num_dropped_samples, 0u);
+}
+
+}  // namespace
+}  // namespace cardboard
@@ -0,0 +1,94 @@
+/*
+ * Copyright 2019 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "util/spsc_ring_buffer.h"
+
+#include <cstdint>
+#include <thread>  // NOLINT
+
+#include "gtest/gtest.h"
+
+namespace cardboard {
+namespace {
+
+TEST(SpscRingBufferTest, PopsInPushOrder) {
+  SpscRingBuffer<int, 8> queue;
+  const int items[] = {1, 2, 3};
+  EXPECT_EQ(queue.Push(items, 3), 3u);
+
+  int popped[8];
+  ASSERT_EQ(queue.Pop(popped, 8), 3u);
+  EXPECT_EQ(popped[0], 1);
+  EXPECT_EQ(popped[1], 2);
+  EXPECT_EQ(popped[2], 3);
+  EXPECT_EQ(queue.Pop(popped, 8), 0u);
+}
+
+TEST(SpscRingBufferTest, DropsNewestItemsWhenFull) {
+  SpscRingBuffer<int, 4> queue;
+  const int items[] = {1, 2, 3, 4, 5, 6};
+  EXPECT_EQ(queue.Push(items, 6), 4u);
+  EXPECT_EQ(queue.GetDroppedCount(), 2u);
+
+  int popped[4];
+  ASSERT_EQ(queue.Pop(popped, 4), 4u);
+  EXPECT_EQ(popped[0], 1);
+  EXPECT_EQ(popped[3], 4);
+}
+
+TEST(SpscRingBufferTest, WrapsAround) {
+  SpscRingBuffer<int, 4> queue;
+  int popped[3];
+  for (int i = 0; i < 10; ++i) {
+    const int items[] = {3 * i, 3 * i + 1, 3 * i + 2};
+    ASSERT_EQ(queue.Push(items, 3), 3u);
+    ASSERT_EQ(queue.Pop(popped, 3), 3u);
+    EXPECT_EQ(popped[0], 3 * i);
+    EXPECT_EQ(popped[2], 3 * i + 2);
+  }
+  EXPECT_EQ(queue.GetDroppedCount(), 0u);
+}
+
+TEST(SpscRingBufferTest, ConsumerThreadSeesItemsInOrder) {
+  constexpr uint64_t kNumItems = 20000;
+  SpscRingBuffer<uint64_t, 64> queue;
+
+  std::thread producer([&queue]() {
+    uint64_t next_item = 0;
+    while (next_item < kNumItems) {
+      if (queue.Push(&next_item, 1) == 0) {
+        std::this_thread::yield();
+      } else {
+        ++next_item;
+      }
+    }
+  });
+
+  uint64_t expected_item = 0;
+  uint64_t popped[16];
+  while (expected_item < kNumItems) {
+    const size_t num_popped = queue.Pop(popped, 16);
+    if (num_popped == 0) {
+      std::this_thread::yield();
+    }
+    for (size_t i = 0; i < num_popped; ++i) {
+      ASSERT_EQ(popped[i], expected_item++);
+    }
+  }
+  producer.join();
+}
+
+}  // namespace
+}  // namespace cardboard
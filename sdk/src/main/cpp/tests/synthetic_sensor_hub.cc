@@ -0,0 +1,128 @@
+/*
+ * Copyright 2019 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "tests/synthetic_sensor_hub.h"
+
+#include <time.h>
+
+#include <mutex>  // NOLINT
+
+#include "sensors/sensor_hub.h"
+
+namespace cardboard {
+
+namespace {
+
+// Guards the fields below. It is held while the callbacks run, so that a hub
+// cannot stop polling in the middle of a delivery.
+std::mutex& CurrentHubMutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+
+// SensorHub receiving the synthetic samples and its callbacks.
+const SensorHub* current_hub = nullptr;
+const SensorHub::AccelerometerCallback* current_accel_callback = nullptr;
+const SensorHub::GyroscopeCallback* current_gyro_callback = nullptr;
+LatencyHistogram* current_delivery_latency_histogram = nullptr;
+
+template <typename DataType, typename Callback>
+bool Emit(const Callback* callback, const DataType* events,
+          size_t num_events) {
+  if (current_hub == nullptr) {
+    return false;
+  }
+  const int64_t read_timestamp_ns = testing::GetBootTimeNanos();
+  for (size_t i = 0; i < num_events; ++i) {
+    current_delivery_latency_histogram->Record(
+        read_timestamp_ns - static_cast<int64_t>(events[i].system_timestamp));
+  }
+  if (callback != nullptr && *callback) {
+    (*callback)(events, num_events);
+  }
+  return true;
+}
+
+}  // namespace
+
+// The synthetic hub has no state of its own.
+struct SensorHub::EventProducer {};
+
+SensorHub::SensorHub()
+    : event_producer_(new EventProducer()),
+      on_accel_callback_(nullptr),
+      on_gyro_callback_(nullptr) {}
+
+SensorHub::~SensorHub() { StopSensorPolling(); }
+
+void SensorHub::StartSensorPolling(
+    const AccelerometerCallback* on_accel_callback,
+    const GyroscopeCallback* on_gyro_callback) {
+  std::unique_lock<std::mutex> lock(CurrentHubMutex());
+  on_accel_callback_ = on_accel_callback;
+  on_gyro_callback_ = on_gyro_callback;
+  current_hub = this;
+  current_accel_callback = on_accel_callback;
+  current_gyro_callback = on_gyro_callback;
+  current_delivery_latency_histogram = &delivery_latency_histogram_;
+}
+
+void SensorHub::StopSensorPolling() {
+  std::unique_lock<std::mutex> lock(CurrentHubMutex());
+  on_accel_callback_ = nullptr;
+  on_gyro_callback_ = nullptr;
+  if (current_hub == this) {
+    current_hub = nullptr;
+    current_accel_callback = nullptr;
+    current_gyro_callback = nullptr;
+    current_delivery_latency_histogram = nullptr;
+  }
+}
+
+// Synthetic samples are emitted at the rate chosen by the tests.
+void SensorHub::SetSamplingConfig(const SensorSamplingConfig& /*config*/) {}
+
+// Samples are emitted on the threads of the tests.
+void SensorHub::SetThreadPolicy(const ThreadPolicy& /*policy*/) {}
+
+ClockOffsetEstimate SensorHub::GetClockOffsetEstimate() const {
+  return clock_offset_estimator_.GetEstimate();
+}
+
+LatencyHistogram::Snapshot SensorHub::GetDeliveryLatencyHistogram() const {
+  return delivery_latency_histogram_.GetSnapshot();
+}
+
+namespace testing {
+
+bool EmitAccelerometerSamples(const AccelerometerData* events,
+                              size_t num_events) {
+  std::unique_lock<std::mutex> lock(CurrentHubMutex());
+  return Emit(current_accel_callback, events, num_events);
+}
+
+bool EmitGyroscopeSamples(const GyroscopeData* events, size_t num_events) {
+  std::unique_lock<std::mutex> lock(CurrentHubMutex());
+  return Emit(current_gyro_callback, events, num_events);
+}
+
+int64_t GetBootTimeNanos() {
+  struct timespec res;
+  clock_gettime(CLOCK_BOOTTIME, &res);
+  return static_cast<int64_t>(res.tv_sec) * 1000000000 + res.tv_nsec;
+}
+
+}  // namespace testing
+}  // namespace cardboard
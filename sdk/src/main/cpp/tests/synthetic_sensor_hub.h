@@ -0,0 +1,46 @@
+/*
+ * Copyright 2019 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef CARDBOARD_SDK_TESTS_SYNTHETIC_SENSOR_HUB_H_
+#define CARDBOARD_SDK_TESTS_SYNTHETIC_SENSOR_HUB_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "sensors/accelerometer_data.h"
+#include "sensors/gyroscope_data.h"
+
+namespace cardboard {
+namespace testing {
+
+// The host tests link a synthetic SensorHub instead of the device one. It has
+// no capture thread: the samples below are delivered synchronously on the
+// calling thread to the callbacks of the SensorHub that most recently started
+// polling. As with the device hub, no callback runs once StopSensorPolling()
+// has returned. The delivery latency of each sample is recorded from its
+// system_timestamp, taken as CLOCK_BOOTTIME.
+//
+// @return true if the samples were delivered, false while polling is stopped.
+bool EmitAccelerometerSamples(const AccelerometerData* events,
+                              size_t num_events);
+bool EmitGyroscopeSamples(const GyroscopeData* events, size_t num_events);
+
+// Gets the current CLOCK_BOOTTIME time in nanoseconds.
+int64_t GetBootTimeNanos();
+
+}  // namespace testing
+}  // namespace cardboard
+
+#endif  // CARDBOARD_SDK_TESTS_SYNTHETIC_SENSOR_HUB_H_
@@ -0,0 +1,69 @@
+/*
+ * Copyright 2019 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "util/thread_policy.h"
+
+#include <errno.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <thread>  // NOLINT
+
+#include "gtest/gtest.h"
+
+namespace cardboard {
+namespace {
+
+int GetNiceValue() {
+  return getpriority(PRIO_PROCESS, static_cast<pid_t>(syscall(SYS_gettid)));
+}
+
+cpu_set_t GetCpuAffinity() {
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  sched_getaffinity(static_cast<pid_t>(syscall(SYS_gettid)), sizeof(cpu_set),
+                    &cpu_set);
+  return cpu_set;
+}
+
+// Each test runs on a new thread, so that the policies do not leak into the
+// other tests.
+TEST(ThreadPolicyTest, AppliesAndRestoresNiceValueAndAffinity) {
+  std::thread([]() {
+    const int original_nice_value = GetNiceValue();
+    const cpu_set_t original_cpu_affinity = GetCpuAffinity();
+
+    // Raising the nice value is always permitted.
+    const ThreadPolicy policy = {true, original_nice_value + 1, false, 0, 1};
+    EXPECT_TRUE(ApplyThreadPolicy(policy));
+    EXPECT_EQ(GetNiceValue(), original_nice_value + 1);
+    cpu_set_t cpu_affinity = GetCpuAffinity();
+    EXPECT_EQ(CPU_COUNT(&cpu_affinity), 1);
+    EXPECT_TRUE(CPU_ISSET(0, &cpu_affinity));
+
+    // Lowering the nice value back may need privileges, the affinity is always
+    // restored.
+    if (ApplyThreadPolicy(kDefaultThreadPolicy)) {
+      EXPECT_EQ(GetNiceValue(), original_nice_value);
+    }
+    cpu_affinity = GetCpuAffinity();
+    EXPECT_TRUE(CPU_EQUAL(&cpu_affinity, &original_cpu_affinity));
+  }).join();
+}
+
+}  // namespace
+}  // namespace cardboard
@@ -0,0 +1,85 @@
+/*
+ * Copyright 2019 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "util/triple_buffer.h"
+
+#include <atomic>
+#include <cstdint>
+#include <thread>  // NOLINT
+
+#include "gtest/gtest.h"
+
+namespace cardboard {
+namespace {
+
+// Value with two fields, so that a torn read can be told apart.
+struct Value {
+  uint64_t first;
+  uint64_t second;
+};
+
+TEST(TripleBufferTest, ReadsDefaultValueBeforeAnyWrite) {
+  TripleBuffer<int> buffer;
+  EXPECT_EQ(buffer.Read(), 0);
+}
+
+TEST(TripleBufferTest, ReadsLatestWrite) {
+  TripleBuffer<int> buffer;
+  buffer.Write(1);
+  buffer.Write(2);
+  EXPECT_EQ(buffer.Read(), 2);
+  // Without a new write, the same value is read again.
+  EXPECT_EQ(buffer.Read(), 2);
+  buffer.Write(3);
+  EXPECT_EQ(buffer.Read(), 3);
+}
+
+TEST(TripleBufferTest, ConcurrentReadsAreNeitherTornNorOlder) {
+  constexpr uint64_t kNumWrites = 200000;
+  TripleBuffer<Value> buffer;
+  std::atomic<bool> is_done(false);
+
+  std::thread writer([&buffer, &is_done]() {
+    for (uint64_t i = 1; i <= kNumWrites; ++i) {
+      buffer.Write({i, ~i});
+    }
+    is_done = true;
+  });
+
+  uint64_t previous = 0;
+  while (!is_done) {
+    std::this_thread::yield();
+    const Value value = buffer.Read();
+    if (value.first != 0) {
+      ASSERT_EQ(value.second, ~value.first);
+    }
+    ASSERT_GE(value.first, previous);
+    previous = value.first;
+  }
+  writer.join();
+  EXPECT_EQ(buffer.Read().first, kNumWrites);
+}
+
+#ifndef NDEBUG
+TEST(TripleBufferDeathTest, ReadFromSecondThreadAsserts) {
+  TripleBuffer<int> buffer;
+  buffer.Read();
+  EXPECT_DEATH(std::thread([&buffer]() { buffer.Read(); }).join(),
+               "second thread");
+}
+#endif
+
+}  // namespace
+}  // namespace cardboard
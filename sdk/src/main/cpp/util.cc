@@ -110,5 +110,11 @@ int64_t GetBootTimeNano() {
   return (res.tv_sec * kNanosInSeconds) + res.tv_nsec;
 }
 
+int64_t GetMonotonicTimeNano() {
+  struct timespec res;
+  clock_gettime(CLOCK_MONOTONIC, &res);
+  return (res.tv_sec * kNanosInSeconds) + res.tv_nsec;
+}
+
 
 }  // namespace ndk_header_tracker
@@ -72,6 +72,14 @@ Matrix4x4 GetTranslationMatrix(const std::array<float, 3>& translation);
  * @return System boot time in nanoseconds
  */
 int64_t GetBootTimeNano();
+
+/**
+ * Gets monotonic time in nanoseconds, i.e. the clock of System.nanoTime() and
+ * of the Choreographer frame times.
+ *
+ * @return Monotonic time in nanoseconds
+ */
+int64_t GetMonotonicTimeNano();
 }  // namespace ndk_header_tracker
 
 #endif  // HELLO_CARDBOARD_ANDROID_SRC_MAIN_JNI_UTIL_H_
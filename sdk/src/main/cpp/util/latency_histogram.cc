@@ -0,0 +1,76 @@
+/*
+ * Copyright 2019 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "latency_histogram.h"
+
+namespace cardboard {
+
+namespace {
+
+constexpr int64_t kNanosInMicros = 1000;
+
+}  // namespace
+
+LatencyHistogram::LatencyHistogram() { Reset(); }
+
+void LatencyHistogram::Record(int64_t latency_ns) {
+  uint64_t latency_us =
+      latency_ns > 0 ? static_cast<uint64_t>(latency_ns / kNanosInMicros) : 0;
+  size_t bucket = 0;
+  while (latency_us > 0 && bucket < kNumBuckets - 1) {
+    latency_us >>= 1;
+    ++bucket;
+  }
+  // Only this thread writes, so a relaxed load and store is enough.
+  counts_[bucket].store(counts_[bucket].load(std::memory_order_relaxed) + 1,
+                        std::memory_order_relaxed);
+}
+
+void LatencyHistogram::Reset() {
+  for (std::atomic<uint64_t>& count : counts_) {
+    count.store(0, std::memory_order_relaxed);
+  }
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::GetSnapshot() const {
+  Snapshot snapshot;
+  snapshot.num_samples = 0;
+  for (size_t i = 0; i < kNumBuckets; ++i) {
+    snapshot.counts[i] = counts_[i].load(std::memory_order_relaxed);
+    snapshot.num_samples += snapshot.counts[i];
+  }
+  return snapshot;
+}
+
+int64_t LatencyHistogram::GetBucketUpperBoundNs(size_t bucket) {
+  return (int64_t{1} << bucket) * kNanosInMicros;
+}
+
+int64_t LatencyHistogram::Snapshot::GetPercentileNs(double percentile) const {
+  if (num_samples == 0) {
+    return 0;
+  }
+  const double rank = percentile / 100.0 * static_cast<double>(num_samples);
+  uint64_t accumulated_count = 0;
+  for (size_t i = 0; i < kNumBuckets; ++i) {
+    accumulated_count += counts[i];
+    if (static_cast<double>(accumulated_count) >= rank) {
+      return GetBucketUpperBoundNs(i);
+    }
+  }
+  return GetBucketUpperBoundNs(kNumBuckets - 1);
+}
+
+}  // namespace cardboard
@@ -0,0 +1,72 @@
+/*
+ * Copyright 2019 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef CARDBOARD_SDK_UTIL_LATENCY_HISTOGRAM_H_
+#define CARDBOARD_SDK_UTIL_LATENCY_HISTOGRAM_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace cardboard {
+
+// Histogram of latencies with logarithmic buckets: bucket 0 counts latencies
+// below 1 us and bucket i > 0 counts latencies in [2^(i-1), 2^i) us. The last
+// bucket also counts every larger latency.
+//
+// Record() must be called from a single thread and is wait-free. Snapshots can
+// be taken from any thread.
+class LatencyHistogram {
+ public:
+  static constexpr size_t kNumBuckets = 24;
+
+  // Copy of the bucket counts.
+  struct Snapshot {
+    std::array<uint64_t, kNumBuckets> counts;
+    uint64_t num_samples;
+
+    // Gets an upper bound of the @p percentile latency in nanoseconds.
+    //
+    // @param percentile value in [0, 100].
+    // @return the upper bound of the bucket holding the percentile, or zero if
+    //     there are no samples.
+    int64_t GetPercentileNs(double percentile) const;
+  };
+
+  LatencyHistogram();
+
+  // Counts one latency.
+  //
+  // @param latency_ns latency in nanoseconds. Negative values are counted as
+  //     zero.
+  void Record(int64_t latency_ns);
+
+  // Clears all counts.
+  void Reset();
+
+  // Gets a copy of the counts.
+  Snapshot GetSnapshot() const;
+
+  // Gets the exclusive upper bound of @p bucket in nanoseconds.
+  static int64_t GetBucketUpperBoundNs(size_t bucket);
+
+ private:
+  std::array<std::atomic<uint64_t>, kNumBuckets> counts_;
+};
+
+}  // namespace cardboard
+
+#endif  // CARDBOARD_SDK_UTIL_LATENCY_HISTOGRAM_H_
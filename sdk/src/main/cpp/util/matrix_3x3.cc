@@ -17,45 +17,52 @@
 
 namespace cardboard {
 
-Matrix3x3::Matrix3x3(double m00, double m01, double m02, double m10, double m11,
-                     double m12, double m20, double m21, double m22)
+template <typename T>
+Matrix3x3T<T>::Matrix3x3T(T m00, T m01, T m02, T m10, T m11, T m12, T m20,
+                          T m21, T m22)
     : elem_{{{m00, m01, m02}, {m10, m11, m12}, {m20, m21, m22}}} {}
 
-Matrix3x3::Matrix3x3() {
+template <typename T>
+Matrix3x3T<T>::Matrix3x3T() {
   for (int row = 0; row < 3; ++row) {
     for (int col = 0; col < 3; ++col) elem_[row][col] = 0;
   }
 }
 
-Matrix3x3 Matrix3x3::Zero() {
-  Matrix3x3 result;
+template <typename T>
+Matrix3x3T<T> Matrix3x3T<T>::Zero() {
+  Matrix3x3T result;
   return result;
 }
 
-Matrix3x3 Matrix3x3::Identity() {
-  Matrix3x3 result;
+template <typename T>
+Matrix3x3T<T> Matrix3x3T<T>::Identity() {
+  Matrix3x3T result;
   for (int row = 0; row < 3; ++row) {
     result.elem_[row][row] = 1;
   }
   return result;
 }
 
-void Matrix3x3::MultiplyScalar(double s) {
+template <typename T>
+void Matrix3x3T<T>::MultiplyScalar(T s) {
   for (int row = 0; row < 3; ++row) {
     for (int col = 0; col < 3; ++col) elem_[row][col] *= s;
   }
 }
 
-Matrix3x3 Matrix3x3::Negation() const {
-  Matrix3x3 result;
+template <typename T>
+Matrix3x3T<T> Matrix3x3T<T>::Negation() const {
+  Matrix3x3T result;
   for (int row = 0; row < 3; ++row) {
     for (int col = 0; col < 3; ++col) result.elem_[row][col] = -elem_[row][col];
   }
   return result;
 }
 
-Matrix3x3 Matrix3x3::Scale(const Matrix3x3& m, double s) {
-  Matrix3x3 result;
+template <typename T>
+Matrix3x3T<T> Matrix3x3T<T>::Scale(const Matrix3x3T& m, T s) {
+  Matrix3x3T result;
   for (int row = 0; row < 3; ++row) {
     for (int col = 0; col < 3; ++col)
       result.elem_[row][col] = m.elem_[row][col] * s;
@@ -63,8 +70,10 @@ Matrix3x3 Matrix3x3::Scale(const Matrix3x3& m, double s) {
   return result;
 }
 
-Matrix3x3 Matrix3x3::Addition(const Matrix3x3& lhs, const Matrix3x3& rhs) {
-  Matrix3x3 result;
+template <typename T>
+Matrix3x3T<T> Matrix3x3T<T>::Addition(const Matrix3x3T& lhs,
+                                      const Matrix3x3T& rhs) {
+  Matrix3x3T result;
   for (int row = 0; row < 3; ++row) {
     for (int col = 0; col < 3; ++col)
       result.elem_[row][col] = lhs.elem_[row][col] + rhs.elem_[row][col];
@@ -72,8 +81,10 @@ Matrix3x3 Matrix3x3::Addition(const Matrix3x3& lhs, const Matrix3x3& rhs) {
   return result;
 }
 
-Matrix3x3 Matrix3x3::Subtraction(const Matrix3x3& lhs, const Matrix3x3& rhs) {
-  Matrix3x3 result;
+template <typename T>
+Matrix3x3T<T> Matrix3x3T<T>::Subtraction(const Matrix3x3T& lhs,
+                                      const Matrix3x3T& rhs) {
+  Matrix3x3T result;
   for (int row = 0; row < 3; ++row) {
     for (int col = 0; col < 3; ++col)
       result.elem_[row][col] = lhs.elem_[row][col] - rhs.elem_[row][col];
@@ -81,8 +92,10 @@ Matrix3x3 Matrix3x3::Subtraction(const Matrix3x3& lhs, const Matrix3x3& rhs) {
   return result;
 }
 
-Matrix3x3 Matrix3x3::Product(const Matrix3x3& m0, const Matrix3x3& m1) {
-  Matrix3x3 result;
+template <typename T>
+Matrix3x3T<T> Matrix3x3T<T>::Product(const Matrix3x3T& m0,
+                                      const Matrix3x3T& m1) {
+  Matrix3x3T result;
   for (int row = 0; row < 3; ++row) {
     for (int col = 0; col < 3; ++col) {
       result.elem_[row][col] = 0;
@@ -93,7 +106,8 @@ Matrix3x3 Matrix3x3::Product(const Matrix3x3& m0, const Matrix3x3& m1) {
   return result;
 }
 
-bool Matrix3x3::AreEqual(const Matrix3x3& m0, const Matrix3x3& m1) {
+template <typename T>
+bool Matrix3x3T<T>::AreEqual(const Matrix3x3T& m0, const Matrix3x3T& m1) {
   for (int row = 0; row < 3; ++row) {
     for (int col = 0; col < 3; ++col) {
       if (m0.elem_[row][col] != m1.elem_[row][col]) return false;
@@ -102,4 +116,7 @@ bool Matrix3x3::AreEqual(const Matrix3x3& m0, const Matrix3x3& m1) {
   return true;
 }
 
+template class Matrix3x3T<float>;
+template class Matrix3x3T<double>;
+
 }  // namespace cardboard
@@ -27,20 +27,23 @@ static bool IsCofactorNegated(int row, int col) {
   return ((row + col) & 1) != 0;
 }
 
-static double CofactorElement3(const Matrix3x3& m, int row, int col) {
+template <typename T>
+T CofactorElement3(const Matrix3x3T<T>& m, int row, int col) {
   static const int index[3][2] = {{1, 2}, {0, 2}, {0, 1}};
   const int i0 = index[row][0];
   const int i1 = index[row][1];
   const int j0 = index[col][0];
   const int j1 = index[col][1];
-  const double cofactor = m(i0, j0) * m(i1, j1) - m(i0, j1) * m(i1, j0);
+  const T cofactor = m(i0, j0) * m(i1, j1) - m(i0, j1) * m(i1, j0);
   return IsCofactorNegated(row, col) ? -cofactor : cofactor;
 }
 
 // Multiplies a matrix and some type of column vector to
 // produce another column vector of the same type.
-Vector3 MultiplyMatrixAndVector(const Matrix3x3& m, const Vector3& v) {
-  Vector3 result = Vector3::Zero();
+template <typename T>
+Vector<3, T> MultiplyMatrixAndVector(const Matrix3x3T<T>& m,
+                                     const Vector<3, T>& v) {
+  Vector<3, T> result = Vector<3, T>::Zero();
   for (int row = 0; row < 3; ++row) {
     for (int col = 0; col < 3; ++col) result[row] += m(row, col) * v[col];
   }
@@ -48,7 +51,8 @@ Vector3 MultiplyMatrixAndVector(const Matrix3x3& m, const Vector3& v) {
 }
 
 // Sets the upper 3x3 of a Matrix to represent a 3D rotation.
-void RotationMatrix3x3(const Rotation& r, Matrix3x3* matrix) {
+template <typename T>
+void RotationMatrix3x3(const RotationT<T>& r, Matrix3x3T<T>* matrix) {
   //
   // Given a quaternion (a,b,c,d) where d is the scalar part, the 3x3 rotation
   // matrix is:
@@ -57,21 +61,21 @@ void RotationMatrix3x3(const Rotation& r, Matrix3x3* matrix) {
   //         2ab + 2cd        -a^2 + b^2 - c^2 + d^2         2bc - 2ad
   //         2ac - 2bd               2bc + 2ad        -a^2 - b^2 + c^2 + d^2
   //
-  const Vector<4>& quat = r.GetQuaternion();
-  const double aa = quat[0] * quat[0];
-  const double bb = quat[1] * quat[1];
-  const double cc = quat[2] * quat[2];
-  const double dd = quat[3] * quat[3];
+  const Vector<4, T>& quat = r.GetQuaternion();
+  const T aa = quat[0] * quat[0];
+  const T bb = quat[1] * quat[1];
+  const T cc = quat[2] * quat[2];
+  const T dd = quat[3] * quat[3];
 
-  const double ab = quat[0] * quat[1];
-  const double ac = quat[0] * quat[2];
-  const double bc = quat[1] * quat[2];
+  const T ab = quat[0] * quat[1];
+  const T ac = quat[0] * quat[2];
+  const T bc = quat[1] * quat[2];
 
-  const double ad = quat[0] * quat[3];
-  const double bd = quat[1] * quat[3];
-  const double cd = quat[2] * quat[3];
+  const T ad = quat[0] * quat[3];
+  const T bd = quat[1] * quat[3];
+  const T cd = quat[2] * quat[3];
 
-  Matrix3x3& m = *matrix;
+  Matrix3x3T<T>& m = *matrix;
   m[0][0] = aa - bb - cc + dd;
   m[0][1] = 2 * ab - 2 * cd;
   m[0][2] = 2 * ac + 2 * bd;
@@ -85,12 +89,14 @@ void RotationMatrix3x3(const Rotation& r, Matrix3x3* matrix) {
 
 }  // anonymous namespace
 
-Vector3 operator*(const Matrix3x3& m, const Vector3& v) {
+template <typename T>
+Vector<3, T> operator*(const Matrix3x3T<T>& m, const Vector<3, T>& v) {
   return MultiplyMatrixAndVector(m, v);
 }
 
-Matrix3x3 CofactorMatrix(const Matrix3x3& m) {
-  Matrix3x3 result;
+template <typename T>
+Matrix3x3T<T> CofactorMatrix(const Matrix3x3T<T>& m) {
+  Matrix3x3T<T> result;
   for (int row = 0; row < 3; ++row) {
     for (int col = 0; col < 3; ++col)
       result(row, col) = CofactorElement3(m, row, col);
@@ -98,8 +104,9 @@ Matrix3x3 CofactorMatrix(const Matrix3x3& m) {
   return result;
 }
 
-Matrix3x3 AdjugateWithDeterminant(const Matrix3x3& m, double* determinant) {
-  const Matrix3x3 cofactor_matrix = CofactorMatrix(m);
+template <typename T>
+Matrix3x3T<T> AdjugateWithDeterminant(const Matrix3x3T<T>& m, T* determinant) {
+  const Matrix3x3T<T> cofactor_matrix = CofactorMatrix(m);
   if (determinant) {
     *determinant = m(0, 0) * cofactor_matrix(0, 0) +
                    m(0, 1) * cofactor_matrix(0, 1) +
@@ -109,33 +116,57 @@ Matrix3x3 AdjugateWithDeterminant(const Matrix3x3& m, double* determinant) {
 }
 
 // Returns the transpose of a matrix.
-Matrix3x3 Transpose(const Matrix3x3& m) {
-  Matrix3x3 result;
+template <typename T>
+Matrix3x3T<T> Transpose(const Matrix3x3T<T>& m) {
+  Matrix3x3T<T> result;
   for (int row = 0; row < 3; ++row) {
     for (int col = 0; col < 3; ++col) result(row, col) = m(col, row);
   }
   return result;
 }
 
-Matrix3x3 InverseWithDeterminant(const Matrix3x3& m, double* determinant) {
+template <typename T>
+Matrix3x3T<T> InverseWithDeterminant(const Matrix3x3T<T>& m, T* determinant) {
   // The inverse is the adjugate divided by the determinant.
-  double det;
-  Matrix3x3 adjugate = AdjugateWithDeterminant(m, &det);
+  T det;
+  Matrix3x3T<T> adjugate = AdjugateWithDeterminant(m, &det);
   if (determinant) *determinant = det;
   if (det == 0)
-    return Matrix3x3::Zero();
+    return Matrix3x3T<T>::Zero();
   else
-    return adjugate * (1.0 / det);
+    return adjugate * (T(1) / det);
 }
 
-Matrix3x3 Inverse(const Matrix3x3& m) {
-  return InverseWithDeterminant(m, nullptr);
+template <typename T>
+Matrix3x3T<T> Inverse(const Matrix3x3T<T>& m) {
+  return InverseWithDeterminant(m, static_cast<T*>(nullptr));
 }
 
-Matrix3x3 RotationMatrixNH(const Rotation& r) {
-  Matrix3x3 m;
+template <typename T>
+Matrix3x3T<T> RotationMatrixNH(const RotationT<T>& r) {
+  Matrix3x3T<T> m;
   RotationMatrix3x3(r, &m);
   return m;
 }
 
+template Matrix3x3T<float> Transpose(const Matrix3x3T<float>& m);
+template Vector<3, float> operator*(const Matrix3x3T<float>& m,
+                                    const Vector<3, float>& v);
+template Matrix3x3T<float> AdjugateWithDeterminant(
+    const Matrix3x3T<float>& m, float* determinant);
+template Matrix3x3T<float> InverseWithDeterminant(
+    const Matrix3x3T<float>& m, float* determinant);
+template Matrix3x3T<float> Inverse(const Matrix3x3T<float>& m);
+template Matrix3x3T<float> RotationMatrixNH(const RotationT<float>& r);
+
+template Matrix3x3T<double> Transpose(const Matrix3x3T<double>& m);
+template Vector<3, double> operator*(const Matrix3x3T<double>& m,
+                                     const Vector<3, double>& v);
+template Matrix3x3T<double> AdjugateWithDeterminant(
+    const Matrix3x3T<double>& m, double* determinant);
+template Matrix3x3T<double> InverseWithDeterminant(
+    const Matrix3x3T<double>& m, double* determinant);
+template Matrix3x3T<double> Inverse(const Matrix3x3T<double>& m);
+template Matrix3x3T<double> RotationMatrixNH(const RotationT<double>& r);
+
 }  // namespace cardboard
@@ -22,60 +22,89 @@
 
 namespace cardboard {
 
-void Rotation::SetAxisAndAngle(const VectorType& axis, double angle) {
+template <typename T>
+void RotationT<T>::SetAxisAndAngle(const VectorType& axis, T angle) {
   VectorType unit_axis = axis;
   if (!Normalize(&unit_axis)) {
     *this = Identity();
   } else {
-    double a = angle / 2;
-    const double s = sin(a);
-    SetQuaternion(QuaternionType(unit_axis * s, cos(a)));
+    T a = angle / 2;
+    const T s = std::sin(a);
+    SetQuaternion(QuaternionType(unit_axis * s, std::cos(a)));
   }
 }
 
-Rotation Rotation::FromRotationMatrix(const Matrix3x3& mat) {
-  static const double kOne = 1.0;
-  static const double kFour = 4.0;
+template <typename T>
+RotationT<T> RotationT<T>::FromRotationMatrix(const Matrix3x3T<T>& mat) {
+  static const T kOne = 1.0;
+  static const T kFour = 4.0;
 
-  const double d0 = mat(0, 0), d1 = mat(1, 1), d2 = mat(2, 2);
-  const double ww = kOne + d0 + d1 + d2;
-  const double xx = kOne + d0 - d1 - d2;
-  const double yy = kOne - d0 + d1 - d2;
-  const double zz = kOne - d0 - d1 + d2;
+  const T d0 = mat(0, 0), d1 = mat(1, 1), d2 = mat(2, 2);
+  const T ww = kOne + d0 + d1 + d2;
+  const T xx = kOne + d0 - d1 - d2;
+  const T yy = kOne - d0 + d1 - d2;
+  const T zz = kOne - d0 - d1 + d2;
 
-  const double max = std::max(ww, std::max(xx, std::max(yy, zz)));
+  const T max = std::max(ww, std::max(xx, std::max(yy, zz)));
   if (ww == max) {
-    const double w4 = sqrt(ww * kFour);
-    return Rotation::FromQuaternion(QuaternionType(
+    const T w4 = std::sqrt(ww * kFour);
+    return RotationT::FromQuaternion(QuaternionType(
         (mat(2, 1) - mat(1, 2)) / w4, (mat(0, 2) - mat(2, 0)) / w4,
         (mat(1, 0) - mat(0, 1)) / w4, w4 / kFour));
   }
 
   if (xx == max) {
-    const double x4 = sqrt(xx * kFour);
-    return Rotation::FromQuaternion(QuaternionType(
+    const T x4 = std::sqrt(xx * kFour);
+    return RotationT::FromQuaternion(QuaternionType(
         x4 / kFour, (mat(0, 1) + mat(1, 0)) / x4, (mat(0, 2) + mat(2, 0)) / x4,
         (mat(2, 1) - mat(1, 2)) / x4));
   }
 
   if (yy == max) {
-    const double y4 = sqrt(yy * kFour);
-    return Rotation::FromQuaternion(QuaternionType(
+    const T y4 = std::sqrt(yy * kFour);
+    return RotationT::FromQuaternion(QuaternionType(
         (mat(0, 1) + mat(1, 0)) / y4, y4 / kFour, (mat(1, 2) + mat(2, 1)) / y4,
         (mat(0, 2) - mat(2, 0)) / y4));
   }
 
   // zz is the largest component.
-  const double z4 = sqrt(zz * kFour);
-  return Rotation::FromQuaternion(
+  const T z4 = std::sqrt(zz * kFour);
+  return RotationT::FromQuaternion(
       QuaternionType((mat(0, 2) + mat(2, 0)) / z4, (mat(1, 2) + mat(2, 1)) / z4,
                      z4 / kFour, (mat(1, 0) - mat(0, 1)) / z4));
 }
 
-void Rotation::GetAxisAndAngle(VectorType* axis, double* angle) const {
+template <typename T>
+RotationT<T> RotationT<T>::Slerp(const RotationT& r0, const RotationT& r1,
+                                 T t) {
+  // Below this angle between the quaternions, they are interpolated linearly,
+  // which avoids dividing by a vanishing sine.
+  static const T kLinearInterpolationCosine = static_cast<T>(0.9995);
+
+  QuaternionType q1 = r1.quat_;
+  T cosine = Dot(r0.quat_, q1);
+  // q and -q are the same rotation; the closest one gives the shortest arc.
+  if (cosine < 0) {
+    q1 = -q1;
+    cosine = -cosine;
+  }
+
+  T w0 = 1 - t;
+  T w1 = t;
+  if (cosine < kLinearInterpolationCosine) {
+    const T angle = std::acos(cosine);
+    const T sine = std::sin(angle);
+    w0 = std::sin(w0 * angle) / sine;
+    w1 = std::sin(w1 * angle) / sine;
+  }
+  return FromQuaternion(w0 * r0.quat_ + w1 * q1);
+}
+
+template <typename T>
+void RotationT<T>::GetAxisAndAngle(VectorType* axis, T* angle) const {
   VectorType vec(quat_[0], quat_[1], quat_[2]);
   if (Normalize(&vec)) {
-    *angle = 2 * acos(quat_[3]);
+    *angle = 2 * std::acos(quat_[3]);
     *axis = vec;
   } else {
     *axis = VectorType(1, 0, 0);
@@ -83,21 +112,24 @@ void Rotation::GetAxisAndAngle(VectorType* axis, double* angle) const {
   }
 }
 
-Rotation Rotation::RotateInto(const VectorType& from, const VectorType& to) {
-  static const double kTolerance = std::numeric_limits<double>::epsilon() * 100;
+template <typename T>
+RotationT<T> RotationT<T>::RotateInto(const VectorType& from,
+                                      const VectorType& to) {
+  static const T kTolerance = std::numeric_limits<T>::epsilon() * 100;
 
   // Directly build the quaternion using the following technique:
   // http://lolengine.net/blog/2014/02/24/quaternion-from-two-vectors-final
-  const double norm_u_norm_v = sqrt(LengthSquared(from) * LengthSquared(to));
-  double real_part = norm_u_norm_v + Dot(from, to);
+  const T norm_u_norm_v = std::sqrt(LengthSquared(from) * LengthSquared(to));
+  T real_part = norm_u_norm_v + Dot(from, to);
   VectorType w;
   if (real_part < kTolerance * norm_u_norm_v) {
     // If |from| and |to| are exactly opposite, rotate 180 degrees around an
     // arbitrary orthogonal axis. Axis normalization can happen later, when we
     // normalize the quaternion.
     real_part = 0.0;
-    w = (abs(from[0]) > abs(from[2])) ? VectorType(-from[1], from[0], 0)
-                                      : VectorType(0, -from[2], from[1]);
+    w = (std::abs(from[0]) > std::abs(from[2]))
+            ? VectorType(-from[1], from[0], 0)
+            : VectorType(0, -from[2], from[1]);
   } else {
     // Otherwise, build the quaternion the standard way.
     w = Cross(from, to);
@@ -105,44 +137,52 @@ Rotation Rotation::RotateInto(const VectorType& from, const VectorType& to) {
 
   // Build and return a normalized quaternion.
   // Note that Rotation::FromQuaternion automatically performs normalization.
-  return Rotation::FromQuaternion(QuaternionType(w[0], w[1], w[2], real_part));
+  return RotationT::FromQuaternion(QuaternionType(w[0], w[1], w[2], real_part));
 }
 
-Rotation::VectorType Rotation::operator*(const Rotation::VectorType& v) const {
+template <typename T>
+typename RotationT<T>::VectorType RotationT<T>::operator*(
+    const VectorType& v) const {
   return ApplyToVector(v);
 }
 
-double Rotation::GetYawAngle() const {
-  const double x = quat_[0];
-  const double y = quat_[1];
-  const double z = quat_[2];
-  const double w = quat_[3];
+template <typename T>
+T RotationT<T>::GetYawAngle() const {
+  const T x = quat_[0];
+  const T y = quat_[1];
+  const T z = quat_[2];
+  const T w = quat_[3];
 
-  const double siny_cosp = 2. * (w * y + z * x);
-  const double cosy_cosp = 1. - 2. * (x * x + y * y);
+  const T siny_cosp = 2 * (w * y + z * x);
+  const T cosy_cosp = 1 - 2 * (x * x + y * y);
   return std::atan2(siny_cosp, cosy_cosp);
 }
 
-double Rotation::GetPitchAngle() const {
-  const double x = quat_[0];
-  const double y = quat_[1];
-  const double z = quat_[2];
-  const double w = quat_[3];
+template <typename T>
+T RotationT<T>::GetPitchAngle() const {
+  const T x = quat_[0];
+  const T y = quat_[1];
+  const T z = quat_[2];
+  const T w = quat_[3];
 
-  const double sinp = 2. * (w * x - y * z);
-  return std::abs(sinp) >= 1. ? std::copysign(M_PI / 2., sinp)
+  const T sinp = 2 * (w * x - y * z);
+  return std::abs(sinp) >= 1 ? std::copysign(static_cast<T>(M_PI / 2), sinp)
                               : std::asin(sinp);
 }
 
-double Rotation::GetRollAngle() const {
-  const double x = quat_[0];
-  const double y = quat_[1];
-  const double z = quat_[2];
-  const double w = quat_[3];
+template <typename T>
+T RotationT<T>::GetRollAngle() const {
+  const T x = quat_[0];
+  const T y = quat_[1];
+  const T z = quat_[2];
+  const T w = quat_[3];
 
-  const double sinr_cosp = 2. * (w * z + x * y);
-  const double cosr_cosp = 1. - 2. * (z * z + x * x);
+  const T sinr_cosp = 2 * (w * z + x * y);
+  const T cosr_cosp = 1 - 2 * (z * z + x * x);
   return std::atan2(sinr_cosp, cosr_cosp);
 }
 
+template class RotationT<float>;
+template class RotationT<double>;
+
 }  // namespace cardboard
@@ -0,0 +1,107 @@
+/*
+ * Copyright 2019 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef CARDBOARD_SDK_UTIL_SPSC_RING_BUFFER_H_
+#define CARDBOARD_SDK_UTIL_SPSC_RING_BUFFER_H_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace cardboard {
+
+// Bounded, wait-free, single-producer/single-consumer FIFO queue.
+//
+// Exactly one thread may call Push() and exactly one thread may call Pop().
+// Neither side ever blocks or retries: every call completes in a bounded
+// number of steps.
+//
+// Overflow policy: when the queue is full the items that do not fit are
+// dropped at the producer side and counted. Dropping the newest items keeps the
+// producer wait-free, and samples already queued keep their order. Use
+// GetDroppedCount() to monitor overflows.
+//
+// @tparam T trivially copyable item type.
+// @tparam Capacity maximum number of queued items. Must be a power of two.
+template <typename T, size_t Capacity>
+class SpscRingBuffer {
+ public:
+  static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0,
+                "Capacity must be a power of two.");
+
+  SpscRingBuffer() : write_index_(0), read_index_(0), num_dropped_(0) {}
+
+  // Appends up to @p num_items items. Must only be called from the producer
+  // thread.
+  //
+  // @param items items to append.
+  // @param num_items number of items to append.
+  // @return number of items appended. The remaining ones are dropped.
+  size_t Push(const T* items, size_t num_items) {
+    const size_t write_index = write_index_.load(std::memory_order_relaxed);
+    const size_t read_index = read_index_.load(std::memory_order_acquire);
+    const size_t num_free = Capacity - (write_index - read_index);
+    const size_t num_pushed = std::min(num_items, num_free);
+    for (size_t i = 0; i < num_pushed; ++i) {
+      items_[(write_index + i) & kIndexMask] = items[i];
+    }
+    write_index_.store(write_index + num_pushed, std::memory_order_release);
+    if (num_pushed < num_items) {
+      num_dropped_.fetch_add(num_items - num_pushed,
+                             std::memory_order_relaxed);
+    }
+    return num_pushed;
+  }
+
+  // Removes up to @p max_items of the oldest items. Must only be called from
+  // the consumer thread.
+  //
+  // @param items buffer receiving the items.
+  // @param max_items capacity of @p items.
+  // @return number of items written to @p items.
+  size_t Pop(T* items, size_t max_items) {
+    const size_t read_index = read_index_.load(std::memory_order_relaxed);
+    const size_t write_index = write_index_.load(std::memory_order_acquire);
+    const size_t num_popped = std::min(max_items, write_index - read_index);
+    for (size_t i = 0; i < num_popped; ++i) {
+      items[i] = items_[(read_index + i) & kIndexMask];
+    }
+    read_index_.store(read_index + num_popped, std::memory_order_release);
+    return num_popped;
+  }
+
+  // Returns the number of items dropped because the queue was full. Can be
+  // called from any thread.
+  uint64_t GetDroppedCount() const {
+    return num_dropped_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  static constexpr size_t kIndexMask = Capacity - 1;
+  // Avoids false sharing between the producer and the consumer indices.
+  static constexpr size_t kCacheLineSize = 64;
+
+  std::array<T, Capacity> items_;
+  // Monotonic indices. Only their low bits address items_.
+  alignas(kCacheLineSize) std::atomic<size_t> write_index_;
+  alignas(kCacheLineSize) std::atomic<size_t> read_index_;
+  alignas(kCacheLineSize) std::atomic<uint64_t> num_dropped_;
+};
+
+}  // namespace cardboard
+
+#endif  // CARDBOARD_SDK_UTIL_SPSC_RING_BUFFER_H_
@@ -0,0 +1,112 @@
+/*
+ * Copyright 2019 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "symmetric_matrix_3x3.h"
+
+namespace cardboard {
+
+template <typename T>
+SymmetricMatrix3x3T<T>::SymmetricMatrix3x3T() {
+  elem_.fill(0);
+}
+
+template <typename T>
+SymmetricMatrix3x3T<T> SymmetricMatrix3x3T<T>::Zero() {
+  SymmetricMatrix3x3T result;
+  return result;
+}
+
+template <typename T>
+SymmetricMatrix3x3T<T> SymmetricMatrix3x3T<T>::Identity() {
+  SymmetricMatrix3x3T result;
+  for (int i = 0; i < 3; ++i) {
+    result(i, i) = 1;
+  }
+  return result;
+}
+
+template <typename T>
+SymmetricMatrix3x3T<T> SymmetricMatrix3x3T<T>::FromMatrix(
+    const Matrix3x3T<T>& m) {
+  SymmetricMatrix3x3T result;
+  for (int row = 0; row < 3; ++row) {
+    for (int col = row; col < 3; ++col) {
+      result(row, col) = (m(row, col) + m(col, row)) / 2;
+    }
+  }
+  return result;
+}
+
+template <typename T>
+Matrix3x3T<T> SymmetricMatrix3x3T<T>::ToMatrix() const {
+  Matrix3x3T<T> result;
+  for (int row = 0; row < 3; ++row) {
+    for (int col = 0; col < 3; ++col) result(row, col) = (*this)(row, col);
+  }
+  return result;
+}
+
+template <typename T>
+SymmetricMatrix3x3T<T> SymmetricMatrix3x3T<T>::Congruence(
+    const Matrix3x3T<T>& m, const SymmetricMatrix3x3T& s) {
+  // m * s, then only the upper triangle of (m * s) * m'.
+  Matrix3x3T<T> ms;
+  for (int row = 0; row < 3; ++row) {
+    for (int col = 0; col < 3; ++col) {
+      ms(row, col) = m(row, 0) * s(0, col) + m(row, 1) * s(1, col) +
+                     m(row, 2) * s(2, col);
+    }
+  }
+  SymmetricMatrix3x3T result;
+  for (int row = 0; row < 3; ++row) {
+    for (int col = row; col < 3; ++col) {
+      result(row, col) = ms(row, 0) * m(col, 0) + ms(row, 1) * m(col, 1) +
+                         ms(row, 2) * m(col, 2);
+    }
+  }
+  return result;
+}
+
+template <typename T>
+SymmetricMatrix3x3T<T> SymmetricMatrix3x3T<T>::Scale(
+    const SymmetricMatrix3x3T& m, T s) {
+  SymmetricMatrix3x3T result;
+  for (int i = 0; i < 6; ++i) result.elem_[i] = m.elem_[i] * s;
+  return result;
+}
+
+template <typename T>
+SymmetricMatrix3x3T<T> SymmetricMatrix3x3T<T>::Addition(
+    const SymmetricMatrix3x3T& lhs, const SymmetricMatrix3x3T& rhs) {
+  SymmetricMatrix3x3T result;
+  for (int i = 0; i < 6; ++i) result.elem_[i] = lhs.elem_[i] + rhs.elem_[i];
+  return result;
+}
+
+template <typename T>
+Vector<3, T> SymmetricMatrix3x3T<T>::MultiplyVector(
+    const Vector<3, T>& v) const {
+  Vector<3, T> result;
+  for (int row = 0; row < 3; ++row) {
+    result[row] = (*this)(row, 0) * v[0] + (*this)(row, 1) * v[1] +
+                  (*this)(row, 2) * v[2];
+  }
+  return result;
+}
+
+template class SymmetricMatrix3x3T<float>;
+template class SymmetricMatrix3x3T<double>;
+
+}  // namespace cardboard
@@ -0,0 +1,97 @@
+/*
+ * Copyright 2019 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef CARDBOARD_SDK_UTIL_SYMMETRIC_MATRIX_3X3_H_
+#define CARDBOARD_SDK_UTIL_SYMMETRIC_MATRIX_3X3_H_
+
+#include <array>
+
+#include "matrix_3x3.h"
+#include "vector.h"
+
+namespace cardboard {
+
+// The SymmetricMatrix3x3T class defines a symmetric 3x3 matrix. Only the six
+// elements of the upper triangle are stored, in row-major order, so the matrix
+// is symmetric by construction and operations only compute those elements. It
+// is used for covariance matrices. It is defined for the float and double
+// scalar types, SymmetricMatrix3x3 being the double precision one.
+template <typename T>
+class SymmetricMatrix3x3T {
+ public:
+  // The default constructor zero-initializes all elements.
+  SymmetricMatrix3x3T();
+
+  // Returns a SymmetricMatrix3x3 containing all zeroes.
+  static SymmetricMatrix3x3T Zero();
+
+  // Returns an identity SymmetricMatrix3x3.
+  static SymmetricMatrix3x3T Identity();
+
+  // Returns the symmetric part (m + m') / 2 of a matrix.
+  static SymmetricMatrix3x3T FromMatrix(const Matrix3x3T<T>& m);
+
+  // Element accessors. (row, col) and (col, row) refer to the same element.
+  T& operator()(int row, int col) { return elem_[kPackedIndex[row][col]]; }
+  T operator()(int row, int col) const {
+    return elem_[kPackedIndex[row][col]];
+  }
+
+  // Returns the full matrix.
+  Matrix3x3T<T> ToMatrix() const;
+
+  // Binary scale operators.
+  friend SymmetricMatrix3x3T operator*(const SymmetricMatrix3x3T& m, T s) {
+    return Scale(m, s);
+  }
+  friend SymmetricMatrix3x3T operator*(T s, const SymmetricMatrix3x3T& m) {
+    return Scale(m, s);
+  }
+
+  // Binary matrix addition.
+  friend SymmetricMatrix3x3T operator+(const SymmetricMatrix3x3T& lhs,
+                                       const SymmetricMatrix3x3T& rhs) {
+    return Addition(lhs, rhs);
+  }
+
+  // Multiplies the matrix and a column Vector.
+  friend Vector<3, T> operator*(const SymmetricMatrix3x3T& m,
+                                const Vector<3, T>& v) {
+    return m.MultiplyVector(v);
+  }
+
+  // Returns m * s * m', which is symmetric. This is how a covariance s is
+  // transformed by the linear map m.
+  static SymmetricMatrix3x3T Congruence(const Matrix3x3T<T>& m,
+                                        const SymmetricMatrix3x3T& s);
+
+ private:
+  // Index of each element of the full matrix in elem_.
+  static constexpr int kPackedIndex[3][3] = {{0, 1, 2}, {1, 3, 4}, {2, 4, 5}};
+
+  static SymmetricMatrix3x3T Scale(const SymmetricMatrix3x3T& m, T s);
+  static SymmetricMatrix3x3T Addition(const SymmetricMatrix3x3T& lhs,
+                                      const SymmetricMatrix3x3T& rhs);
+  Vector<3, T> MultiplyVector(const Vector<3, T>& v) const;
+
+  std::array<T, 6> elem_;
+};
+
+typedef SymmetricMatrix3x3T<double> SymmetricMatrix3x3;
+typedef SymmetricMatrix3x3T<float> SymmetricMatrix3x3f;
+
+}  // namespace cardboard
+
+#endif  // CARDBOARD_SDK_UTIL_SYMMETRIC_MATRIX_3X3_H_
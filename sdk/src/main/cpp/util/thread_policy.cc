@@ -0,0 +1,141 @@
+/*
+ * Copyright 2019 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "thread_policy.h"
+
+#if defined(__linux__)
+#include <errno.h>
+#include <sched.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "logging.h"
+
+namespace cardboard {
+
+#if defined(__linux__)
+
+namespace {
+
+// Scheduling of the calling thread before its first ApplyThreadPolicy() call.
+struct OriginalThreadScheduling {
+  bool is_recorded = false;
+  int nice_value = 0;
+  bool has_cpu_affinity = false;
+  cpu_set_t cpu_affinity;
+};
+
+thread_local OriginalThreadScheduling original_thread_scheduling;
+
+}  // namespace
+
+bool ApplyThreadPolicy(const ThreadPolicy& policy) {
+  bool is_applied = true;
+  // Linux schedules threads as tasks, so the scheduling calls below take the
+  // thread id.
+  const pid_t thread_id = static_cast<pid_t>(syscall(SYS_gettid));
+
+  OriginalThreadScheduling& original = original_thread_scheduling;
+  if (!original.is_recorded) {
+    original.is_recorded = true;
+    // getpriority() may legitimately return -1, so errno tells failures apart.
+    errno = 0;
+    const int nice_value = getpriority(PRIO_PROCESS, thread_id);
+    original.nice_value = errno == 0 ? nice_value : 0;
+    original.has_cpu_affinity =
+        sched_getaffinity(thread_id, sizeof(original.cpu_affinity),
+                          &original.cpu_affinity) == 0;
+  }
+
+  bool is_fifo_scheduling_applied = false;
+  if (policy.use_fifo_scheduling) {
+    struct sched_param param;
+    param.sched_priority = policy.fifo_priority;
+    if (sched_setscheduler(thread_id, SCHED_FIFO, &param) == 0) {
+      is_fifo_scheduling_applied = true;
+    } else {
+      CARDBOARD_LOGI(
+          "ThreadPolicy: SCHED_FIFO is not permitted (%s), using the nice "
+          "value only.",
+          strerror(errno));
+      is_applied = false;
+    }
+  }
+  if (!is_fifo_scheduling_applied) {
+    const int scheduler = sched_getscheduler(thread_id);
+    if (scheduler == SCHED_FIFO || scheduler == SCHED_RR) {
+      struct sched_param param;
+      param.sched_priority = 0;
+      if (sched_setscheduler(thread_id, SCHED_OTHER, &param) != 0) {
+        CARDBOARD_LOGE("ThreadPolicy: Could not restore SCHED_OTHER (%s).",
+                       strerror(errno));
+        is_applied = false;
+      }
+    }
+  }
+
+  // The nice value does not apply to real-time threads.
+  if (!is_fifo_scheduling_applied) {
+    const int nice_value =
+        policy.set_nice_value ? policy.nice_value : original.nice_value;
+    if (setpriority(PRIO_PROCESS, thread_id, nice_value) != 0) {
+      CARDBOARD_LOGE("ThreadPolicy: Could not set nice value %d (%s).",
+                     nice_value, strerror(errno));
+      is_applied = false;
+    }
+  }
+
+  if (policy.cpu_affinity_mask != 0) {
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    for (int cpu = 0; cpu < 64 && cpu < CPU_SETSIZE; ++cpu) {
+      if (policy.cpu_affinity_mask & (uint64_t{1} << cpu)) {
+        CPU_SET(cpu, &cpu_set);
+      }
+    }
+    if (sched_setaffinity(thread_id, sizeof(cpu_set), &cpu_set) != 0) {
+      CARDBOARD_LOGE("ThreadPolicy: Could not set CPU affinity 0x%llx (%s).",
+                     static_cast<unsigned long long>(policy.cpu_affinity_mask),
+                     strerror(errno));
+      is_applied = false;
+    }
+  } else if (original.has_cpu_affinity) {
+    if (sched_setaffinity(thread_id, sizeof(original.cpu_affinity),
+                          &original.cpu_affinity) != 0) {
+      CARDBOARD_LOGE("ThreadPolicy: Could not restore the CPU affinity (%s).",
+                     strerror(errno));
+      is_applied = false;
+    }
+  }
+
+  return is_applied;
+}
+
+#else
+
+bool ApplyThreadPolicy(const ThreadPolicy& policy) {
+  if (policy != kDefaultThreadPolicy) {
+    CARDBOARD_LOGE("ThreadPolicy: Not supported on this platform.");
+    return false;
+  }
+  return true;
+}
+
+#endif
+
+}  // namespace cardboard
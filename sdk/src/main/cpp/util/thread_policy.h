@@ -0,0 +1,73 @@
+/*
+ * Copyright 2019 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef CARDBOARD_SDK_UTIL_THREAD_POLICY_H_
+#define CARDBOARD_SDK_UTIL_THREAD_POLICY_H_
+
+#include <cstdint>
+
+namespace cardboard {
+
+// Scheduling policy of a worker thread.
+struct ThreadPolicy {
+  // Whether nice_value is applied. Otherwise the original nice value of the
+  // thread is restored.
+  bool set_nice_value;
+
+  // Nice value of the thread, from -20 (highest priority) to 19. Negative
+  // values usually need elevated privileges.
+  int nice_value;
+
+  // Whether the thread requests real-time SCHED_FIFO scheduling. When it is
+  // not permitted, only the nice value is applied. Otherwise the thread is
+  // switched back to SCHED_OTHER.
+  bool use_fifo_scheduling;
+
+  // SCHED_FIFO priority, from 1 (lowest) to 99.
+  int fifo_priority;
+
+  // Bit i allows the thread to run on CPU i. Zero restores the original
+  // affinity of the thread.
+  uint64_t cpu_affinity_mask;
+
+  bool operator==(const ThreadPolicy& other) const {
+    return set_nice_value == other.set_nice_value &&
+           nice_value == other.nice_value &&
+           use_fifo_scheduling == other.use_fifo_scheduling &&
+           fifo_priority == other.fifo_priority &&
+           cpu_affinity_mask == other.cpu_affinity_mask;
+  }
+
+  bool operator!=(const ThreadPolicy& other) const {
+    return !(*this == other);
+  }
+};
+
+// The scheduling inherited from the creating thread. Applying it reverts any
+// policy applied before.
+constexpr ThreadPolicy kDefaultThreadPolicy = {false, 0, false, 0, 0};
+
+// Applies @p policy to the calling thread. Failures are logged and the
+// remaining settings are still applied. The original nice value and CPU
+// affinity of the thread are recorded by its first call, so that a later
+// policy without them restores them.
+//
+// @param policy policy to apply.
+// @return true if every setting of @p policy was applied.
+bool ApplyThreadPolicy(const ThreadPolicy& policy);
+
+}  // namespace cardboard
+
+#endif  // CARDBOARD_SDK_UTIL_THREAD_POLICY_H_
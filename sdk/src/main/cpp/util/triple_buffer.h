@@ -0,0 +1,100 @@
+/*
+ * Copyright 2019 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef CARDBOARD_SDK_UTIL_TRIPLE_BUFFER_H_
+#define CARDBOARD_SDK_UTIL_TRIPLE_BUFFER_H_
+
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <thread>  // NOLINT
+
+namespace cardboard {
+
+// Wait-free publication of the latest value from one writer to one reader.
+//
+// Three slots are used: the writer owns one, the reader owns another and the
+// third one holds the latest published value. Write() and Read() only swap
+// slot indices with a single atomic exchange, so neither side ever blocks,
+// spins or waits for the other one. The reader always gets the most recently
+// published value; intermediate values may be skipped.
+//
+// Write() must not be called concurrently with itself. Read() must always be
+// called from the same thread: debug builds assert it.
+//
+// @tparam T copyable value type.
+template <typename T>
+class TripleBuffer {
+ public:
+  TripleBuffer()
+      : slots_(), write_index_(0), shared_index_(1), read_index_(2) {}
+
+  // Publishes @p value. Must only be called by the writer.
+  //
+  // @param value value to publish.
+  void Write(const T& value) {
+    slots_[write_index_] = value;
+    write_index_ =
+        shared_index_.exchange(write_index_ | kIsFreshBit,
+                               std::memory_order_acq_rel) &
+        kIndexMask;
+  }
+
+  // Gets the most recently published value. Must only be called by the
+  // reader thread.
+  //
+  // @return the latest published value, or a default constructed value if
+  //         nothing was published yet.
+  T Read() {
+#ifndef NDEBUG
+    // The first caller becomes the reader thread.
+    std::thread::id reader_thread;
+    if (!reader_thread_.compare_exchange_strong(reader_thread,
+                                                std::this_thread::get_id())) {
+      assert(reader_thread == std::this_thread::get_id() &&
+             "TripleBuffer::Read() called from a second thread");
+    }
+#endif
+    if (shared_index_.load(std::memory_order_relaxed) & kIsFreshBit) {
+      read_index_ =
+          shared_index_.exchange(read_index_, std::memory_order_acq_rel) &
+          kIndexMask;
+    }
+    return slots_[read_index_];
+  }
+
+ private:
+  static constexpr uint8_t kIndexMask = 0x3;
+  // Set on the shared index when it holds a value not seen by the reader yet.
+  static constexpr uint8_t kIsFreshBit = 0x4;
+  // Avoids false sharing between the writer and the reader indices.
+  static constexpr size_t kCacheLineSize = 64;
+
+  std::array<T, 3> slots_;
+  // Only accessed by the writer.
+  alignas(kCacheLineSize) uint8_t write_index_;
+  alignas(kCacheLineSize) std::atomic<uint8_t> shared_index_;
+  // Only accessed by the reader.
+  alignas(kCacheLineSize) uint8_t read_index_;
+#ifndef NDEBUG
+  std::atomic<std::thread::id> reader_thread_{std::thread::id()};
+#endif
+};
+
+}  // namespace cardboard
+
+#endif  // CARDBOARD_SDK_UTIL_TRIPLE_BUFFER_H_
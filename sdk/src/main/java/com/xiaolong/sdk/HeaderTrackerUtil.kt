@@ -2,10 +2,22 @@ package com.xiaolong.sdk
 
 object HeaderTrackerUtil {
     external fun nativeOnCreate(): Long
+    external fun nativeOnCreateWithStateModel(stateModel: Int): Long
     external fun nativeOnDestroy(nativeApp: Long)
     external fun nativeOnPause(nativeApp: Long)
     external fun nativeOnResume(nativeApp: Long)
     external fun nativeGetHeaderPose(nativeApp: Long, orientation: Int): FloatArray
+    external fun nativeGetHeaderPoseAtTime(nativeApp: Long, orientation: Int, displayTimeNanos: Long): FloatArray
+    external fun nativeOnFramePresented(nativeApp: Long, displayTimeNanos: Long, presentTimeNanos: Long)
+    external fun nativeGetDisplayLatencyTrace(nativeApp: Long): LongArray
+    external fun nativeGetSensorClockOffset(nativeApp: Long): Long
+    external fun nativeSetTrackingQos(nativeApp: Long, qos: Int)
+    external fun nativeSetThreadPolicies(nativeApp: Long, sensorNiceValue: Int, sensorCpuAffinityMask: Long, fusionNiceValue: Int, fusionCpuAffinityMask: Long)
+    external fun nativeGetLatencyHistogram(nativeApp: Long, histogram: Int): LongArray
+    external fun nativeSetReorderLatencyBudget(nativeApp: Long, latencyBudgetNanos: Long)
+    external fun nativeGetReorderStatistics(nativeApp: Long): LongArray
+    external fun nativeSetAccelerometerCorrectionSchedule(nativeApp: Long, minCorrectionPeriodNanos: Long, maxCorrectionPeriodNanos: Long, averageSkippedSamples: Boolean)
+    external fun nativeSetRotationPredictionModel(nativeApp: Long, model: Int)
 
     init {
         System.loadLibrary("headtracker")